@@ -0,0 +1,116 @@
+//=============================================================================
+//  MuseScore
+//  Music Composition & Notation
+//
+//  Copyright (C) 2020 Werner Schweer
+//
+//  This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License version 2
+//  as published by the Free Software Foundation and appearing in
+//  the file LICENCE.GPL
+//=============================================================================
+
+#include <chrono>
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define DSP_PAUSE() _mm_pause()
+#else
+#define DSP_PAUSE() std::this_thread::yield()
+#endif
+
+#include "dsppool.h"
+
+namespace Ms {
+static const int SPIN_ROUNDS  = 2000;      // busy waiting after a job
+static const int YIELD_ROUNDS = 4000;      // then yield, then sleep
+
+//---------------------------------------------------------
+//   DspPool
+//    threads is the number of worker threads in addition
+//    to the audio thread
+//---------------------------------------------------------
+
+DspPool::DspPool(int threads)
+{
+    for (int i = 0; i < threads; ++i) {
+        _workers.emplace_back(&DspPool::worker, this);
+    }
+}
+
+DspPool::~DspPool()
+{
+    _stop = true;
+    for (std::thread& t : _workers) {
+        t.join();
+    }
+}
+
+//---------------------------------------------------------
+//   work
+//    execute tasks of the current job until all are claimed
+//---------------------------------------------------------
+
+void DspPool::work()
+{
+    quint64 c = _claim.load(std::memory_order_acquire);
+    for (;;) {
+        const int idx   = int(c & 0xffff);
+        const int count = int((c >> 16) & 0xffff);
+        if (idx >= count) {
+            return;
+        }
+        if (_claim.compare_exchange_weak(c, c + 1, std::memory_order_acq_rel, std::memory_order_acquire)) {
+            // the job cannot change before this task is done
+            _task(_ctx, idx);
+            _done.fetch_add(1, std::memory_order_release);
+            c = _claim.load(std::memory_order_acquire);
+        }
+    }
+}
+
+//---------------------------------------------------------
+//   worker
+//---------------------------------------------------------
+
+void DspPool::worker()
+{
+    int idle = 0;
+    while (!_stop) {
+        const quint64 c = _claim.load(std::memory_order_acquire);
+        if ((c & 0xffff) < ((c >> 16) & 0xffff)) {
+            work();
+            idle = 0;
+        } else if (++idle < SPIN_ROUNDS) {
+            DSP_PAUSE();
+        } else if (idle < YIELD_ROUNDS) {
+            std::this_thread::yield();
+        } else {
+            // the audio thread does not wait for us, a late
+            // wakeup only costs parallelism
+            std::this_thread::sleep_for(std::chrono::microseconds(200));
+            idle = YIELD_ROUNDS;
+        }
+    }
+}
+
+//---------------------------------------------------------
+//   run
+//    called from the audio thread; returns when all tasks
+//    of the job are done
+//---------------------------------------------------------
+
+void DspPool::run(Task task, void* ctx, int count)
+{
+    Q_ASSERT(count <= MAX_TASKS);
+    _task = task;
+    _ctx  = ctx;
+    _done.store(0, std::memory_order_relaxed);
+    const quint64 generation = (_claim.load(std::memory_order_relaxed) >> 32) + 1;
+    _claim.store((generation << 32) | (quint64(count) << 16), std::memory_order_release);
+
+    work();
+    while (_done.load(std::memory_order_acquire) < count) {
+        DSP_PAUSE();
+    }
+}
+}
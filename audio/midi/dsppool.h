@@ -0,0 +1,59 @@
+//=============================================================================
+//  MuseScore
+//  Music Composition & Notation
+//
+//  Copyright (C) 2020 Werner Schweer
+//
+//  This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License version 2
+//  as published by the Free Software Foundation and appearing in
+//  the file LICENCE.GPL
+//=============================================================================
+
+#ifndef __DSPPOOL_H__
+#define __DSPPOOL_H__
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+namespace Ms {
+//---------------------------------------------------------
+//   DspPool
+//    Worker threads for rendering audio in parallel. The
+//    audio thread publishes a job of count tasks and works
+//    on it itself; tasks are claimed through a single atomic
+//    word holding the job generation, the task count and the
+//    next task index. The audio thread only waits for tasks
+//    which are being executed, never for a sleeping worker,
+//    and it never takes a lock.
+//---------------------------------------------------------
+
+class DspPool
+{
+public:
+    typedef void (* Task)(void* ctx, int idx);
+    static const int MAX_TASKS = 0xffff;
+
+private:
+    std::vector<std::thread> _workers;
+    std::atomic<quint64> _claim { 0 };      // generation << 32 | count << 16 | index
+    std::atomic<int> _done { 0 };
+    std::atomic<bool> _stop { false };
+    Task _task { nullptr };
+    void* _ctx { nullptr };
+
+    void work();
+    void worker();
+
+public:
+    DspPool(int threads);
+    ~DspPool();
+    DspPool(const DspPool&) = delete;
+    DspPool& operator=(const DspPool&) = delete;
+
+    int threads() const { return int(_workers.size()); }
+    void run(Task, void* ctx, int count);
+};
+}     // namespace Ms
+#endif
@@ -10,6 +10,8 @@
 //  the file LICENCE.GPL
 //=============================================================================
 
+#include <algorithm>
+
 #include "libmscore/xml.h"
 #include "libmscore/note.h"
 #include "libmscore/harmony.h"
@@ -464,4 +466,96 @@ void EventMap::fixupMIDI()
 
     free((void*)info);
 }
+
+//---------------------------------------------------------
+//   EventMap::sort
+//    merge the events inserted since the last call into
+//    the sorted prefix
+//---------------------------------------------------------
+
+static bool tickLess(const EventMap::value_type& a, const EventMap::value_type& b)
+{
+    return a.first < b.first;
+}
+
+void EventMap::sort() const
+{
+    if (_sorted == _events.size()) {
+        return;
+    }
+    auto mid = _events.begin() + _sorted;
+    std::stable_sort(mid, _events.end(), tickLess);
+    std::inplace_merge(_events.begin(), mid, _events.end(), tickLess);
+    _sorted = _events.size();
+}
+
+//---------------------------------------------------------
+//   EventMap::erase
+//---------------------------------------------------------
+
+EventMap::iterator EventMap::erase(const_iterator i)
+{
+    sort();
+    auto r = _events.erase(i);
+    _sorted = _events.size();
+    return r;
+}
+
+EventMap::iterator EventMap::erase(const_iterator first, const_iterator last)
+{
+    sort();
+    auto r = _events.erase(first, last);
+    _sorted = _events.size();
+    return r;
+}
+
+//---------------------------------------------------------
+//   EventMap::lower_bound
+//   EventMap::upper_bound
+//---------------------------------------------------------
+
+EventMap::iterator EventMap::lower_bound(int tick)
+{
+    sort();
+    return std::lower_bound(_events.begin(), _events.end(), tick,
+                            [](const value_type& e, int t) { return e.first < t; });
+}
+
+EventMap::const_iterator EventMap::lower_bound(int tick) const
+{
+    return const_cast<EventMap*>(this)->lower_bound(tick);
+}
+
+EventMap::iterator EventMap::upper_bound(int tick)
+{
+    sort();
+    return std::upper_bound(_events.begin(), _events.end(), tick,
+                            [](int t, const value_type& e) { return t < e.first; });
+}
+
+EventMap::const_iterator EventMap::upper_bound(int tick) const
+{
+    return const_cast<EventMap*>(this)->upper_bound(tick);
+}
+
+//---------------------------------------------------------
+//   EventMap::find
+//   EventMap::count
+//---------------------------------------------------------
+
+EventMap::iterator EventMap::find(int tick)
+{
+    auto i = lower_bound(tick);
+    return (i != _events.end() && i->first == tick) ? i : _events.end();
+}
+
+EventMap::const_iterator EventMap::find(int tick) const
+{
+    return const_cast<EventMap*>(this)->find(tick);
+}
+
+size_t EventMap::count(int tick) const
+{
+    return upper_bound(tick) - lower_bound(tick);
+}
 }
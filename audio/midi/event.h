@@ -14,6 +14,7 @@
 #define __EVENT_H__
 
 #include <map>
+#include <vector>
 
 namespace Ms {
 class Note;
@@ -335,9 +336,28 @@ public:
     void insertNote(int channel, Note*);
 };
 
-class EventMap : public std::multimap<int, NPlayEvent>
+//---------------------------------------------------------
+//   EventMap
+//    Events sorted by tick in one flat array. Inserting
+//    appends; the new events are merged into place when the
+//    map is read next, so events with equal ticks keep their
+//    insertion order like in a std::multimap. Reading a map
+//    which has unsorted events modifies it: sort() a map
+//    before it is shared with another thread.
+//---------------------------------------------------------
+
+class EventMap
 {
+public:
+    typedef std::pair<int, NPlayEvent> value_type;
+    typedef std::vector<value_type>::iterator iterator;
+    typedef std::vector<value_type>::const_iterator const_iterator;
+
+private:
+    mutable std::vector<value_type> _events;
+    mutable size_t _sorted = 0;           // length of the sorted prefix
     int _highestChannel = 15;
+
 public:
     void fixupMIDI();
     void registerChannel(int c)
@@ -346,6 +366,33 @@ public:
             _highestChannel = c;
         }
     }
+
+    void sort() const;
+
+    void insert(const value_type& e) { _events.push_back(e); }
+    template<class InputIt> void insert(InputIt first, InputIt last) { _events.insert(_events.end(), first, last); }
+    iterator erase(const_iterator i);
+    iterator erase(const_iterator first, const_iterator last);
+    void clear() { _events.clear(); _sorted = 0; }
+    void reserve(size_t n) { _events.reserve(n); }
+
+    bool empty() const { return _events.empty(); }
+    size_t size() const { return _events.size(); }
+
+    iterator begin() { sort(); return _events.begin(); }
+    iterator end() { sort(); return _events.end(); }
+    const_iterator begin() const { sort(); return _events.cbegin(); }
+    const_iterator end() const { sort(); return _events.cend(); }
+    const_iterator cbegin() const { return begin(); }
+    const_iterator cend() const { return end(); }
+
+    iterator lower_bound(int tick);
+    iterator upper_bound(int tick);
+    const_iterator lower_bound(int tick) const;
+    const_iterator upper_bound(int tick) const;
+    iterator find(int tick);
+    const_iterator find(int tick) const;
+    size_t count(int tick) const;
 };
 
 typedef EventList::iterator iEvent;
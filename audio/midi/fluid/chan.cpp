@@ -247,6 +247,9 @@ void Channel::setPreset(Preset* p)
         if (p) {
             p->loadSamples();
         }
+        if (_preset) {
+            _preset->releaseSamples();
+        }
         _preset = p;
     }
 }
@@ -18,6 +18,7 @@
  * 02111-1307, USA
  */
 
+#include <algorithm>
 #include "fluid.h"
 #include "sfont.h"
 #include "conv.h"
@@ -26,6 +27,7 @@
 
 #include "midi/event.h"
 #include "midi/msynthesizer.h"
+#include "midi/realtimecheck.h"
 
 #include "mscore/preferences.h"
 #include "mscore/extension.h"
@@ -101,8 +103,11 @@ void Fluid::init(float sampleRate)
     }
     _masterTuning = 440.0;
 
-    for (int i = 0; i < 512; i++) {
-        freeVoices.append(new Voice(this));
+    freeVoices.reserve(MAX_VOICES);
+    activeVoices.reserve(MAX_VOICES);
+    pendingNotes.reserve(MAX_PENDING_NOTES);
+    for (int i = 0; i < MAX_VOICES; i++) {
+        freeVoices.push_back(new Voice(this));
     }
 }
 
@@ -114,7 +119,7 @@ Fluid::~Fluid()
 {
     _state = FLUID_SYNTH_STOPPED;
     _globalTerminate = true;
-    while (!mutex.tryLock()) {}
+    suspend();
     qDeleteAll(activeVoices);
     qDeleteAll(freeVoices);
     qDeleteAll(sfonts);
@@ -128,8 +133,100 @@ Fluid::~Fluid()
 
 void Fluid::freeVoice(Voice* v)
 {
-    if (activeVoices.removeOne(v)) {
-        freeVoices.append(v);
+    if (_parallel) {
+        return;             // finishParallel() collects voices turned off
+    }
+    auto i = std::find(activeVoices.begin(), activeVoices.end(), v);
+    if (i != activeVoices.end()) {
+        activeVoices.erase(i);
+        freeVoices.push_back(v);
+    }
+}
+
+//---------------------------------------------------------
+//   forActiveVoices
+//    call f for all active voices; f may turn off the
+//    voice it is called for, which removes it from
+//    activeVoices
+//---------------------------------------------------------
+
+template<typename F>
+void Fluid::forActiveVoices(F f)
+{
+    for (size_t i = 0; i < activeVoices.size();) {
+        Voice* v = activeVoices[i];
+        f(v);
+        if (i < activeVoices.size() && activeVoices[i] == v) {
+            ++i;
+        }
+    }
+}
+
+//---------------------------------------------------------
+//   suspend
+//    stop the audio thread from processing voices and wait
+//    until it has left process(); the audio thread itself
+//    never waits
+//---------------------------------------------------------
+
+void Fluid::suspend()
+{
+    realtimeLockCheck();
+    mutex.lock();
+    _suspended = true;
+    while (_processing) {
+        QThread::yieldCurrentThread();
+    }
+}
+
+//---------------------------------------------------------
+//   resume
+//---------------------------------------------------------
+
+void Fluid::resume()
+{
+    _suspended = false;
+    mutex.unlock();
+}
+
+//---------------------------------------------------------
+//   inAudioThread
+//    false until the first audio period: commands sent
+//    before are queued and run by that period
+//---------------------------------------------------------
+
+bool Fluid::inAudioThread() const
+{
+    Qt::HANDLE t = _audioThread;
+    return t && t == QThread::currentThreadId();
+}
+
+//---------------------------------------------------------
+//   sendCmd
+//    queue a command for the audio thread; any thread but
+//    the audio thread may send, FluidCmdFifo only allows
+//    one producer at a time
+//---------------------------------------------------------
+
+bool Fluid::sendCmd(const FluidCmd& cmd)
+{
+    QMutexLocker locker(&cmdMutex);
+    return cmds.enqueue(cmd);
+}
+
+//---------------------------------------------------------
+//   runCmd
+//---------------------------------------------------------
+
+void Fluid::runCmd(const FluidCmd& cmd)
+{
+    switch (cmd.type) {
+    case FluidCmd::Type::ALL_NOTES_OFF:
+        notesOff(cmd.channel);
+        break;
+    case FluidCmd::Type::ALL_SOUNDS_OFF:
+        soundsOff(cmd.channel);
+        break;
     }
 }
 
@@ -158,10 +255,15 @@ void Fluid::play(const PlayEvent& event)
             //
             // process note off
             //
-            for (Voice* v : activeVoices) {
+            forActiveVoices([ch, key](Voice* v) {
                 if (v->ON() && (v->chan == ch) && (v->key == key)) {
                     v->noteoff();
                 }
+            });
+            for (PendingNote& p : pendingNotes) {
+                if (p.chan == ch && p.key == key) {
+                    p.released = true;
+                }
             }
             return;
         }
@@ -178,12 +280,21 @@ void Fluid::play(const PlayEvent& event)
              * several voice processes, for example a stereo sample.  Don't
              * release those...
              */
-            for (Voice* v : activeVoices) {
+            forActiveVoices([this, ch, key](Voice* v) {
                 if (v->isPlaying() && (v->chan == ch) && (v->key == key) && (v->get_id() != noteid)) {
                     v->noteoff();
                 }
+            });
+            Preset* preset = cp->preset();
+            if (realtime() && !preset->samplesLoaded(key, vel, true)) {
+                // start the note once the decoder has loaded its samples
+                if (pendingNotes.size() < MAX_PENDING_NOTES) {
+                    pendingNotes.push_back({ preset, noteid, ch, key, vel, event.tuning(), 0, false });
+                }
+                ++noteid;
+            } else {
+                err = !preset->noteon(this, noteid++, ch, key, vel, event.tuning());
             }
-            err = !cp->preset()->noteon(this, noteid++, ch, key, vel, event.tuning());
         }
     } else if (type == ME_CONTROLLER) {
         switch (event.dataA()) {
@@ -229,11 +340,11 @@ void Fluid::play(const PlayEvent& event)
 
 void Fluid::damp_voices(int chan)
 {
-    for (Voice* v : activeVoices) {
+    forActiveVoices([chan](Voice* v) {
         if ((v->chan == chan) && v->SUSTAINED()) {
             v->noteoff();
         }
-    }
+    });
 }
 
 //---------------------------------------------------------
@@ -242,10 +353,26 @@ void Fluid::damp_voices(int chan)
 
 void Fluid::allNotesOff(int chan)
 {
-    for (Voice* v : activeVoices) {
+    if (inAudioThread()) {
+        notesOff(chan);
+    } else if (!sendCmd({ FluidCmd::Type::ALL_NOTES_OFF, chan })) {
+        suspend();
+        notesOff(chan);
+        resume();
+    }
+}
+
+void Fluid::notesOff(int chan)
+{
+    forActiveVoices([chan](Voice* v) {
         if (chan == -1 || v->chan == chan) {
             v->noteoff();
         }
+    });
+    for (PendingNote& p : pendingNotes) {
+        if (chan == -1 || p.chan == chan) {
+            p.released = true;
+        }
     }
 }
 
@@ -257,10 +384,80 @@ void Fluid::allNotesOff(int chan)
 
 void Fluid::allSoundsOff(int chan)
 {
-    for (Voice* v : activeVoices) {
+    if (inAudioThread()) {
+        soundsOff(chan);
+    } else if (!sendCmd({ FluidCmd::Type::ALL_SOUNDS_OFF, chan })) {
+        suspend();
+        soundsOff(chan);
+        resume();
+    }
+}
+
+void Fluid::soundsOff(int chan)
+{
+    forActiveVoices([chan](Voice* v) {
         if (chan == -1 || v->chan == chan) {
             v->off();
         }
+    });
+    dropPendingNotes(chan);
+}
+
+//---------------------------------------------------------
+//   startPendingNotes
+//    start the held back notes whose samples are loaded;
+//    a note is dropped if the program of its channel changed
+//---------------------------------------------------------
+
+void Fluid::startPendingNotes()
+{
+    size_t n = 0;
+    for (size_t i = 0; i < pendingNotes.size(); ++i) {
+        PendingNote& p = pendingNotes[i];
+        if (channel[p.chan]->preset() != p.preset) {
+            continue;
+        }
+        // ask again now and then, the decoder drops requests
+        // when its ring is full
+        if (!p.preset->samplesLoaded(p.key, p.vel, ++p.periods % 64 == 0)) {
+            pendingNotes[n++] = p;
+            continue;
+        }
+        p.preset->noteon(this, p.id, p.chan, p.key, p.vel, p.tuning);
+        if (p.released) {
+            const unsigned id = p.id;
+            forActiveVoices([id](Voice* v) {
+                if (v->ON() && v->get_id() == id) {
+                    v->noteoff();
+                }
+            });
+        }
+    }
+    pendingNotes.erase(pendingNotes.begin() + n, pendingNotes.end());
+}
+
+//---------------------------------------------------------
+//   dropPendingNotes
+//    forget the held back notes of chan, all if chan == -1
+//---------------------------------------------------------
+
+void Fluid::dropPendingNotes(int chan)
+{
+    pendingNotes.erase(std::remove_if(pendingNotes.begin(), pendingNotes.end(), [chan](const PendingNote& p) {
+        return chan == -1 || p.chan == chan;
+    }), pendingNotes.end());
+}
+
+//---------------------------------------------------------
+//   releaseSamples
+//    the voices turned off no longer use their samples;
+//    called when no voice is rendered
+//---------------------------------------------------------
+
+void Fluid::releaseSamples()
+{
+    for (Voice* v : freeVoices) {
+        v->releaseSample();
     }
 }
 
@@ -273,9 +470,7 @@ void Fluid::allSoundsOff(int chan)
 
 void Fluid::system_reset()
 {
-    for (Voice* v : activeVoices) {
-        v->off();
-    }
+    soundsOff(-1);
     for (Channel* c : channel) {
         c->reset();
     }
@@ -434,14 +629,99 @@ void Fluid::update_presets()
 
 void Fluid::process(unsigned len, float* out, float* effect1, float* effect2)
 {
-    if (mutex.tryLock()) {
-        //we have to copy voices array for proper output sound processing in for loop
-        auto tempVoices = activeVoices;
-        for (Voice* v : tempVoices) {
-            v->write(len, out, effect1, effect2);
+    if (_suspended) {
+        return;
+    }
+    _processing = true;
+    if (_suspended) {
+        _processing = false;
+        return;
+    }
+    _audioThread = QThread::currentThreadId();
+    while (!cmds.empty()) {
+        runCmd(cmds.dequeue());
+    }
+    startPendingNotes();
+    // a finished voice removes itself from activeVoices
+    forActiveVoices([len, out, effect1, effect2](Voice* v) {
+        v->write(len, out, effect1, effect2);
+    });
+    releaseSamples();
+    _processing = false;
+}
+
+//---------------------------------------------------------
+//   prepareParallel
+//    split the active voices into at most maxGroups groups
+//    of contiguous voices. Never returns 0: process() would
+//    then run on a worker thread and take it for the audio
+//    thread.
+//---------------------------------------------------------
+
+static const unsigned MIN_VOICES_PER_GROUP = 8;
+
+int Fluid::prepareParallel(int maxGroups)
+{
+    _groups = 0;
+    if (_suspended) {
+        return 1;
+    }
+    _processing = true;
+    if (_suspended) {
+        _processing = false;
+        return 1;
+    }
+    _audioThread = QThread::currentThreadId();
+    while (!cmds.empty()) {
+        runCmd(cmds.dequeue());
+    }
+    startPendingNotes();
+    _groups   = qBound(1, int(activeVoices.size() / MIN_VOICES_PER_GROUP), maxGroups);
+    _parallel = true;
+    return _groups;
+}
+
+//---------------------------------------------------------
+//   processGroup
+//    may be called from any thread; the voice order within
+//    a group is the order of process()
+//---------------------------------------------------------
+
+void Fluid::processGroup(int group, unsigned len, float* out, float* effect1, float* effect2)
+{
+    if (group >= _groups) {
+        return;
+    }
+    const size_t n     = activeVoices.size();
+    const size_t begin = n * group / _groups;
+    const size_t end   = n * (group + 1) / _groups;
+    for (size_t i = begin; i < end; ++i) {
+        activeVoices[i]->write(len, out, effect1, effect2);
+    }
+}
+
+//---------------------------------------------------------
+//   finishParallel
+//    free the voices turned off by processGroup()
+//---------------------------------------------------------
+
+void Fluid::finishParallel()
+{
+    if (!_parallel) {
+        return;
+    }
+    _parallel = false;
+    size_t n = 0;
+    for (Voice* v : activeVoices) {
+        if (v->status == FLUID_VOICE_OFF) {
+            freeVoices.push_back(v);
+        } else {
+            activeVoices[n++] = v;
         }
-        mutex.unlock();
     }
+    activeVoices.resize(n);
+    releaseSamples();
+    _processing = false;
 }
 
 /*
@@ -521,17 +801,18 @@ Voice* Fluid::alloc_voice(unsigned id, Sample* sample, int chan, int key, int ve
     Channel* c = 0;
 
     /* check if there's an available synthesis process */
-    if (freeVoices.isEmpty()) {
+    if (freeVoices.empty()) {
         free_voice_by_kill();
     }
 
-    if (freeVoices.isEmpty()) {
+    if (freeVoices.empty()) {
         qDebug("Failed to allocate a synthesis process. (chan=%d,key=%d)", chan, key);
         return 0;
     }
 
-    Voice* v = freeVoices.takeLast();
-    activeVoices.append(v);
+    Voice* v = freeVoices.back();
+    freeVoices.pop_back();
+    activeVoices.push_back(v);
 
     if (chan >= 0) {
         c = channel[chan];
@@ -574,30 +855,30 @@ void Fluid::start_voice(Voice* voice)
     if (excl_class) {
         /* Kill all notes on the same channel with the same exclusive class */
 
-        for (Voice* existing_voice : activeVoices) {
+        forActiveVoices([voice, excl_class](Voice* existing_voice) {
             /* Existing voice does not play? Leave it alone. */
             if (!existing_voice->isPlaying()) {
-                continue;
+                return;
             }
 
             /* An exclusive class is valid for a whole channel (or preset).
              * Is the voice on a different channel? Leave it alone. */
             if (existing_voice->chan != voice->chan) {
-                continue;
+                return;
             }
 
             /* Existing voice has a different (or no) exclusive class? Leave it alone. */
             if ((int)existing_voice->GEN(GEN_EXCLUSIVECLASS) != excl_class) {
-                continue;
+                return;
             }
 
             /* Existing voice is a voice process belonging to this noteon
              * event (for example: stereo sample)?  Leave it alone. */
             if (existing_voice->get_id() == voice->get_id()) {
-                continue;
+                return;
             }
             existing_voice->kill_excl();
-        }
+        });
     }
     voice->voice_start();
 }
@@ -679,17 +960,15 @@ bool Fluid::loadSoundFonts(const QStringList& sl)
         qDebug("Fluid:loadSoundFonts: already loaded");
         return true;
     }
-    QMutexLocker locker(&mutex);
-    for (Voice* v : activeVoices) {
-        v->off();
-    }
+    suspend();
+    soundsOff(-1);
     for (Channel* c : channel) {
         c->reset();
     }
     for (SFont* sf : sfonts) {
         sfunload(sf->id());
     }
-    locker.unlock();
+    resume();
     bool ok = true;
 
     QFileInfoList l = sfFiles();
@@ -711,12 +990,12 @@ bool Fluid::loadSoundFonts(const QStringList& sl)
             qDebug("Fluid: sf <%s> not found", qPrintable(s));
             ok = false;
         } else {
-            locker.relock();
+            suspend();
             if (sfload(path) == -1) {
                 qDebug("loading sf failed: <%s>", qPrintable(path));
                 ok = false;
             }
-            locker.unlock();
+            resume();
         }
     }
     return ok;
@@ -729,8 +1008,9 @@ bool Fluid::loadSoundFonts(const QStringList& sl)
 
 bool Fluid::addSoundFont(const QString& s)
 {
-    QMutexLocker locker(&mutex);
+    suspend();
     bool rv = (sfload(s) == -1) ? false : true;
+    resume();
     return rv;
 }
 
@@ -741,17 +1021,14 @@ bool Fluid::addSoundFont(const QString& s)
 
 bool Fluid::removeSoundFont(const QString& s)
 {
-    QMutexLocker locker(&mutex);
-    for (Voice* v : activeVoices) {
-        v->off();
-    }
+    suspend();
+    soundsOff(-1);
     SFont* sf = get_sfont_by_name(s);
-    if (!sf) {
-        return false;
+    if (sf) {
+        sfunload(sf->id());
     }
-
-    sfunload(sf->id());
-    return true;
+    resume();
+    return sf != nullptr;
 }
 
 //---------------------------------------------------------
@@ -805,6 +1082,17 @@ bool Fluid::sfunload(int id)
     sfonts.removeAll(sf);     // remove the SoundFont from the list
     updatePatchList();
 
+    // nothing may refer to the presets and samples of sf
+    pendingNotes.erase(std::remove_if(pendingNotes.begin(), pendingNotes.end(), [sf](const PendingNote& p) {
+        return p.preset->sfont == sf;
+    }), pendingNotes.end());
+    for (Channel* c : channel) {
+        if (c->preset() && c->preset()->sfont == sf) {
+            c->setPreset(nullptr);
+        }
+    }
+    releaseSamples();
+
     delete sf;
     return true;
 }
@@ -21,8 +21,10 @@
 #ifndef __FLUID_S_H__
 #define __FLUID_S_H__
 
+#include <atomic>
 #include "audio/midi/synthesizer.h"
 #include "audio/midi/midipatch.h"
+#include "libmscore/fifo.h"
 
 namespace FluidS {
 using namespace Ms;
@@ -293,17 +295,66 @@ enum {
     FLUID_GROUP  = 0,
 };
 
+//---------------------------------------------------------
+//   FluidCmd
+//    voice command from a control thread, executed by the
+//    audio thread at the start of the next period
+//---------------------------------------------------------
+
+struct FluidCmd {
+    enum class Type : char {
+        ALL_NOTES_OFF, ALL_SOUNDS_OFF
+    };
+    Type type;
+    int channel;
+};
+
+//---------------------------------------------------------
+//   FluidCmdFifo
+//---------------------------------------------------------
+
+class FluidCmdFifo : public FifoBase
+{
+    static const int SIZE = 64;
+    FluidCmd cmds[SIZE];
+
+public:
+    FluidCmdFifo()
+    {
+        maxCount = SIZE;
+        clear();
+    }
+    bool enqueue(const FluidCmd& c)
+    {
+        if (isFull()) {
+            return false;
+        }
+        cmds[widx] = c;
+        push();
+        return true;
+    }
+    FluidCmd dequeue()
+    {
+        FluidCmd c = cmds[ridx];
+        pop();
+        return c;
+    }
+};
+
 //---------------------------------------------------------
 //   Fluid
 //---------------------------------------------------------
 
 class Fluid : public Synthesizer
 {
+    static const int MAX_VOICES = 512;
+
     QList<SFont*> sfonts;                 // the loaded soundfonts
     QList<MidiPatch*> patches;
 
-    QList<Voice*> freeVoices;             // unused synthesis processes
-    QList<Voice*> activeVoices;           // active synthesis processes
+    // fixed capacity voice pool, the audio thread never allocates
+    std::vector<Voice*> freeVoices;       // unused synthesis processes
+    std::vector<Voice*> activeVoices;     // active synthesis processes
     QString _error;                       // last error message
 
     static bool initialized;
@@ -315,7 +366,41 @@ class Fluid : public Synthesizer
     int _loadProgress = 0;
     bool _loadWasCanceled = false;
 
-    QMutex mutex;
+    QMutex mutex;                         // serializes soundfont changes
+    std::atomic<bool> _suspended { false };   // audio thread skips process()
+    std::atomic<bool> _processing { false };
+    std::atomic<Qt::HANDLE> _audioThread { nullptr };
+    FluidCmdFifo cmds;                    // single consumer: the audio thread
+    QMutex cmdMutex;                      // serializes the producers of cmds
+    bool _parallel { false };             // voices are rendered by processGroup()
+    int _groups { 0 };
+
+    // a note held back by a realtime synthesizer until the
+    // decoder has loaded its samples
+    struct PendingNote {
+        Preset* preset;
+        unsigned id;
+        int chan;
+        int key;
+        int vel;
+        double tuning;
+        unsigned periods;                 // audio periods waited
+        bool released;                    // note off came while waiting
+    };
+    static const size_t MAX_PENDING_NOTES = 256;
+    std::vector<PendingNote> pendingNotes;    // fixed capacity
+
+    void suspend();
+    void resume();
+    bool inAudioThread() const;
+    bool sendCmd(const FluidCmd&);
+    void runCmd(const FluidCmd&);
+    void notesOff(int chan);
+    void soundsOff(int chan);
+    template<typename F> void forActiveVoices(F f);
+    void startPendingNotes();
+    void dropPendingNotes(int chan);
+    void releaseSamples();
     void updatePatchList();
 
     //the variable is used to stop loading samples from the sf files
@@ -394,6 +479,9 @@ public:
     void free_voice_by_kill();
 
     virtual void process(unsigned len, float* out, float* effect1, float* effect2);
+    int prepareParallel(int maxGroups) override;
+    void processGroup(int group, unsigned len, float* out, float* effect1, float* effect2) override;
+    void finishParallel() override;
 
     bool program_select(int chan, unsigned sfont_id, unsigned bank_num, unsigned preset_num);
     void get_program(int chan, unsigned* sfont_id, unsigned* bank_num, unsigned* preset_num);
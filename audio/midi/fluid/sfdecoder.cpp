@@ -0,0 +1,289 @@
+//=============================================================================
+//  MuseScore
+//  Music Composition & Notation
+//
+//  Copyright (C) 2020 Werner Schweer
+//
+//  This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License version 2
+//  as published by the Free Software Foundation and appearing in
+//  the file LICENCE.GPL
+//=============================================================================
+
+#include <algorithm>
+#include "sfdecoder.h"
+#include "sfont.h"
+
+namespace FluidS {
+qint64 SampleDecoder::cacheBudget = (qEnvironmentVariableIsSet("MSCORE_SOUNDFONT_CACHE_MB")
+                                     ? qEnvironmentVariableIntValue("MSCORE_SOUNDFONT_CACHE_MB") : 256)
+                                    * qint64(1024 * 1024);
+
+//---------------------------------------------------------
+//   SampleDecoder
+//---------------------------------------------------------
+
+SampleDecoder::SampleDecoder()
+    : thread(&SampleDecoder::run, this)
+{
+}
+
+SampleDecoder::~SampleDecoder()
+{
+    mutex.lock();
+    stop = true;
+    mutex.unlock();
+    pending.release();
+    thread.join();
+}
+
+//---------------------------------------------------------
+//   instance
+//---------------------------------------------------------
+
+SampleDecoder& SampleDecoder::instance()
+{
+    static SampleDecoder decoder;
+    return decoder;
+}
+
+//---------------------------------------------------------
+//   run
+//---------------------------------------------------------
+
+void SampleDecoder::run()
+{
+    for (;;) {
+        pending.acquire();
+        if (trimRequested.exchange(false)) {
+            QMutexLocker cacheLocker(&cacheMutex);
+            trim();
+        }
+        QMutexLocker locker(&mutex);
+        if (stop) {
+            return;
+        }
+        Sample* s;
+        const unsigned t = urgentTail.load(std::memory_order_relaxed);
+        if (t != urgentHead.load(std::memory_order_acquire)) {
+            s = urgent[t % URGENT_SIZE];
+            urgentTail.store(t + 1, std::memory_order_release);
+        } else if (!queue.empty()) {
+            s = queue.front();
+            queue.pop_front();
+        } else {
+            continue;               // cancelled or only a trim
+        }
+        if (s->loaded()) {
+            continue;
+        }
+        busyFont = s->sf;
+        locker.unlock();
+
+        s->load();
+
+        locker.relock();
+        busyFont = nullptr;
+        idle.wakeAll();
+    }
+}
+
+//---------------------------------------------------------
+//   request
+//    decode s in the background
+//---------------------------------------------------------
+
+void SampleDecoder::request(Sample* s)
+{
+    if (s->loaded()) {
+        return;
+    }
+    QMutexLocker locker(&mutex);
+    queue.push_back(s);
+    pending.release();
+}
+
+//---------------------------------------------------------
+//   prioritize
+//    decode s before the queued samples; called from the
+//    audio thread, takes no lock. The request is dropped if
+//    the ring is full, the synthesizer asks again.
+//---------------------------------------------------------
+
+void SampleDecoder::prioritize(Sample* s)
+{
+    const unsigned h = urgentHead.load(std::memory_order_relaxed);
+    if (h - urgentTail.load(std::memory_order_acquire) >= URGENT_SIZE) {
+        return;
+    }
+    urgent[h % URGENT_SIZE] = s;
+    urgentHead.store(h + 1, std::memory_order_release);
+    pending.release();
+}
+
+//---------------------------------------------------------
+//   trimLater
+//    have the decoder thread unload the samples no longer
+//    in use; called from the audio thread when a preset is
+//    deselected
+//---------------------------------------------------------
+
+void SampleDecoder::trimLater()
+{
+    if (!trimRequested.exchange(true)) {
+        pending.release();
+    }
+}
+
+//---------------------------------------------------------
+//   cancel
+//    forget queued samples of sf and wait until no sample
+//    of sf is being decoded; called before sf is deleted,
+//    while its synthesizer does not play
+//---------------------------------------------------------
+
+void SampleDecoder::cancel(const SFont* sf)
+{
+    QMutexLocker locker(&mutex);
+    // the consumer side of the ring is only used with the mutex
+    // held; move the urgent requests of other fonts to the queue
+    std::deque<Sample*> keep;
+    for (unsigned t = urgentTail.load(); t != urgentHead.load(std::memory_order_acquire); ++t) {
+        Sample* s = urgent[t % URGENT_SIZE];
+        if (s->sf != sf) {
+            keep.push_back(s);
+        }
+        urgentTail.store(t + 1, std::memory_order_release);
+    }
+    queue.insert(queue.begin(), keep.begin(), keep.end());
+    queue.erase(std::remove_if(queue.begin(), queue.end(), [sf](Sample* s) { return s->sf == sf; }), queue.end());
+    while (busyFont == sf) {
+        idle.wait(&mutex);
+    }
+    locker.unlock();
+
+    QMutexLocker cacheLocker(&cacheMutex);
+    for (Entry& e : cache) {
+        e.holders.erase(std::remove_if(e.holders.begin(), e.holders.end(), [sf](Sample* s) { return s->sf == sf; }),
+                        e.holders.end());
+    }
+    trim();
+}
+
+//---------------------------------------------------------
+//   find
+//    return the decoded data of key and note that holder
+//    plays it
+//---------------------------------------------------------
+
+std::shared_ptr<DecodedSample> SampleDecoder::find(const QString& key, Sample* holder)
+{
+    QMutexLocker locker(&cacheMutex);
+    auto i = cache.find(key);
+    if (i == cache.end()) {
+        return nullptr;
+    }
+    lru.splice(lru.begin(), lru, i->lru);
+    if (holder) {
+        i->holders.push_back(holder);
+    }
+    return i->sample;
+}
+
+//---------------------------------------------------------
+//   insert
+//    add a decoded sample played by holder and trim the
+//    cache to the budget; returns the data cached for key,
+//    which is another one if a different thread decoded the
+//    same sample first
+//---------------------------------------------------------
+
+std::shared_ptr<DecodedSample> SampleDecoder::insert(const QString& key, const std::shared_ptr<DecodedSample>& sample,
+                                                     Sample* holder)
+{
+    QMutexLocker locker(&cacheMutex);
+    auto i = cache.find(key);
+    if (i == cache.end()) {
+        lru.push_front(key);
+        i = cache.insert(key, { sample, lru.begin(), {} });
+        cached += qint64(sample->data.size() * sizeof(short));
+    } else {
+        lru.splice(lru.begin(), lru, i->lru);
+    }
+    if (holder) {
+        i->holders.push_back(holder);
+    }
+    std::shared_ptr<DecodedSample> d = i->sample;
+    trim();
+    return d;
+}
+
+//---------------------------------------------------------
+//   trim
+//    unload the least recently used samples until the cache
+//    fits the budget; samples in use stay. Called with
+//    cacheMutex held.
+//---------------------------------------------------------
+
+void SampleDecoder::trim()
+{
+    auto i = lru.end();
+    while (cached > cacheBudget && i != lru.begin()) {
+        --i;
+        auto e = cache.find(*i);
+        std::vector<Sample*>& h = e->holders;
+        h.erase(std::remove_if(h.begin(), h.end(), [](Sample* s) { return s->unload(); }), h.end());
+        if (!h.empty()) {
+            continue;
+        }
+        cached -= qint64(e->sample->data.size() * sizeof(short));
+        cache.erase(e);
+        i = lru.erase(i);
+    }
+}
+
+//---------------------------------------------------------
+//   cachedBytes
+//    the size of all decoded samples
+//---------------------------------------------------------
+
+qint64 SampleDecoder::cachedBytes()
+{
+    QMutexLocker locker(&cacheMutex);
+    return cached;
+}
+
+//---------------------------------------------------------
+//   map
+//    map size bytes at offset of the file path; SFonts of
+//    the same file share the mapping
+//---------------------------------------------------------
+
+std::shared_ptr<MappedFile> SampleDecoder::map(const QString& path, qint64 offset, qint64 size)
+{
+    const QString key = QString("%1:%2:%3").arg(QFileInfo(path).canonicalFilePath()).arg(offset).arg(size);
+    QMutexLocker locker(&cacheMutex);
+    std::shared_ptr<MappedFile> m = files.value(key).lock();
+    if (m) {
+        return m;
+    }
+    for (auto i = files.begin(); i != files.end();) {
+        if (i.value().expired()) {
+            i = files.erase(i);
+        } else {
+            ++i;
+        }
+    }
+    m = std::make_shared<MappedFile>();
+    m->file.setFileName(path);
+    if (!m->file.open(QIODevice::ReadOnly)) {
+        return nullptr;
+    }
+    m->data = m->file.map(offset, size);
+    if (!m->data) {
+        return nullptr;
+    }
+    files.insert(key, m);
+    return m;
+}
+}
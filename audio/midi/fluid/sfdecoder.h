@@ -0,0 +1,119 @@
+//=============================================================================
+//  MuseScore
+//  Music Composition & Notation
+//
+//  Copyright (C) 2020 Werner Schweer
+//
+//  This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License version 2
+//  as published by the Free Software Foundation and appearing in
+//  the file LICENCE.GPL
+//=============================================================================
+
+#ifndef __SFDECODER_H__
+#define __SFDECODER_H__
+
+#include <atomic>
+#include <deque>
+#include <list>
+#include <memory>
+#include <thread>
+#include <vector>
+
+namespace FluidS {
+class SFont;
+class Sample;
+
+//---------------------------------------------------------
+//   DecodedSample
+//    an Ogg Vorbis sample of a SoundFont 3 file after
+//    decoding; shared by all Fluid instances using the font
+//---------------------------------------------------------
+
+struct DecodedSample {
+    std::vector<short> data;
+    unsigned int end       { 0 };
+    unsigned int loopstart { 0 };
+    unsigned int loopend   { 0 };
+    bool valid             { false };
+};
+
+//---------------------------------------------------------
+//   MappedFile
+//    the sample chunk of a SoundFont file, mapped once for
+//    all SFonts reading the file
+//---------------------------------------------------------
+
+struct MappedFile {
+    QFile file;
+    uchar* data { nullptr };
+};
+
+//---------------------------------------------------------
+//   SampleDecoder
+//    Decodes SoundFont 3 samples on a background thread when
+//    a preset is selected, so program changes do not block
+//    playback. Every decoded sample stays in a cache of
+//    cacheBudget bytes (taken from MSCORE_SOUNDFONT_CACHE_MB,
+//    default 256) as long as it exists. Beyond the budget the
+//    least recently used samples are unloaded, unless a
+//    selected preset or a sounding voice uses them; only the
+//    samples in use may exceed the budget.
+//
+//    A realtime synthesizer never loads samples itself: it
+//    hands them to prioritize(), which does not lock, and
+//    starts the notes once the decoder has loaded them.
+//---------------------------------------------------------
+
+class SampleDecoder
+{
+    struct Entry {
+        std::shared_ptr<DecodedSample> sample;
+        std::list<QString>::iterator lru;
+        std::vector<Sample*> holders;       // the samples playing this data
+    };
+
+    static const unsigned URGENT_SIZE = 4096;
+
+    QMutex mutex;                   // guards the queue, held by the consumer of urgent
+    QSemaphore pending;             // one for every request, prioritize and trimLater
+    QWaitCondition idle;
+    std::deque<Sample*> queue;
+    Sample* urgent[URGENT_SIZE];    // single producer (audio thread) ring
+    std::atomic<unsigned> urgentHead { 0 };
+    std::atomic<unsigned> urgentTail { 0 };
+    std::atomic<bool> trimRequested { false };
+    const SFont* busyFont { nullptr };
+    bool stop { false };
+
+    QMutex cacheMutex;              // guards the cache and the mapped files
+    std::list<QString> lru;         // most recently used first
+    QHash<QString, Entry> cache;
+    qint64 cached { 0 };
+    QHash<QString, std::weak_ptr<MappedFile> > files;
+
+    std::thread thread;             // started last, uses all of the above
+
+    SampleDecoder();
+    ~SampleDecoder();
+    void run();
+    void trim();
+
+public:
+    static qint64 cacheBudget;
+
+    static SampleDecoder& instance();
+
+    void request(Sample*);
+    void prioritize(Sample*);
+    void trimLater();
+    void cancel(const SFont*);
+
+    std::shared_ptr<DecodedSample> find(const QString& key, Sample* holder);
+    std::shared_ptr<DecodedSample> insert(const QString& key, const std::shared_ptr<DecodedSample>&, Sample* holder);
+    qint64 cachedBytes();
+
+    std::shared_ptr<MappedFile> map(const QString& path, qint64 offset, qint64 size);
+};
+}
+#endif
@@ -21,7 +21,16 @@
  * 02111-1307, USA
  */
 
+#include <cstring>
+
+#if defined(Q_OS_UNIX)
+#include <sys/mman.h>
+#elif defined(Q_OS_WIN)
+#include <windows.h>
+#endif
+
 #include "sfont.h"
+#include "sfdecoder.h"
 #include "fluid.h"
 #include "voice.h"
 
@@ -57,6 +66,7 @@ SFont::SFont(Fluid* f)
 
 SFont::~SFont()
 {
+    SampleDecoder::instance().cancel(this);
     for (Sample* s : sample) {
         delete s;
     }
@@ -73,6 +83,15 @@ SFont::~SFont()
     }
 }
 
+//---------------------------------------------------------
+//   sampleData
+//---------------------------------------------------------
+
+const uchar* SFont::sampleData() const
+{
+    return _map ? _map->data : nullptr;
+}
+
 //---------------------------------------------------------
 //   read
 //---------------------------------------------------------
@@ -146,6 +165,35 @@ Preset::~Preset()
     }
 }
 
+//---------------------------------------------------------
+//   forSamples
+//    call f for every sample of the instruments of p
+//---------------------------------------------------------
+
+template<typename F>
+static void forSamples(Preset* p, F f)
+{
+    auto instrument = [&f](Instrument* i) {
+        if (!i) {
+            return;
+        }
+        if (i->global_zone && i->global_zone->sample) {
+            f(i->global_zone->sample);
+        }
+        for (Zone* iz : i->zones) {
+            if (iz->sample) {
+                f(iz->sample);
+            }
+        }
+    };
+    if (p->_global_zone) {
+        instrument(p->_global_zone->instrument);
+    }
+    for (Zone* z : p->zones) {
+        instrument(z->instrument);
+    }
+}
+
 //---------------------------------------------------------
 //   loadSamples
 //    this is called if the preset is associated with a
@@ -154,16 +202,38 @@ Preset::~Preset()
 
 void Preset::loadSamples()
 {
-    bool locked = sfont->synth->mutex.tryLock();
+    // keep the samples loaded while the preset is selected; pin
+    // them before checking whether they are loaded, the decoder
+    // unloads a sample only if it finds it unpinned
+    forSamples(this, [](Sample* s) { s->pin(); });
+
+    // SoundFont 3 samples are decoded in the background,
+    // uncompressed ones are played from the mapped file. A
+    // realtime synthesizer selects presets from the audio
+    // thread, there even uncompressed samples are left to the
+    // decoder thread: loading touches every page of the data.
+    const bool realtime = sfont->synth->realtime();
+    auto load = [realtime](Sample* s) {
+        if (!s || s->loaded()) {
+            return;
+        }
+        if (realtime) {
+            SampleDecoder::instance().prioritize(s);
+        } else if (s->sampletype & FLUID_SAMPLETYPE_OGG_VORBIS) {
+            SampleDecoder::instance().request(s);
+        } else {
+            s->load();
+        }
+    };
 
     if (_global_zone && _global_zone->instrument) {
         Instrument* i = _global_zone->instrument;
         if (i->global_zone && i->global_zone->sample) {
-            i->global_zone->sample->load();
+            load(i->global_zone->sample);
         }
 
         for (Zone* iz : i->zones) {
-            iz->sample->load();
+            load(iz->sample);
         }
     }
 
@@ -173,24 +243,55 @@ void Preset::loadSamples()
         sfont->synth->setLoadProgress(currentInstrZone++ / instrSize * 100);
         Instrument* i = z->instrument;
         if (i->global_zone && i->global_zone->sample) {
-            i->global_zone->sample->load();
+            load(i->global_zone->sample);
         }
 
         for (Zone* iz : i->zones) {
             if (sfont->synth->globalTerminate()) {
-                if (locked) {
-                    sfont->synth->mutex.unlock();
-                }
                 return;
             }
 
-            iz->sample->load();
+            load(iz->sample);
         }
     }
+}
+
+//---------------------------------------------------------
+//   releaseSamples
+//    the preset is no longer associated with a channel
+//---------------------------------------------------------
 
-    if (locked) {
-        sfont->synth->mutex.unlock();
+void Preset::releaseSamples()
+{
+    forSamples(this, [](Sample* s) { s->unpin(); });
+    SampleDecoder::instance().trimLater();
+}
+
+//---------------------------------------------------------
+//   samplesLoaded
+//    whether all samples for key and vel are loaded; if
+//    request, have the decoder load the missing ones next
+//---------------------------------------------------------
+
+bool Preset::samplesLoaded(int key, int vel, bool request)
+{
+    bool loaded = true;
+    for (Zone* preset_zone : zones) {
+        if (!preset_zone->inside_range(key, vel)) {
+            continue;
+        }
+        for (Zone* inst_zone : preset_zone->get_inst()->zones) {
+            Sample* sample = inst_zone->get_sample();
+            if (!sample || sample->inRom() || sample->loaded() || !inst_zone->inside_range(key, vel)) {
+                continue;
+            }
+            if (request) {
+                    SampleDecoder::instance().prioritize(sample);
+            }
+            loaded = false;
+        }
     }
+    return loaded;
 }
 
 //---------------------------------------------------------
@@ -222,6 +323,22 @@ bool Preset::noteon(Fluid* synth, unsigned id, int chan, int key, int vel, doubl
                 /* check if the note falls into the key and velocity range of this
                    instrument */
                 if (inst_zone->inside_range(key, vel) && (sample != 0)) {
+                    /* the background decoder did not get to the sample
+                       yet: load it now, or on the audio thread skip the
+                       zone and have the decoder load it next. A realtime
+                       synthesizer holds the note back until
+                       samplesLoaded(), this is only a safeguard. */
+                    if (!sample->loaded()) {
+                        if (synth->realtime()) {
+                            SampleDecoder::instance().prioritize(sample);
+                            continue;
+                        }
+                        sample->load();
+                    }
+                    if (!sample->data) {
+                        continue;
+                    }
+
                     /* this is a good zone. allocate a new synthesis process and
                        initialize it */
 
@@ -643,65 +760,176 @@ Sample::Sample(SFont* s)
 
 //---------------------------------------------------------
 //   Sample
+//    locked mapped data is not unlocked here: the mapping is
+//    shared with the other SFonts of the file and locks do
+//    not nest, it is unlocked when it is unmapped
 //---------------------------------------------------------
 
 Sample::~Sample()
 {
-    delete[] data;
+    if (_ownsData) {
+        delete[] data;
+    }
+}
+
+//---------------------------------------------------------
+//   lockData
+//    keep sample data played from the mapped font file in
+//    memory, so that the audio thread does not take page
+//    faults; best effort, fails beyond the lock limit of
+//    the process
+//---------------------------------------------------------
+
+void Sample::lockData(qint64 size)
+{
+#if defined(Q_OS_UNIX)
+    _locked = mlock(data, size) == 0;
+#elif defined(Q_OS_WIN)
+    _locked = VirtualLock(data, size);
+#else
+    Q_UNUSED(size);
+#endif
 }
 
 //---------------------------------------------------------
 //   load
+//    may be called from several threads; returns when the
+//    sample data is available
 //---------------------------------------------------------
 
 void Sample::load()
 {
-    if (!_valid || data) {
-        return;
+    for (;;) {
+        int state = _loadState;
+        if (state == LOADED) {
+            return;
+        }
+        if (state == UNLOADED && _loadState.compare_exchange_strong(state, LOADING)) {
+            break;
+        }
+        // being loaded or unloaded by another thread
+        QThread::yieldCurrentThread();
+    }
+    loadData();
+    _loadState = LOADED;
+}
+
+//---------------------------------------------------------
+//   unload
+//    drop the decoded data of a SoundFont 3 sample if no
+//    selected preset and no voice uses it; called by the
+//    SampleDecoder to keep its cache within the budget
+//---------------------------------------------------------
+
+bool Sample::unload()
+{
+    int state = LOADED;
+    if (!_loadState.compare_exchange_strong(state, UNLOADING)) {
+        return false;
+    }
+    // pin() comes before loaded() on the audio thread: either it
+    // sees UNLOADING and waits for the decoder, or we see the pin
+    if (_pins || _users) {
+        _loadState = LOADED;
+        return false;
+    }
+    data      = nullptr;
+    start     = _header.start;
+    end       = _header.end;
+    loopstart = _header.loopstart;
+    loopend   = _header.loopend;
+    _valid    = _header.valid;
+    _decoded.reset();
+    _loadState = UNLOADED;
+    return true;
+}
+
+//---------------------------------------------------------
+//   readData
+//    point src to size bytes of sample data at offset,
+//    reading them into buf if the font is not mapped
+//---------------------------------------------------------
+
+bool Sample::readData(unsigned offset, unsigned size, std::vector<char>& buf, const char*& src)
+{
+    if (const uchar* map = sf->sampleData()) {
+        if (qint64(offset) + size > sf->getSamplesize()) {
+            return false;
+        }
+        src = reinterpret_cast<const char*>(map + offset);
+        return true;
     }
     QFile fd(sf->get_name());
     if (!fd.open(QIODevice::ReadOnly)) {
-        return;
+        return false;
     }
-    if (sampletype & FLUID_SAMPLETYPE_OGG_VORBIS) {
-        if (!fd.seek(sf->samplePos() + start)) {
-            return;
-        }
-    } else {
-        if (!fd.seek(sf->samplePos() + start * sizeof(short))) {
-            return;
-        }
+    if (!fd.seek(sf->samplePos() + offset)) {
+        return false;
+    }
+    buf.resize(size);
+    if (fd.read(buf.data(), size) != size) {
+        qDebug("read %d failed", size);
+        return false;
+    }
+    src = buf.data();
+    return true;
+}
+
+//---------------------------------------------------------
+//   loadData
+//---------------------------------------------------------
+
+void Sample::loadData()
+{
+    if (!_valid || data) {
+        return;
     }
     unsigned int size = end - start;
+    std::vector<char> buf;
+    const char* src = nullptr;
 
     if (sampletype & FLUID_SAMPLETYPE_OGG_VORBIS) {
 #ifdef SOUNDFONT3
-        std::vector<char> p;
-        p.resize(size);
-        if (fd.read(p.data(), size) != size) {
-            qDebug("read %d failed", size);
-            return;
+        const QString key = QString("%1:%2").arg(sf->get_name()).arg(start);
+        std::shared_ptr<DecodedSample> d = SampleDecoder::instance().find(key, this);
+        if (!d) {
+            if (!readData(start, size, buf, src)) {
+                return;
+            }
+            d = std::make_shared<DecodedSample>();
+            decompressOggVorbis(src, size, *d);
+            d = SampleDecoder::instance().insert(key, d, this);
         }
-        decompressOggVorbis(p.data(), size);
+        _header   = { start, end, loopstart, loopend, _valid };
+        _decoded  = d;
+        data      = d->data.empty() ? nullptr : const_cast<short*>(d->data.data());
+        start     = 0;
+        end       = d->end;
+        loopstart = d->loopstart;
+        loopend   = d->loopend;
+        _valid    = d->valid;
 #endif
     } else {
-        data = new short[size];
-        size *= sizeof(short);
-
-        if (fd.read((char*)data, size) != size) {
+        if (!readData(start * sizeof(short), size * sizeof(short), buf, src)) {
             return;
         }
-
-        if (QSysInfo::ByteOrder == QSysInfo::BigEndian) {
-            unsigned char hi, lo;
-            unsigned int i, j;
-            short s;
-            uchar* cbuf = (uchar*)data;
-            for (i = 0, j = 0; j < size; i++) {
-                lo = cbuf[j++];
-                hi = cbuf[j++];
-                s = (hi << 8) | lo;
-                data[i] = s;
+        if (QSysInfo::ByteOrder == QSysInfo::LittleEndian && sf->sampleData()) {
+            // play directly from the mapped file; locking also
+            // faults the pages in, here and not in the audio thread
+            data = reinterpret_cast<short*>(const_cast<char*>(src));
+            lockData(qint64(size) * sizeof(short));
+        } else {
+            data      = new short[size];
+            _ownsData = true;
+            if (QSysInfo::ByteOrder == QSysInfo::BigEndian) {
+                const uchar* cbuf = reinterpret_cast<const uchar*>(src);
+                for (unsigned int i = 0, j = 0; i < size; i++) {
+                    unsigned char lo = cbuf[j++];
+                    unsigned char hi = cbuf[j++];
+                    data[i] = (hi << 8) | lo;
+                }
+            } else {
+                memcpy(data, src, size * sizeof(short));
             }
         }
         end       -= (start + 1);           // marks last sample, contrary to SF spec.
@@ -823,6 +1051,9 @@ bool SFont::load()
         return false;
     }
     f.close();
+    if (samplesize) {
+        _map = SampleDecoder::instance().map(f.fileName(), samplepos, samplesize);
+    }
     /* sort preset list by bank, preset # */
     std::sort(presets.begin(), presets.end(), preset_compare);
     return true;
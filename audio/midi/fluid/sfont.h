@@ -23,6 +23,8 @@
 #ifndef _FLUID_DEFSFONT_H
 #define _FLUID_DEFSFONT_H
 
+#include <atomic>
+#include <memory>
 #include "config.h"
 #include "fluid.h"
 
@@ -34,6 +36,8 @@ struct SFGen;
 struct SFMod;
 
 struct SFChunk;
+struct DecodedSample;
+struct MappedFile;
 
 //---------------------------------------------------------
 //   SFVersion
@@ -54,6 +58,7 @@ class SFont
     QFile f;
     unsigned samplepos;             // the position in the file at which the sample data starts
     unsigned samplesize;            // the size of the sample data
+    std::shared_ptr<MappedFile> _map;   // mapped sample data, null if mapping failed
 
     QList<Instrument*> instruments;
     QList<Preset*> presets;
@@ -116,6 +121,7 @@ public:
     void setSamplepos(unsigned v) { samplepos = v; }
     void setSamplesize(unsigned v) { samplesize = v; }
     unsigned getSamplesize() const { return samplesize; }
+    const uchar* sampleData() const;
     const QList<Preset*> getPresets() const { return presets; }
     SFVersion version() const { return _version; }
     int bankOffset() const { return _bankOffset; }
@@ -131,7 +137,29 @@ public:
 
 class Sample
 {
+    enum LoadState {
+        UNLOADED, LOADING, LOADED, UNLOADING
+    };
+
+    // the sample header of a SoundFont 3 sample, restored when
+    // the decoded data is unloaded
+    struct Header {
+        unsigned int start, end, loopstart, loopend;
+        bool valid;
+    };
+
     bool _valid;
+    bool _ownsData { false };
+    bool _locked { false };                       // mapped data locked in memory
+    std::atomic<int> _loadState { UNLOADED };
+    std::atomic<int> _pins { 0 };                 // selected presets using the sample
+    std::atomic<int> _users { 0 };                // voices playing the sample
+    std::shared_ptr<DecodedSample> _decoded;      // SoundFont 3 data, shared through SampleDecoder
+    Header _header;
+
+    bool readData(unsigned offset, unsigned size, std::vector<char>& buf, const char*& src);
+    void loadData();
+    void lockData(qint64 size);
 
 public:
     SFont* sf;
@@ -160,10 +188,16 @@ public:
     bool inRom() const;
     void optimize();
     void load();
+    bool unload();
+    bool loaded() const { return _loadState == LOADED; }
+    void pin() { ++_pins; }
+    void unpin() { --_pins; }
+    void addUser() { ++_users; }
+    void removeUser() { --_users; }
     bool valid() const { return _valid; }
     void setValid(bool v) { _valid = v; }
 #ifdef SOUNDFONT3
-    bool decompressOggVorbis(char* p, int size);
+    bool decompressOggVorbis(const char* p, int size, DecodedSample& d) const;
 #endif
 };
 
@@ -244,6 +278,8 @@ public:
 
     Zone* global_zone() { return _global_zone; }
     void loadSamples();
+    void releaseSamples();
+    bool samplesLoaded(int key, int vel, bool request);
     QList<Zone*> getZones() { return zones; }
 };
 
@@ -2,6 +2,7 @@
 #include <stdlib.h>
 #include <math.h>
 #include "sfont.h"
+#include "sfdecoder.h"
 #include "audiofile/audiofile.h"
 
 namespace FluidS {
@@ -9,39 +10,40 @@ namespace FluidS {
 //   decompressOggVorbis
 //---------------------------------------------------------
 
-bool Sample::decompressOggVorbis(char* src, int size)
+bool Sample::decompressOggVorbis(const char* src, int size, DecodedSample& d) const
 {
     AudioFile af;
     QByteArray ba(src, size);
 
-    start = 0;
-    end   = 0;
+    d.end       = 0;
+    d.loopstart = loopstart;
+    d.loopend   = loopend;
+    d.valid     = _valid;
     if (!af.open(ba)) {
         qDebug("Sample::decompressOggVorbis: open failed: %s", af.error());
         return false;
     }
     int frames = af.frames();
-    data = new short[frames * af.channels()];
-    if (frames != af.readData(data, frames)) {
+    d.data.resize(frames * af.channels());
+    if (frames != af.readData(d.data.data(), frames)) {
         qDebug("Sample read failed: %s", af.error());
-        delete[] data;
-        data = 0;
+        d.data.clear();
     }
-    end = frames - 1;
+    d.end = frames - 1;
 
-    if (loopend > end || loopstart >= loopend || loopstart <= start) {
+    if (d.loopend > d.end || d.loopstart >= d.loopend || d.loopstart <= 0) {
         /* can pad loop by 8 samples and ensure at least 4 for loop (2*8+4) */
-        if ((end - start) >= 20) {
-            loopstart = start + 8;
-            loopend = end - 8;
+        if (d.end >= 20) {
+            d.loopstart = 8;
+            d.loopend = d.end - 8;
         } else {   // loop is fowled, sample is tiny (can't pad 8 samples)
-            loopstart = start + 1;
-            loopend = end - 1;
+            d.loopstart = 1;
+            d.loopend = d.end - 1;
         }
     }
-    if ((end - start) < 8) {
+    if (d.end < 8) {
         qDebug("invalid sample");
-        setValid(false);
+        d.valid = false;
     }
 
     return true;
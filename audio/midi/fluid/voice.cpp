@@ -143,6 +143,9 @@ void Voice::init(Sample* _sample, Channel* _channel, int _key, int _vel,
     channel        = _channel;
     mod_count      = 0;
     sample         = _sample;
+    releaseSample();
+    _usedSample    = _sample;
+    _usedSample->addUser();
     ticks          = 0;
     debug          = 0;
     has_looped     = false;   // Will be set during voice_write when the 2nd loop point is reached
@@ -1540,6 +1543,21 @@ void Voice::off()
     _initialCacheFrames = 0;
 }
 
+//---------------------------------------------------------
+//   releaseSample
+//    stop counting as a user of the sample, which may then be
+//    unloaded; called for voices turned off once they are no
+//    longer rendered
+//---------------------------------------------------------
+
+void Voice::releaseSample()
+{
+    if (_usedSample) {
+        _usedSample->removeUser();
+        _usedSample = nullptr;
+    }
+}
+
 /*
  * fluid_voice_add_mod
  *
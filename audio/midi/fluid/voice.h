@@ -68,6 +68,7 @@ class Voice
 
     Fluid* _fluid;
     double _noteTuning;               // +/- in midicent
+    Sample* _usedSample = nullptr;    // counted as a user of the sample until releaseSample()
 
     //keeps number of frames that are now in cache
     //Cached frames are the frames that are calculated in terms of DSP (digital sound processing) and interpolated.
@@ -222,6 +223,7 @@ public:
     void voice_start();
     void off();
     void init(Sample*, Channel*, int key, int vel, unsigned id, double tuning);
+    void releaseSample();
     void gen_incr(int i, float val);
     void gen_set(int i, float val);
     float gen_get(int gen);
@@ -13,6 +13,8 @@ set (FLUID_SRC
     ${FLUID_DIR}/gen.cpp
     ${FLUID_DIR}/gen.h
     ${FLUID_DIR}/mod.cpp
+    ${FLUID_DIR}/sfdecoder.cpp
+    ${FLUID_DIR}/sfdecoder.h
     ${FLUID_DIR}/sfont.cpp
     ${FLUID_DIR}/sfont.h
     ${FLUID_DIR}/sfont3.cpp
@@ -39,6 +41,8 @@ if (ZERBERUS)
         ${ZERBERUS_DIR}/instrument.cpp
         ${ZERBERUS_DIR}/instrument.h
         ${ZERBERUS_DIR}/sample.h
+        ${ZERBERUS_DIR}/samplecache.cpp
+        ${ZERBERUS_DIR}/samplecache.h
         ${ZERBERUS_DIR}/sfz.cpp
         ${ZERBERUS_DIR}/voice.cpp
         ${ZERBERUS_DIR}/voice.h
@@ -59,6 +63,8 @@ set (MIDI_SRC
     ${FLUID_SRC}
     ${ZERBERUS_SRC}
 
+    ${CMAKE_CURRENT_LIST_DIR}/dsppool.cpp
+    ${CMAKE_CURRENT_LIST_DIR}/dsppool.h
     ${CMAKE_CURRENT_LIST_DIR}/event.cpp
     ${CMAKE_CURRENT_LIST_DIR}/event.h
     ${CMAKE_CURRENT_LIST_DIR}/midifile.cpp
@@ -68,6 +74,8 @@ set (MIDI_SRC
     ${CMAKE_CURRENT_LIST_DIR}/midipatch.h
     ${CMAKE_CURRENT_LIST_DIR}/msynthesizer.cpp
     ${CMAKE_CURRENT_LIST_DIR}/msynthesizer.h
+    ${CMAKE_CURRENT_LIST_DIR}/realtimecheck.cpp
+    ${CMAKE_CURRENT_LIST_DIR}/realtimecheck.h
     ${CMAKE_CURRENT_LIST_DIR}/synthesizer.h
     ${CMAKE_CURRENT_LIST_DIR}/synthesizergui.cpp
     ${CMAKE_CURRENT_LIST_DIR}/synthesizergui.h
@@ -13,6 +13,8 @@
 #include "config.h"
 #include "synthesizer.h"
 #include "msynthesizer.h"
+#include "realtimecheck.h"
+#include "dsppool.h"
 #include "synthesizergui.h"
 #include "libmscore/xml.h"
 
@@ -66,6 +68,7 @@ void MasterSynthesizer::init()
 
 MasterSynthesizer::~MasterSynthesizer()
 {
+    delete _dspPool;
     for (Synthesizer* s : _synthesizer) {
         delete s;
     }
@@ -77,6 +80,17 @@ MasterSynthesizer::~MasterSynthesizer()
     }
 }
 
+//---------------------------------------------------------
+//   setRealtime
+//---------------------------------------------------------
+
+void MasterSynthesizer::setRealtime(bool val)
+{
+    for (Synthesizer* s : _synthesizer) {
+        s->setRealtime(val);
+    }
+}
+
 //---------------------------------------------------------
 //   reset
 //---------------------------------------------------------
@@ -221,6 +235,7 @@ bool MasterSynthesizer::hasSoundFontsLoaded() const
 
 void MasterSynthesizer::registerSynthesizer(Synthesizer* s)
 {
+    Q_ASSERT(!_dspPool);          // the buses are allocated by setDspThreads()
     _synthesizer.push_back(s);
 }
 
@@ -288,12 +303,114 @@ void MasterSynthesizer::setSampleRate(float val)
     lock1 = false;
 }
 
+//---------------------------------------------------------
+//   setDspThreads
+//    render the synthesizers on n threads including the
+//    audio thread; call after all synthesizers are
+//    registered
+//---------------------------------------------------------
+
+void MasterSynthesizer::setDspThreads(int n)
+{
+    n = qBound(1, n, 64);
+    if (n == _dspThreads && (n == 1 || _dspPool)) {
+        return;
+    }
+    const bool locked = lock2;
+    lock2 = true;
+    while (lock1) {
+        QThread::msleep(1);
+    }
+    delete _dspPool;
+    _dspPool = nullptr;
+    _dspTasks.clear();
+    _dspBuses.clear();
+    _dspThreads = n;
+    if (n > 1) {
+        const size_t tasks = _synthesizer.size() * n;
+        _dspPool = new DspPool(n - 1);
+        _dspTasks.reserve(tasks);
+        _dspBuses.assign(tasks * 3 * MAX_BUFFERSIZE, 0.0f);
+    }
+    lock2 = locked;
+}
+
+//---------------------------------------------------------
+//   renderTask
+//    runs on any thread of the pool
+//---------------------------------------------------------
+
+void MasterSynthesizer::renderTask(void* ctx, int idx)
+{
+    MasterSynthesizer* ms = static_cast<MasterSynthesizer*>(ctx);
+    const DspTask& t = ms->_dspTasks[idx];
+    const unsigned n = ms->_dspFrames;
+    float* out = t.bus;
+    float* e1  = t.bus + MAX_BUFFERSIZE;
+    float* e2  = t.bus + 2 * MAX_BUFFERSIZE;
+    memset(out, 0, n * 2 * sizeof(float));
+    memset(e1, 0, n * 2 * sizeof(float));
+    memset(e2, 0, n * 2 * sizeof(float));
+    if (t.group < 0) {
+        t.synti->process(n, out, e1, e2);
+    } else {
+        t.synti->processGroup(t.group, n, out, e1, e2);
+    }
+}
+
+//---------------------------------------------------------
+//   processParallel
+//    The buses are mixed in task order, so the result does
+//    not depend on which thread rendered which task.
+//---------------------------------------------------------
+
+void MasterSynthesizer::processParallel(unsigned n, float* p)
+{
+    _dspTasks.clear();
+    float* bus = _dspBuses.data();
+    for (Synthesizer* s : _synthesizer) {
+        if (!s->active()) {
+            continue;
+        }
+        const int groups = s->prepareParallel(_dspThreads);
+        if (groups == 0) {
+            _dspTasks.push_back({ s, -1, bus });
+            bus += 3 * MAX_BUFFERSIZE;
+        }
+        for (int g = 0; g < groups; ++g) {
+            _dspTasks.push_back({ s, g, bus });
+            bus += 3 * MAX_BUFFERSIZE;
+        }
+    }
+    _dspFrames = n;
+    _dspPool->run(&MasterSynthesizer::renderTask, this, int(_dspTasks.size()));
+
+    for (const DspTask& t : _dspTasks) {
+        const float* out = t.bus;
+        const float* e1  = t.bus + MAX_BUFFERSIZE;
+        const float* e2  = t.bus + 2 * MAX_BUFFERSIZE;
+        for (unsigned i = 0; i < n * 2; ++i) {
+            p[i]             += out[i];
+            effect1Buffer[i] += e1[i];
+            effect2Buffer[i] += e2[i];
+        }
+    }
+    Synthesizer* last = nullptr;
+    for (const DspTask& t : _dspTasks) {
+        if (t.synti != last) {
+            t.synti->finishParallel();
+            last = t.synti;
+        }
+    }
+}
+
 //---------------------------------------------------------
 //   process
 //---------------------------------------------------------
 
 void MasterSynthesizer::process(unsigned n, float* p)
 {
+    RealtimeScope realtime;
     if (lock2) {
         return;
     }
@@ -306,12 +423,29 @@ void MasterSynthesizer::process(unsigned n, float* p)
     if (n > MAX_BUFFERSIZE / 2) {
         return;
     }
-    for (Synthesizer* s : _synthesizer) {
-        if (s->active()) {
-            s->process(n, p, effect1Buffer, effect2Buffer);
+    if (_dspPool) {
+        processParallel(n, p);
+    } else {
+        for (Synthesizer* s : _synthesizer) {
+            if (s->active()) {
+                s->process(n, p, effect1Buffer, effect2Buffer);
+            }
         }
     }
 
+    if (!_dry) {
+        processEffects(n, p);
+    }
+    lock1 = false;
+}
+
+//---------------------------------------------------------
+//   processEffects
+//    apply the master effects and gain to n frames of p
+//---------------------------------------------------------
+
+void MasterSynthesizer::processEffects(unsigned n, float* p)
+{
     if (_effect[0] && _effect[1]) {
         memset(effect1Buffer, 0, n * sizeof(float) * 2);
         _effect[0]->process(n, p, effect1Buffer);
@@ -328,7 +462,6 @@ void MasterSynthesizer::process(unsigned n, float* p)
     for (unsigned i = 0; i < n * 2; ++i) {
         *p++ *= g;
     }
-    lock1 = false;
 }
 
 //---------------------------------------------------------
@@ -23,6 +23,7 @@ class NPlayEvent;
 class Synthesizer;
 class Effect;
 class Xml;
+class DspPool;
 
 //---------------------------------------------------------
 //   MasterSynthesizer
@@ -60,6 +61,23 @@ private:
 
     float effect1Buffer[MAX_BUFFERSIZE];
     float effect2Buffer[MAX_BUFFERSIZE];
+
+    // multi-threaded rendering; every task renders into its own
+    // bus of out, effect1 and effect2 buffers
+    struct DspTask {
+        Synthesizer* synti;
+        int group;              // -1: call Synthesizer::process()
+        float* bus;
+    };
+    bool _dry                     { false };
+    int _dspThreads               { 1 };
+    DspPool* _dspPool             { nullptr };
+    std::vector<DspTask> _dspTasks;
+    std::vector<float> _dspBuses;
+    unsigned _dspFrames           { 0 };
+
+    static void renderTask(void* ctx, int idx);
+    void processParallel(unsigned n, float* p);
     int indexOfEffect(int ab, const QString& name);
     float convertGainToDecibels(float gain) const;
 
@@ -84,6 +102,17 @@ public:
     void process(unsigned, float*);
     void play(const NPlayEvent&, unsigned);
 
+    // a dry synthesizer leaves out the master effects and gain,
+    // the caller applies them with processEffects() after mixing
+    bool dry() const { return _dry; }
+    void setDry(bool val) { _dry = val; }
+    void processEffects(unsigned, float*);
+
+    int dspThreads() const { return _dspThreads; }
+    void setDspThreads(int);
+
+    void setRealtime(bool);
+
     void setMasterTuning(double val);
     double masterTuning() const { return _masterTuning; }
 
@@ -0,0 +1,106 @@
+//=============================================================================
+//  MuseScore
+//  Music Composition & Notation
+//
+//  Copyright (C) 2020 Werner Schweer
+//
+//  This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License version 2
+//  as published by the Free Software Foundation and appearing in
+//  the file LICENCE.GPL
+//=============================================================================
+
+#include "realtimecheck.h"
+
+#ifdef AUDIO_REALTIME_CHECK
+
+#include <cstdlib>
+#include <new>
+
+static thread_local int realtimeDepth = 0;
+
+//---------------------------------------------------------
+//   realtimeViolation
+//---------------------------------------------------------
+
+static void realtimeViolation(const char* what)
+{
+    realtimeDepth = 0;        // qFatal itself allocates
+    qFatal("%s in the audio thread", what);
+}
+
+//---------------------------------------------------------
+//   global allocation functions
+//    replaced only in checking builds
+//---------------------------------------------------------
+
+void* operator new(std::size_t n)
+{
+    if (realtimeDepth) {
+        realtimeViolation("memory allocation");
+    }
+    void* p = std::malloc(n ? n : 1);
+    if (!p) {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+void* operator new[](std::size_t n)
+{
+    return operator new(n);
+}
+
+void operator delete(void* p) noexcept
+{
+    if (p && realtimeDepth) {
+        realtimeViolation("memory deallocation");
+    }
+    std::free(p);
+}
+
+void operator delete[](void* p) noexcept
+{
+    operator delete(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept
+{
+    operator delete(p);
+}
+
+void operator delete[](void* p, std::size_t) noexcept
+{
+    operator delete(p);
+}
+
+namespace Ms {
+//---------------------------------------------------------
+//   RealtimeScope
+//---------------------------------------------------------
+
+RealtimeScope::RealtimeScope()
+{
+    ++realtimeDepth;
+}
+
+RealtimeScope::~RealtimeScope()
+{
+    if (realtimeDepth) {
+        --realtimeDepth;
+    }
+}
+
+//---------------------------------------------------------
+//   realtimeLockCheck
+//---------------------------------------------------------
+
+void realtimeLockCheck()
+{
+    if (realtimeDepth) {
+        realtimeViolation("lock");
+    }
+}
+}     // namespace Ms
+
+#endif
@@ -0,0 +1,52 @@
+//=============================================================================
+//  MuseScore
+//  Music Composition & Notation
+//
+//  Copyright (C) 2020 Werner Schweer
+//
+//  This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License version 2
+//  as published by the Free Software Foundation and appearing in
+//  the file LICENCE.GPL
+//=============================================================================
+
+#ifndef __REALTIMECHECK_H__
+#define __REALTIMECHECK_H__
+
+#include "config.h"
+
+namespace Ms {
+//---------------------------------------------------------
+//   RealtimeScope
+//    marks the current thread as running the audio
+//    callback while the object exists. If built with
+//    AUDIO_REALTIME_CHECK, allocating or freeing memory or
+//    calling realtimeLockCheck() inside the scope aborts.
+//---------------------------------------------------------
+
+class RealtimeScope
+{
+public:
+#ifdef AUDIO_REALTIME_CHECK
+    RealtimeScope();
+    ~RealtimeScope();
+#else
+    RealtimeScope() {}
+#endif
+    RealtimeScope(const RealtimeScope&) = delete;
+    RealtimeScope& operator=(const RealtimeScope&) = delete;
+};
+
+//---------------------------------------------------------
+//   realtimeLockCheck
+//    call before taking a lock which the audio thread
+//    must never wait for
+//---------------------------------------------------------
+
+#ifdef AUDIO_REALTIME_CHECK
+extern void realtimeLockCheck();
+#else
+inline void realtimeLockCheck() {}
+#endif
+}     // namespace Ms
+#endif
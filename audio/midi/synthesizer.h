@@ -42,6 +42,7 @@ struct SoundFontInfo {
 class Synthesizer
 {
     bool _active;
+    bool _realtime { false };
 
 protected:
     float _sampleRate { 44100.0f };
@@ -68,6 +69,15 @@ public:
     virtual void process(unsigned, float*, float*, float*) = 0;
     virtual void play(const PlayEvent&) = 0;
 
+    // Rendering a period on several threads: prepareParallel() splits
+    // the work into at most maxGroups independent groups and returns their
+    // number, 0 if process() should be called instead. processGroup() may
+    // then run concurrently for different groups, finishParallel() is
+    // called on the audio thread after all groups are done.
+    virtual int prepareParallel(int /*maxGroups*/) { return 0; }
+    virtual void processGroup(int /*group*/, unsigned, float*, float*, float*) {}
+    virtual void finishParallel() {}
+
     virtual const QList<MidiPatch*>& getPatchInfo() const = 0;
 
     // get/set synthesizer state
@@ -80,6 +90,11 @@ public:
     bool active() const { return _active; }
     void setActive(bool val = true) { _active = val; }
 
+    // a realtime synthesizer plays from the audio thread and must not
+    // wait for sample data; offline ones (export) load it on demand
+    bool realtime() const { return _realtime; }
+    void setRealtime(bool val) { _realtime = val; }
+
     virtual void allSoundsOff(int /*channel*/) {}
     virtual void allNotesOff(int /*channel*/) {}
 
@@ -17,8 +17,7 @@
 #include <math.h>
 #include <functional>
 
-static constexpr int INTERP_MAX = 256;
-static float interpCoeff[INTERP_MAX][4];
+float ZFilter::interpCoeff[ZFilter::INTERP_MAX][4];
 
 //---------------------------------------------------------
 //   FilterBQ
@@ -24,6 +24,9 @@ class Zerberus;
 class ZFilter
 {
 public:
+    static constexpr int INTERP_MAX = 256;
+    static float interpCoeff[INTERP_MAX][4];   // cubic interpolation coefficients per phase fraction
+
     ZFilter();
 
     void initialize(const Zerberus* zerberus, const Zone* z, int velocity);
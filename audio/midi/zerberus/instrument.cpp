@@ -12,6 +12,7 @@
 
 #include <stdio.h>
 #include <math.h>
+#include <string.h>
 #include <QFile>
 #include <QFileInfo>
 #include <QStringList>
@@ -23,6 +24,7 @@
 #include "instrument.h"
 #include "zone.h"
 #include "sample.h"
+#include "samplecache.h"
 
 QByteArray ZInstrument::buf;
 int ZInstrument::idx;
@@ -31,17 +33,56 @@ int ZInstrument::idx;
 //   Sample
 //---------------------------------------------------------
 
+Sample::Sample(const std::shared_ptr<PcmMap>& pcm)
+    : _pcm(pcm)
+{
+    const PcmHeader* h = pcm->header();
+    _channel    = h->channel;
+    _data       = pcm->data();
+    _frames     = h->frames;
+    _sampleRate = h->sampleRate;
+    _loopStart  = h->loopStart;
+    _loopEnd    = h->loopEnd;
+    _loopMode   = h->loopMode;
+}
+
 Sample::~Sample()
 {
-    delete[] _data;
+    if (!_pcm) {
+        delete[] _data;
+    }
+    SampleCache::release(_reserved);
 }
 
 //---------------------------------------------------------
 //   readSample
+//    Samples are decoded into memory as long as the
+//    SampleCache budget allows, later ones are played from
+//    a mapped cache file.
 //---------------------------------------------------------
 
 Sample* ZInstrument::readSample(const QString& s, MQZipReader* uz)
 {
+    const bool stream = !uz && SampleCache::budget > 0;
+    std::shared_ptr<PcmMap> pcm = stream ? SampleCache::find(s) : nullptr;
+    if (pcm) {
+        const PcmHeader* h = pcm->header();
+        const qint64 bytes = (h->frames + 3) * h->channel * qint64(sizeof(short));
+        if (!SampleCache::reserve(bytes)) {
+            SampleCache::preload(pcm.get());
+            return new Sample(pcm);
+        }
+        // fits into the budget, copy instead of decoding again
+        short* data = new short[(h->frames + 3) * h->channel];
+        memcpy(data, pcm->data(), bytes);
+        Sample* sa  = new Sample(h->channel, data, h->frames, h->sampleRate);
+        sa->setLoopStart(h->loopStart);
+        sa->setLoopEnd(h->loopEnd);
+        sa->setLoopMode(h->loopMode);
+        sa->setReserved(bytes);
+        return sa;
+    }
+
     if (uz) {
         QVector<MQZipReader::FileInfo> fi = uz->fileInfoList();
 
@@ -69,8 +110,20 @@ Sample* ZInstrument::readSample(const QString& s, MQZipReader* uz)
     sf_count_t frames  = a.frames();
     int sr      = a.samplerate();
 
+    const qint64 bytes = (frames + 3) * channel * qint64(sizeof(short));
+    if (!SampleCache::reserve(bytes, !stream)) {
+        pcm = SampleCache::create(s, a);
+        if (pcm) {
+            SampleCache::preload(pcm.get());
+            return new Sample(pcm);
+        }
+        // cannot write the cache file, keep the sample in memory
+        SampleCache::reserve(bytes, true);
+    }
+
     short* data = new short[(frames + 3) * channel];
     Sample* sa  = new Sample(channel, data, frames, sr);
+    sa->setReserved(bytes);
     sa->setLoopStart(a.loopStart());
     sa->setLoopEnd(a.loopEnd());
     sa->setLoopMode(a.loopMode());
@@ -123,14 +176,113 @@ bool ZInstrument::load(const QString& path)
     instrumentPath = path;
     QFileInfo fi(path);
     _name = fi.completeBaseName();
+    bool ok;
     if (fi.isFile()) {
-        return loadFromFile(path);
+        ok = loadFromFile(path);
+    } else if (fi.isDir()) {
+        ok = loadFromDir(path);
+    } else {
+        qDebug("not file nor dir %s", qPrintable(path));
+        return false;
+    }
+    if (ok) {
+        buildZoneIndex();
+    }
+    return ok;
+}
+
+//---------------------------------------------------------
+//   buildZoneIndex
+//    Sort the zones into a table indexed by trigger, key
+//    and velocity layer. A velocity layer is a velocity
+//    range in which no zone starts or ends. Every cell lists
+//    the zones whose key and velocity range contain it, in
+//    instrument order, so Zone::match() only has to be
+//    called for them. CC triggered zones ignore key and
+//    velocity and are kept in a separate list.
+//---------------------------------------------------------
+
+void ZInstrument::buildZoneIndex()
+{
+    auto lo = [](char v) { return qBound(0, int(v), 128); };
+    auto hi = [](char v) { return qBound(-1, int(v), 127); };
+
+    bool layerStart[129] = {};
+    layerStart[0] = true;
+    for (const Zone* z : _zones) {
+        layerStart[lo(z->veloLo)] = true;
+        layerStart[hi(z->veloHi) + 1] = true;
+    }
+    _veloLayers = 0;
+    for (int v = 0; v < 128; ++v) {
+        if (layerStart[v]) {
+            ++_veloLayers;
+        }
+        _veloLayer[v] = _veloLayers - 1;
+    }
+
+    const int cells = TRIGGERS * 128 * _veloLayers;
+    std::vector<int> count(cells + 1, 0);
+    _ccZones.clear();
+    _allZones.assign(_zones.begin(), _zones.end());
+
+    // count and fill in two passes, keeping the zone order
+    for (int pass = 0; pass < 2; ++pass) {
+        for (Zone* z : _zones) {
+            if (z->trigger == Trigger::CC) {
+                if (pass == 0) {
+                    _ccZones.push_back(z);
+                }
+                continue;
+            }
+            const int t = int(z->trigger);
+            if (t < 0 || t >= TRIGGERS || lo(z->veloLo) > hi(z->veloHi)) {
+                continue;
+            }
+            const int l1 = _veloLayer[lo(z->veloLo)];
+            const int l2 = _veloLayer[hi(z->veloHi)];
+            for (int k = lo(z->keyLo); k <= hi(z->keyHi); ++k) {
+                for (int l = l1; l <= l2; ++l) {
+                    const int cell = (t * 128 + k) * _veloLayers + l;
+                    if (pass == 0) {
+                        ++count[cell + 1];
+                    } else {
+                        _zoneIndex[count[cell]++] = z;
+                    }
+                }
+            }
+        }
+        if (pass == 0) {
+            for (int i = 0; i < cells; ++i) {
+                count[i + 1] += count[i];
+            }
+            _zoneIndexStart = count;
+            _zoneIndex.resize(count[cells]);
+        }
+    }
+}
+
+//---------------------------------------------------------
+//   zones
+//    zones that may match a trigger; Zone::match() still
+//    decides on random, sequence and CC conditions.
+//    The index is built by load(), this never allocates.
+//---------------------------------------------------------
+
+ZoneRange ZInstrument::zones(int key, int velo, Trigger trigger) const
+{
+    if (_zoneIndexStart.empty()) {
+        return { nullptr, nullptr };
+    }
+    if (trigger == Trigger::CC) {
+        return { _ccZones.data(), _ccZones.data() + _ccZones.size() };
     }
-    if (fi.isDir()) {
-        return loadFromDir(path);
+    const int t = int(trigger);
+    if (key < 0 || key > 127 || velo < 0 || velo > 127 || t < 0 || t >= TRIGGERS) {
+        return { _allZones.data(), _allZones.data() + _allZones.size() };
     }
-    qDebug("not file nor dir %s", qPrintable(path));
-    return false;
+    const int cell = (t * 128 + key) * _veloLayers + _veloLayer[velo];
+    return { _zoneIndex.data() + _zoneIndexStart[cell], _zoneIndex.data() + _zoneIndexStart[cell + 1] };
 }
 
 //---------------------------------------------------------
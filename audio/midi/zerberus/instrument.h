@@ -14,6 +14,7 @@
 #define __MINSTRUMENT_H__
 
 #include <list>
+#include <vector>
 #include <QString>
 
 class Zerberus;
@@ -22,6 +23,19 @@ class MQZipReader;
 struct Zone;
 struct SfzRegion;
 class Sample;
+enum class Trigger : char;
+
+//---------------------------------------------------------
+//   ZoneRange
+//    candidate zones for a trigger, in instrument order
+//---------------------------------------------------------
+
+struct ZoneRange {
+    Zone* const* b;
+    Zone* const* e;
+    Zone* const* begin() const { return b; }
+    Zone* const* end() const { return e; }
+};
 
 //---------------------------------------------------------
 //   ZInstrument
@@ -37,6 +51,17 @@ class ZInstrument
     std::list<Zone*> _zones;
     int _setcc[128];
 
+    // zone lookup table, see buildZoneIndex()
+    static const int TRIGGERS = 4;        // Trigger values except CC
+    int _veloLayer[128];
+    int _veloLayers { 0 };
+    std::vector<int> _zoneIndexStart;     // per (trigger, key, velocity layer) start in _zoneIndex
+    std::vector<Zone*> _zoneIndex;
+    std::vector<Zone*> _ccZones;          // zones triggered by CC
+    std::vector<Zone*> _allZones;
+
+    void buildZoneIndex();
+
     bool loadFromFile(const QString&);
     bool loadSfz(const QString&);
     bool loadFromDir(const QString&);
@@ -53,9 +78,9 @@ public:
     QString name() const { return _name; }
     QString path() const { return instrumentPath; }
     const std::list<Zone*>& zones() const { return _zones; }
-    std::list<Zone*>& zones() { return _zones; }
+    ZoneRange zones(int key, int velo, Trigger) const;
     Sample* readSample(const QString& s, MQZipReader* uz);
-    void addZone(Zone* z) { _zones.push_back(z); }
+    void addZone(Zone* z) { _zones.push_back(z); }      // while loading only
     void addRegion(SfzRegion&);
     int getSetCC(int v) { return _setcc[v]; }
 
@@ -13,6 +13,10 @@
 #ifndef __SAMPLE_H__
 #define __SAMPLE_H__
 
+#include <memory>
+
+struct PcmMap;
+
 //---------------------------------------------------------
 //   Sample
 //---------------------------------------------------------
@@ -26,16 +30,21 @@ class Sample
     long long _loopStart { 0 };
     long long _loopEnd   { 0 };
     int _loopMode     { 0 };
+    qint64 _reserved  { 0 };              // bytes accounted in SampleCache
+    std::shared_ptr<PcmMap> _pcm;          // set if _data is a mapped cache file
 
 public:
     Sample(int ch, short* val, int f, int sr)
         : _channel(ch), _data(val), _frames(f), _sampleRate(sr) {}
+    Sample(const std::shared_ptr<PcmMap>&);
     ~Sample();
     bool read(const QString&);
     long long frames() const { return _frames; }
     short* data() const { return _data + _channel; }
     int channel() const { return _channel; }
     int sampleRate() const { return _sampleRate; }
+    void setReserved(qint64 v) { _reserved = v; }
+    const std::shared_ptr<PcmMap>& pcm() const { return _pcm; }
 
     void setLoopStart(int v) { _loopStart = v; }
     void setLoopEnd(int v) { _loopEnd = v; }
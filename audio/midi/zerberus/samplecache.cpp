@@ -0,0 +1,387 @@
+//=============================================================================
+//  Zerberus
+//  Zample player
+//
+//  Copyright (C) 2020 Werner Schweer
+//
+//  This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License version 2
+//  as published by the Free Software Foundation and appearing in
+//  the file LICENCE.GPL
+//=============================================================================
+
+#include <thread>
+#include <chrono>
+#include <mutex>
+#include <cstring>
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QDir>
+#include <QFileInfo>
+#include <QStandardPaths>
+#include <QTemporaryFile>
+
+#if defined(Q_OS_UNIX)
+#include <sys/mman.h>
+#elif defined(Q_OS_WIN)
+#include <windows.h>
+#endif
+
+#include "audiofile/audiofile.h"
+#include "samplecache.h"
+
+std::atomic<qint64> SampleCache::_used { 0 };
+qint64 SampleCache::budget = qEnvironmentVariableIntValue("MSCORE_ZERBERUS_CACHE_MB") * qint64(1024 * 1024);
+qint64 SampleCache::diskBudget = (qEnvironmentVariableIsSet("MSCORE_ZERBERUS_DISK_MB")
+                                  ? qEnvironmentVariableIntValue("MSCORE_ZERBERUS_DISK_MB") : 4096) * qint64(1024 * 1024);
+int SampleCache::preloadMs = qEnvironmentVariableIsSet("MSCORE_ZERBERUS_PRELOAD_MS")
+                             ? qEnvironmentVariableIntValue("MSCORE_ZERBERUS_PRELOAD_MS") : 500;
+
+static const char PCM_MAGIC[8] = { 'Z', 'P', 'C', 'M', '0', '0', '0', '1' };
+static const qint64 PAGE_SIZE = 4096;
+
+static_assert(sizeof(PcmHeader) == 64, "cache file header must keep the sample data aligned");
+
+//---------------------------------------------------------
+//   PcmMap
+//---------------------------------------------------------
+
+PcmMap::~PcmMap()
+{
+    if (locked) {
+#if defined(Q_OS_UNIX)
+        munlock(map, locked);
+#elif defined(Q_OS_WIN)
+        VirtualUnlock(map, locked);
+#endif
+    }
+    if (map) {
+        file.unmap(map);
+    }
+}
+
+short* PcmMap::data() const
+{
+    return reinterpret_cast<short*>(map + sizeof(PcmHeader));
+}
+
+const PcmHeader* PcmMap::header() const
+{
+    return reinterpret_cast<const PcmHeader*>(map);
+}
+
+//---------------------------------------------------------
+//   SampleReader
+//    pages in mapped sample data ahead of playback. The
+//    audio thread only writes into a single producer,
+//    single consumer ring and never waits.
+//---------------------------------------------------------
+
+class SampleReader
+{
+    static const unsigned RING_SIZE = 256;
+
+    struct Request {
+        std::shared_ptr<PcmMap> pcm;
+        qint64 offset;
+    };
+
+    Request ring[RING_SIZE];
+    std::atomic<unsigned> head { 0 };     // written by the audio thread
+    std::atomic<unsigned> tail { 0 };     // written by the reader thread
+    std::atomic<bool> stop { false };
+    std::thread thread;
+
+    void run();
+
+public:
+    SampleReader() : thread(&SampleReader::run, this) {}
+    ~SampleReader()
+    {
+        stop = true;
+        thread.join();
+    }
+    bool push(const std::shared_ptr<PcmMap>& pcm, qint64 offset);
+};
+
+//---------------------------------------------------------
+//   push
+//    drops the request if the ring is full, the sample
+//    is then paged in by the audio thread itself
+//---------------------------------------------------------
+
+bool SampleReader::push(const std::shared_ptr<PcmMap>& pcm, qint64 offset)
+{
+    const unsigned h = head.load(std::memory_order_relaxed);
+    if (h - tail.load(std::memory_order_acquire) >= RING_SIZE) {
+        return false;
+    }
+    Request& r = ring[h % RING_SIZE];
+    r.pcm    = pcm;
+    r.offset = offset;
+    head.store(h + 1, std::memory_order_release);
+    return true;
+}
+
+//---------------------------------------------------------
+//   run
+//---------------------------------------------------------
+
+void SampleReader::run()
+{
+    while (!stop) {
+        const unsigned t = tail.load(std::memory_order_relaxed);
+        if (t == head.load(std::memory_order_acquire)) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(2));
+            continue;
+        }
+        Request& slot = ring[t % RING_SIZE];
+        std::shared_ptr<PcmMap> pcm = std::move(slot.pcm);
+        const qint64 offset = slot.offset;
+        tail.store(t + 1, std::memory_order_release);
+
+        // touch one byte per page; reading from disk is much
+        // faster than playback so this stays ahead of the voice
+        volatile uchar sum = 0;
+        for (qint64 i = offset; i < pcm->size && !stop; i += PAGE_SIZE) {
+            sum += pcm->map[i];
+        }
+        Q_UNUSED(sum);
+    }
+}
+
+//---------------------------------------------------------
+//   reader
+//---------------------------------------------------------
+
+static SampleReader& reader()
+{
+    static SampleReader r;
+    return r;
+}
+
+//---------------------------------------------------------
+//   reserve
+//    account bytes of sample data held in memory; fails if
+//    this would exceed the budget unless force is set
+//---------------------------------------------------------
+
+bool SampleCache::reserve(qint64 bytes, bool force)
+{
+    qint64 used = _used.load();
+    do {
+        if (!force && budget > 0 && used + bytes > budget) {
+            return false;
+        }
+    } while (!_used.compare_exchange_weak(used, used + bytes));
+    return true;
+}
+
+//---------------------------------------------------------
+//   release
+//---------------------------------------------------------
+
+void SampleCache::release(qint64 bytes)
+{
+    _used -= bytes;
+}
+
+//---------------------------------------------------------
+//   cacheDir
+//---------------------------------------------------------
+
+QString SampleCache::cacheDir()
+{
+    return QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + "/zerberus";
+}
+
+//---------------------------------------------------------
+//   trim
+//    remove cache files, least recently used first, until
+//    the directory fits into diskBudget; also removes files
+//    left over by an interrupted create()
+//---------------------------------------------------------
+
+void SampleCache::trim()
+{
+    QDir dir(cacheDir());
+    const QDateTime stale = QDateTime::currentDateTime().addDays(-1);
+    for (const QFileInfo& fi : dir.entryInfoList({ "*.part" }, QDir::Files)) {
+        if (fi.lastModified() < stale) {
+            QFile::remove(fi.absoluteFilePath());
+        }
+    }
+    qint64 total = 0;
+    QFileInfoList files = dir.entryInfoList({ "*.pcm" }, QDir::Files, QDir::Time);     // newest first
+    for (const QFileInfo& fi : files) {
+        total += fi.size();
+    }
+    while (total > diskBudget && !files.isEmpty()) {
+        const QFileInfo fi = files.takeLast();
+        if (QFile::remove(fi.absoluteFilePath())) {        // fails for files mapped by another process on Windows
+            total -= fi.size();
+        }
+    }
+}
+
+//---------------------------------------------------------
+//   cacheFile
+//    the cache file name depends on the sample path, size
+//    and modification time so a changed sample is decoded
+//    again
+//---------------------------------------------------------
+
+static QString cacheFile(const QString& path)
+{
+    QFileInfo fi(path);
+    QCryptographicHash h(QCryptographicHash::Md5);
+    h.addData(fi.absoluteFilePath().toUtf8());
+    h.addData(QByteArray::number(fi.size()));
+    h.addData(QByteArray::number(fi.lastModified().toMSecsSinceEpoch()));
+    return SampleCache::cacheDir() + "/" + QString::fromLatin1(h.result().toHex()) + ".pcm";
+}
+
+//---------------------------------------------------------
+//   find
+//    map an existing cache file of the sample at path
+//---------------------------------------------------------
+
+std::shared_ptr<PcmMap> SampleCache::find(const QString& path)
+{
+    std::shared_ptr<PcmMap> pcm(new PcmMap);
+    pcm->file.setFileName(cacheFile(path));
+    if (!pcm->file.open(QIODevice::ReadOnly) || pcm->file.size() < qint64(sizeof(PcmHeader))) {
+        return nullptr;
+    }
+    pcm->size = pcm->file.size();
+    pcm->map  = pcm->file.map(0, pcm->size);
+    if (!pcm->map) {
+        return nullptr;
+    }
+    // files are complete once renamed into place, a size that does
+    // not match the header means the file was damaged
+    const PcmHeader* h = pcm->header();
+    if (memcmp(h->magic, PCM_MAGIC, sizeof(PCM_MAGIC)) != 0
+        || h->channel <= 0 || h->frames < 3
+        || pcm->size != qint64(sizeof(PcmHeader)) + (h->frames + 3) * h->channel * qint64(sizeof(short))) {
+        qDebug("SampleCache: removing damaged cache file %s", qPrintable(pcm->file.fileName()));
+        pcm->file.unmap(pcm->map);
+        pcm->map = nullptr;
+        pcm->file.remove();
+        return nullptr;
+    }
+    // the modification time orders the files for trim()
+    pcm->file.setFileTime(QDateTime::currentDateTime(), QFileDevice::FileModificationTime);
+    return pcm;
+}
+
+//---------------------------------------------------------
+//   create
+//    decode the sample into a temporary file and rename it
+//    into place once it is complete, so that a crash or a
+//    second instance never sees a partially written cache
+//    file; then map it like an existing one
+//---------------------------------------------------------
+
+std::shared_ptr<PcmMap> SampleCache::create(const QString& path, AudioFile& a)
+{
+    if (!QDir().mkpath(cacheDir())) {
+        return nullptr;
+    }
+    static std::once_flag trimmed;
+    std::call_once(trimmed, &SampleCache::trim);
+
+    const qint64 frames  = a.frames();
+    const int channel    = a.channels();
+    if (frames < 3 || channel <= 0) {
+        return nullptr;
+    }
+    const qint64 size = qint64(sizeof(PcmHeader)) + (frames + 3) * channel * qint64(sizeof(short));
+    QTemporaryFile tmp(cacheDir() + "/XXXXXX.part");
+    if (!tmp.open() || !tmp.resize(size)) {
+        return nullptr;
+    }
+    uchar* map = tmp.map(0, size);
+    if (!map) {
+        return nullptr;
+    }
+    short* data = reinterpret_cast<short*>(map + sizeof(PcmHeader));
+    if (frames != a.readData(data + channel, frames)) {
+        qDebug("Sample read failed: %s\n", a.error());
+        tmp.unmap(map);
+        return nullptr;
+    }
+    for (int i = 0; i < channel; ++i) {
+        data[i]                        = data[channel + i];
+        data[(frames - 1) * channel + i] = data[(frames - 3) * channel + i];
+        data[(frames - 2) * channel + i] = data[(frames - 3) * channel + i];
+    }
+
+    PcmHeader* h  = reinterpret_cast<PcmHeader*>(map);
+    memset(h, 0, sizeof(PcmHeader));
+    h->frames     = frames;
+    h->channel    = channel;
+    h->sampleRate = a.samplerate();
+    h->loopStart  = a.loopStart();
+    h->loopEnd    = a.loopEnd();
+    h->loopMode   = a.loopMode();
+    memcpy(h->magic, PCM_MAGIC, sizeof(PCM_MAGIC));
+    tmp.unmap(map);
+    if (!tmp.flush()) {
+        return nullptr;
+    }
+
+    // rename fails if another instance created the file meanwhile;
+    // the temporary file is then removed and the other one used
+    tmp.setAutoRemove(false);
+    if (!tmp.rename(cacheFile(path))) {
+        tmp.remove();
+    }
+    return find(path);
+}
+
+//---------------------------------------------------------
+//   preload
+//    page in the first preloadMs of the sample
+//---------------------------------------------------------
+
+void SampleCache::preload(PcmMap* pcm)
+{
+    const PcmHeader* h = pcm->header();
+    const qint64 frames = qint64(h->sampleRate) * preloadMs / 1000;
+    const qint64 end    = qMin(pcm->size, qint64(sizeof(PcmHeader)) + (frames + 1) * h->channel * qint64(sizeof(short)));
+    volatile uchar sum  = 0;
+    for (qint64 i = 0; i < end; i += PAGE_SIZE) {
+        sum += pcm->map[i];
+    }
+    Q_UNUSED(sum);
+
+    // Voices start reading in the preloaded part; lock it so
+    // that it is not paged out again and the audio thread
+    // does not fault on note on. This is best effort, it
+    // fails if the lock limit of the process is reached.
+    // The rest of the file is read ahead by the kernel and
+    // the reader thread.
+#if defined(Q_OS_UNIX)
+    if (mlock(pcm->map, end) == 0) {
+        pcm->locked = end;
+    }
+    madvise(pcm->map, pcm->size, MADV_WILLNEED);
+#elif defined(Q_OS_WIN)
+    if (VirtualLock(pcm->map, end)) {
+        pcm->locked = end;
+    }
+#endif
+    reader();         // start the reader thread outside of the audio thread
+}
+
+//---------------------------------------------------------
+//   prefetch
+//    called from the audio thread when a voice starts at
+//    sample index idx (relative to PcmMap::data())
+//---------------------------------------------------------
+
+void SampleCache::prefetch(const std::shared_ptr<PcmMap>& pcm, qint64 idx)
+{
+    reader().push(pcm, qint64(sizeof(PcmHeader)) + idx * qint64(sizeof(short)));
+}
@@ -0,0 +1,93 @@
+//=============================================================================
+//  Zerberus
+//  Zample player
+//
+//  Copyright (C) 2020 Werner Schweer
+//
+//  This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License version 2
+//  as published by the Free Software Foundation and appearing in
+//  the file LICENCE.GPL
+//=============================================================================
+
+#ifndef __SAMPLECACHE_H__
+#define __SAMPLECACHE_H__
+
+#include <atomic>
+#include <memory>
+#include <QString>
+#include <QFile>
+
+class AudioFile;
+
+//---------------------------------------------------------
+//   PcmHeader
+//    start of a cache file, followed by the sample data
+//    in the layout of ZInstrument::readSample()
+//---------------------------------------------------------
+
+struct PcmHeader {
+    char magic[8];
+    qint64 frames;
+    qint32 channel;
+    qint32 sampleRate;
+    qint32 loopStart;
+    qint32 loopEnd;
+    qint32 loopMode;
+    char pad[28];
+};
+
+//---------------------------------------------------------
+//   PcmMap
+//    decoded sample data in a memory mapped cache file
+//---------------------------------------------------------
+
+struct PcmMap {
+    QFile file;
+    uchar* map { nullptr };
+    qint64 size { 0 };
+    qint64 locked { 0 };                // bytes at the start of map locked in memory
+
+    ~PcmMap();
+    short* data() const;
+    const PcmHeader* header() const;
+};
+
+//---------------------------------------------------------
+//   SampleCache
+//    Keeps decoded sample data in memory up to a budget.
+//    Samples loaded after the budget is used up are decoded
+//    once into a PCM cache file which is memory mapped; only
+//    the first preloadMs of such a sample are read at load
+//    time, the rest is paged in by a reader thread when a
+//    voice starts playing the sample.
+//
+//    The budget (MB) and the preload time (ms) are taken from
+//    MSCORE_ZERBERUS_CACHE_MB and MSCORE_ZERBERUS_PRELOAD_MS;
+//    a budget of 0 keeps all samples in memory. The cache
+//    directory is trimmed to MSCORE_ZERBERUS_DISK_MB (default
+//    4096), least recently used files first.
+//---------------------------------------------------------
+
+class SampleCache
+{
+    static std::atomic<qint64> _used;
+
+public:
+    static qint64 budget;               // bytes, 0: unlimited
+    static qint64 diskBudget;           // bytes of cache files
+    static int preloadMs;
+
+    static bool reserve(qint64 bytes, bool force = false);
+    static void release(qint64 bytes);
+    static qint64 used() { return _used; }
+
+    static QString cacheDir();
+    static void trim();
+    static std::shared_ptr<PcmMap> find(const QString& path);
+    static std::shared_ptr<PcmMap> create(const QString& path, AudioFile&);
+    static void preload(PcmMap*);
+    static void prefetch(const std::shared_ptr<PcmMap>&, qint64 idx);
+};
+
+#endif
@@ -12,12 +12,21 @@
 
 #include <stdio.h>
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define ZERBERUS_SSE
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define ZERBERUS_NEON
+#endif
+
 #include "voice.h"
 #include "instrument.h"
 #include "channel.h"
 #include "zerberus.h"
 #include "zone.h"
 #include "sample.h"
+#include "samplecache.h"
 
 #include "midi/msynthesizer.h"
 
@@ -101,6 +110,9 @@ void Voice::start(Channel* c, int key, int v, const Zone* zone, double durSinceN
     data      = s->data() + z->offset * audioChan;
     //avoid processing sample if offset is bigger than sample length
     eidx      = std::max((s->frames() - z->offset - 1) * audioChan, 0ll);
+    if (s->pcm()) {
+        SampleCache::prefetch(s->pcm(), data - s->pcm()->data());     // Sample::data() skips a frame
+    }
     _loopMode = z->loopMode;
     _loopStart = z->loopStart;
     _loopEnd   = z->loopEnd;
@@ -224,14 +236,190 @@ void Voice::updateEnvelopes()
     }
 }
 
+//---------------------------------------------------------
+//   interpolateBlock
+//    x[i] = c0 * t0 + c1 * t1 + c2 * t2 + c3 * t3, evaluated
+//    in the same order as ZFilter::interpolate()
+//---------------------------------------------------------
+
+static void interpolateBlock(int n, const float (*c)[VOICE_BLOCK], const float (*t)[VOICE_BLOCK], float* x)
+{
+    int i = 0;
+#if defined(ZERBERUS_SSE)
+    for (; i + 4 <= n; i += 4) {
+        __m128 v = _mm_mul_ps(_mm_load_ps(c[0] + i), _mm_load_ps(t[0] + i));
+        v = _mm_add_ps(v, _mm_mul_ps(_mm_load_ps(c[1] + i), _mm_load_ps(t[1] + i)));
+        v = _mm_add_ps(v, _mm_mul_ps(_mm_load_ps(c[2] + i), _mm_load_ps(t[2] + i)));
+        v = _mm_add_ps(v, _mm_mul_ps(_mm_load_ps(c[3] + i), _mm_load_ps(t[3] + i)));
+        _mm_store_ps(x + i, v);
+    }
+#elif defined(ZERBERUS_NEON)
+    for (; i + 4 <= n; i += 4) {
+        float32x4_t v = vmulq_f32(vld1q_f32(c[0] + i), vld1q_f32(t[0] + i));
+        v = vaddq_f32(v, vmulq_f32(vld1q_f32(c[1] + i), vld1q_f32(t[1] + i)));
+        v = vaddq_f32(v, vmulq_f32(vld1q_f32(c[2] + i), vld1q_f32(t[2] + i)));
+        v = vaddq_f32(v, vmulq_f32(vld1q_f32(c[3] + i), vld1q_f32(t[3] + i)));
+        vst1q_f32(x + i, v);
+    }
+#endif
+    for (; i < n; ++i) {
+        x[i] = c[0][i] * t[0][i] + c[1][i] * t[1][i] + c[2][i] * t[2][i] + c[3][i] * t[3][i];
+    }
+}
+
+//---------------------------------------------------------
+//   mixBlock
+//    add the enveloped left and right signal to the
+//    interleaved output buffer p
+//---------------------------------------------------------
+
+static void mixBlock(int n, const float* l, const float* r, const float* env, float lvol, float rvol, float* p)
+{
+    int i = 0;
+#if defined(ZERBERUS_SSE)
+    const __m128 lv = _mm_set1_ps(lvol);
+    const __m128 rv = _mm_set1_ps(rvol);
+    for (; i + 4 <= n; i += 4) {
+        const __m128 e = _mm_load_ps(env + i);
+        const __m128 vl = _mm_mul_ps(_mm_mul_ps(_mm_load_ps(l + i), e), lv);
+        const __m128 vr = _mm_mul_ps(_mm_mul_ps(_mm_load_ps(r + i), e), rv);
+        float* o = p + 2 * i;
+        _mm_storeu_ps(o,     _mm_add_ps(_mm_loadu_ps(o),     _mm_unpacklo_ps(vl, vr)));
+        _mm_storeu_ps(o + 4, _mm_add_ps(_mm_loadu_ps(o + 4), _mm_unpackhi_ps(vl, vr)));
+    }
+#elif defined(ZERBERUS_NEON)
+    const float32x4_t lv = vdupq_n_f32(lvol);
+    const float32x4_t rv = vdupq_n_f32(rvol);
+    for (; i + 4 <= n; i += 4) {
+        const float32x4_t e = vld1q_f32(env + i);
+        float32x4x2_t o = vld2q_f32(p + 2 * i);
+        o.val[0] = vaddq_f32(o.val[0], vmulq_f32(vmulq_f32(vld1q_f32(l + i), e), lv));
+        o.val[1] = vaddq_f32(o.val[1], vmulq_f32(vmulq_f32(vld1q_f32(r + i), e), rv));
+        vst2q_f32(p + 2 * i, o);
+    }
+#endif
+    for (; i < n; ++i) {
+        p[2 * i]     += l[i] * env[i] * lvol;
+        p[2 * i + 1] += r[i] * env[i] * rvol;
+    }
+}
+
+//---------------------------------------------------------
+//   renderControl
+//    Advance the voice by up to frames frames: loop and
+//    end of sample handling, envelopes and phase. Collects
+//    per frame the interpolation coefficients, the sample
+//    taps of each channel and the envelope value.
+//    Returns the number of frames to render; the voice is
+//    off if this is less than frames.
+//---------------------------------------------------------
+
+int Voice::renderControl(int frames, float (*coeff)[VOICE_BLOCK], float (*taps)[4][VOICE_BLOCK], float* env)
+{
+    const long long step   = audioChan;               // distance of two frames in data
+    const long long first  = -step;                   // first tap relative to idx
+    const long long last   = 2 * step + audioChan - 1; // last tap relative to idx
+    const long long loopLo = _loopStart * audioChan;
+    const long long loopHi = _loopEnd * audioChan + audioChan - 1;
+
+    for (int n = 0; n < frames; ++n) {
+        updateLoop();
+
+        long long idx = phase.index() * audioChan;
+        if (idx >= eidx) {
+            off();
+            return n;
+        }
+        const float* c = ZFilter::interpCoeff[phase.fract()];
+        coeff[0][n] = c[0];
+        coeff[1][n] = c[1];
+        coeff[2][n] = c[2];
+        coeff[3][n] = c[3];
+
+        // getData() only needs to wrap or clip taps outside of [lo, hi]
+        const long long lo = _looping ? loopLo : 0;
+        const long long hi = _looping ? loopHi : std::numeric_limits<long long>::max();
+        const bool direct  = idx + first >= lo && idx + last <= hi;
+        for (int ch = 0; ch < audioChan; ++ch) {
+            for (int k = 0; k < 4; ++k) {
+                long long pos = idx + ch + (k - 1) * step;
+                taps[ch][k][n] = direct ? data[pos] : getData(pos);
+            }
+        }
+
+        updateEnvelopes();
+        if (_state == VoiceState::OFF) {
+            return n;
+        }
+        env[n] = envelopes[currentEnvelope].val;
+
+        if (V1Envelopes::DELAY != currentEnvelope) {
+            phase += phaseIncr;
+        }
+        _samplesSinceStart++;
+    }
+    return frames;
+}
+
 //---------------------------------------------------------
 //   process
+//    render blocks of VOICE_BLOCK frames: control pass,
+//    vectorized interpolation, filter, vectorized mixing
 //---------------------------------------------------------
 
 void Voice::process(int frames, float* p)
 {
     filter.update();
 
+    const float opcodePanLeftGain = 1.f - fmax(0.0f, z->pan / 100.0);   //[0, 1]
+    const float opcodePanRightGain = 1.f + fmin(0.0f, z->pan / 100.0);   //[0, 1]
+    const float leftChannelVol = gain * z->ccGain * _channel->panLeftGain() * opcodePanLeftGain;
+    const float rightChannelVol = gain * z->ccGain * _channel->panRightGain() * opcodePanRightGain;
+
+    alignas(16) float coeff[4][VOICE_BLOCK];
+    alignas(16) float taps[2][4][VOICE_BLOCK];
+    alignas(16) float x[2][VOICE_BLOCK];
+    alignas(16) float env[VOICE_BLOCK];
+
+    while (frames > 0) {
+        const int block = std::min(frames, VOICE_BLOCK);
+        const int n = renderControl(block, coeff, taps, env);
+
+        for (int ch = 0; ch < audioChan; ++ch) {
+            interpolateBlock(n, coeff, taps[ch], x[ch]);
+        }
+        // the filter is recursive and its coefficients may change with
+        // every call, so it runs per frame, left before right
+        if (audioChan == 1) {
+            for (int i = 0; i < n; ++i) {
+                x[0][i] = filter.apply(x[0][i], true);
+            }
+        } else {
+            for (int i = 0; i < n; ++i) {
+                x[0][i] = filter.apply(x[0][i], true);
+                x[1][i] = filter.apply(x[1][i], false);
+            }
+        }
+        mixBlock(n, x[0], x[audioChan == 1 ? 0 : 1], env, leftChannelVol, rightChannelVol, p);
+
+        if (n < block) {
+            break;          // voice is off
+        }
+        p      += 2 * n;
+        frames -= n;
+    }
+}
+
+//---------------------------------------------------------
+//   processFrames
+//    render one frame at a time, without the block kernels;
+//    the reference process() is tested against
+//---------------------------------------------------------
+
+void Voice::processFrames(int frames, float* p)
+{
+    filter.update();
+
     const float opcodePanLeftGain = 1.f - fmax(0.0f, z->pan / 100.0);   //[0, 1]
     const float opcodePanRightGain = 1.f + fmin(0.0f, z->pan / 100.0);   //[0, 1]
     const float leftChannelVol = gain * z->ccGain * _channel->panLeftGain() * opcodePanLeftGain;
@@ -275,7 +463,6 @@ void Voice::process(int frames, float* p)
             long long idx = phase.index() * 2;
             if (idx >= eidx) {
                 off();
-//printf("end of sample\n");
                 break;
             }
 
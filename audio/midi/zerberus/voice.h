@@ -32,6 +32,7 @@ enum class OffMode : char;
 enum class Trigger : char;
 
 static const int EG_SIZE    = 256;
+static const int VOICE_BLOCK = 64;      // frames rendered per block in Voice::process()
 
 //---------------------------------------------------------
 //   Envelope
@@ -161,8 +162,10 @@ public:
     void start(Channel* channel, int key, int velo, const Zone*, double durSinceNoteOn);
     void updateEnvelopes();
     void process(int frames, float*);
+    void processFrames(int frames, float*);
     void updateLoop();
     short getData(long long pos);
+    int renderControl(int frames, float (*coeff)[VOICE_BLOCK], float (*taps)[4][VOICE_BLOCK], float* env);
 
     Channel* channel() const { return _channel; }
     int key() const { return _key; }
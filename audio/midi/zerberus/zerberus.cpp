@@ -102,7 +102,7 @@ void Zerberus::trigger(Channel* channel, int key, int velo, Trigger trigger, int
 {
     ZInstrument* i = channel->instrument();
     double random = (double)rand() / (double)RAND_MAX;
-    for (Zone* z : i->zones()) {
+    for (Zone* z : i->zones(key, velo, trigger)) {
         if (z->match(channel, key, velo, trigger, random, cc, ccVal)) {
             //
             // handle offBy voices
@@ -18,7 +18,7 @@
 // #include <mutex>
 #include <list>
 #include <memory>
-#include <queue>
+#include <vector>
 
 #include "voice.h"
 
@@ -36,41 +36,44 @@ static const int MAX_TRIGGER  = 512;
 
 //---------------------------------------------------------
 //   VoiceFifo
+//    fixed size ring of free voices; push() and pop() are
+//    called from the audio thread and must not allocate
 //---------------------------------------------------------
 
 class VoiceFifo
 {
-    std::queue<Voice*> buffer;
+    Voice* buffer[MAX_VOICES];
+    int head  { 0 };
+    int count { 0 };
     std::vector< std::unique_ptr<Voice> > voices;
 
 public:
-    VoiceFifo()
-    {
-        voices.resize(MAX_VOICES);
-    }
-
     void init(Zerberus* z)
     {
+        voices.reserve(MAX_VOICES);
         for (int i = 0; i < MAX_VOICES; ++i) {
             voices.push_back(std::unique_ptr<Voice>(new Voice(z)));
-            buffer.push(voices.back().get());
+            push(voices.back().get());
         }
     }
 
     void push(Voice* v)
     {
-        buffer.push(v);
+        Q_ASSERT(count < MAX_VOICES);
+        buffer[(head + count) % MAX_VOICES] = v;
+        ++count;
     }
 
     Voice* pop()
     {
-        Q_ASSERT(!buffer.empty());
-        Voice* v = buffer.front();
-        buffer.pop();
+        Q_ASSERT(count > 0);
+        Voice* v = buffer[head];
+        head = (head + 1) % MAX_VOICES;
+        --count;
         return v;
     }
 
-    bool empty() const { return buffer.empty(); }
+    bool empty() const { return count == 0; }
 };
 
 //---------------------------------------------------------
@@ -22,6 +22,35 @@ Audio::Audio()
 {
 }
 
+//---------------------------------------------------------
+//   data
+//---------------------------------------------------------
+
+const QByteArray& Audio::data() const
+{
+    if (_loader) {
+        _data = _loader();
+        _loader = nullptr;
+    }
+    return _data;
+}
+
+//---------------------------------------------------------
+//   setArchive
+//    see ImageStoreItem::setArchive()
+//---------------------------------------------------------
+
+void Audio::setArchive(std::function<QByteArray()> f, const QString& archive, uint crc)
+{
+    if (!f) {
+        data();
+    } else if (_loader) {
+        _loader = f;
+    }
+    _archive    = archive;
+    _archiveCrc = crc;
+}
+
 //---------------------------------------------------------
 //   read
 //---------------------------------------------------------
@@ -24,15 +24,27 @@ class XmlReader;
 class Audio
 {
     QString _path;
-    QByteArray _data;
+    mutable QByteArray _data;
+    mutable std::function<QByteArray()> _loader;  // fetches _data on first use
+    QString _archive;                             // score file holding the unchanged data
+    uint _archiveCrc { 0 };                       // crc32 of the data in _archive
 
 public:
     Audio();
     const QString& path() const { return _path; }
     void setPath(const QString& s) { _path = s; }
-    const QByteArray& data() const { return _data; }
-    QByteArray data() { return _data; }
-    void setData(const QByteArray& ba) { _data = ba; }
+    const QByteArray& data() const;
+    void setData(const QByteArray& ba) { _data = ba; _loader = nullptr; _archive.clear(); }
+    void setLoader(std::function<QByteArray()> f, const QString& archive, uint crc)
+    {
+        _data.clear();
+        _loader = f;
+        _archive = archive;
+        _archiveCrc = crc;
+    }
+    void setArchive(std::function<QByteArray()> f, const QString& archive, uint crc);
+    const QString& archive() const { return _archive; }
+    uint archiveCrc() const { return _archiveCrc; }
 
     void read(XmlReader&);
     void write(XmlWriter&) const;
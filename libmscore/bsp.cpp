@@ -8,93 +8,41 @@
 //  it under the terms of the GNU General Public License version 2
 //  as published by the Free Software Foundation and appearing in
 //  the file LICENCE.GPL
-//
-//  This code is from Qt implementation of QGraphicsItem
-//    Copyright (C) 1992-2007 Trolltech ASA. All rights reserved.
 //=============================================================================
 
 #include "bsp.h"
 #include "element.h"
 
 namespace Ms {
-//---------------------------------------------------------
-//   InsertItemBspTreeVisitor
-//---------------------------------------------------------
-
-class InsertItemBspTreeVisitor : public BspTreeVisitor
-{
-public:
-    Element* item;
-
-    inline void visit(QList<Element*>* items) { items->prepend(item); }
-};
-
-//---------------------------------------------------------
-//   RemoveItemBspTreeVisitor
-//---------------------------------------------------------
-
-class RemoveItemBspTreeVisitor : public BspTreeVisitor
-{
-public:
-    Element* item;
-
-    inline void visit(QList<Element*>* items) { items->removeAll(item); }
-};
-
-//---------------------------------------------------------
-//   FindItemBspTreeVisitor
-//---------------------------------------------------------
-
-class FindItemBspTreeVisitor : public BspTreeVisitor
-{
-public:
-    QList<Element*> foundItems;
+static const int ITEMS_PER_CELL = 4;          // average number of elements per grid cell
 
-    void visit(QList<Element*>* items)
-    {
-        for (int i = 0; i < items->size(); ++i) {
-            Element* item = items->at(i);
-            if (!item->itemDiscovered) {
-                item->itemDiscovered = true;
-                foundItems.prepend(item);
-            }
-        }
-    }
-};
-
-//---------------------------------------------------------
-//   BspTree
 //---------------------------------------------------------
-
-BspTree::BspTree()
-    : leafCnt(0)
-{
-    depth = 0;
-}
-
-//---------------------------------------------------------
-//   intmaxlog
+//   initialize
+//    prepare the grid for about n elements in rect
 //---------------------------------------------------------
 
-static inline int intmaxlog(int n)
+void BspTree::initialize(const QRectF& rec, int n)
 {
-    return n > 0 ? qMax(int(::ceil(::log(qreal(n)) / ::log(qreal(2)))), 5) : 0;
+    clear();
+    rect = rec.normalized();
+    _items.reserve(n);
+    setupGrid(n);
 }
 
 //---------------------------------------------------------
-//   initialize
+//   setupGrid
+//    choose a grid of roughly square cells
 //---------------------------------------------------------
 
-void BspTree::initialize(const QRectF& rec, int n)
+void BspTree::setupGrid(int n)
 {
-    depth      = intmaxlog(n);
-    this->rect = rec;
-    leafCnt    = 0;
-
-    nodes.resize((1 << (depth + 1)) - 1);
-    leaves.resize(1 << depth);
-    leaves.fill(QList<Element*>());
-    initialize(rec, depth, 0);
+    const qreal w = qMax(rect.width(), 1.0);
+    const qreal h = qMax(rect.height(), 1.0);
+    const int cells = qMax(n / ITEMS_PER_CELL, 1);
+    columns    = qBound(1, int(sqrt(cells * w / h) + .5), cells);
+    rows       = qMax(1, cells / columns);
+    cellWidth  = w / columns;
+    cellHeight = h / rows;
 }
 
 //---------------------------------------------------------
@@ -103,9 +51,14 @@ void BspTree::initialize(const QRectF& rec, int n)
 
 void BspTree::clear()
 {
-    leafCnt = 0;
-    nodes.clear();
-    leaves.clear();
+    _items.clear();
+    cellStart.clear();
+    cellItems.clear();
+    stamp.clear();
+    curStamp = 0;
+    dirty    = false;
+    columns  = 0;
+    rows     = 0;
 }
 
 //---------------------------------------------------------
@@ -114,9 +67,8 @@ void BspTree::clear()
 
 void BspTree::insert(Element* element)
 {
-    InsertItemBspTreeVisitor insertVisitor;
-    insertVisitor.item = element;
-    climbTree(&insertVisitor, element->pageBoundingRect());
+    _items.push_back({ element->pageBoundingRect(), element });
+    dirty = true;
 }
 
 //---------------------------------------------------------
@@ -125,229 +77,147 @@ void BspTree::insert(Element* element)
 
 void BspTree::remove(Element* element)
 {
-    RemoveItemBspTreeVisitor removeVisitor;
-    removeVisitor.item = element;
-    climbTree(&removeVisitor, element->pageBoundingRect());
+    auto i = std::find_if(_items.begin(), _items.end(), [element](const Item& item) { return item.element == element; });
+    if (i != _items.end()) {
+        _items.erase(i);
+        dirty = true;
+    }
 }
 
 //---------------------------------------------------------
-//   items
+//   column
+//    grid column of x, elements outside of the grid
+//    rectangle go into the border cells
 //---------------------------------------------------------
 
-QList<Element*> BspTree::items(const QRectF& rec)
+int BspTree::column(qreal x) const
 {
-    FindItemBspTreeVisitor findVisitor;
-    climbTree(&findVisitor, rec);
-    QList<Element*> l;
-    for (Element* e : findVisitor.foundItems) {
-        e->itemDiscovered = false;
-        if (e->pageBoundingRect().intersects(rec)) {
-            l.append(e);
-        }
+    const qreal c = (x - rect.left()) / cellWidth;
+    if (!(c >= 0.0)) {              // also catches NaN
+        return 0;
     }
-    return l;
+    return c >= columns ? columns - 1 : int(c);
 }
 
 //---------------------------------------------------------
-//   items
+//   row
 //---------------------------------------------------------
 
-QList<Element*> BspTree::items(const QPointF& pos)
+int BspTree::row(qreal y) const
 {
-    FindItemBspTreeVisitor findVisitor;
-    climbTree(&findVisitor, pos);
-
-    QList<Element*> l;
-    for (Element* e : findVisitor.foundItems) {
-        e->itemDiscovered = false;
-        if (e->contains(pos)) {
-            l.append(e);
-        }
+    const qreal r = (y - rect.top()) / cellHeight;
+    if (!(r >= 0.0)) {
+        return 0;
     }
-    return l;
+    return r >= rows ? rows - 1 : int(r);
 }
 
-#ifndef NDEBUG
 //---------------------------------------------------------
-//   debug
+//   nextStamp
 //---------------------------------------------------------
 
-QString BspTree::debug(int index) const
+unsigned BspTree::nextStamp()
 {
-    const Node* node = &nodes.at(index);
-
-    QString tmp;
-    if (node->type == Node::Type::LEAF) {
-        QRectF rec = rectForIndex(index);
-        if (!leaves[node->leafIndex].empty()) {
-            tmp += QString::fromLatin1("[%1, %2, %3, %4] contains %5 items\n")
-                   .arg(rec.left()).arg(rec.top())
-                   .arg(rec.width()).arg(rec.height())
-                   .arg(leaves[node->leafIndex].size());
-        }
-    } else {
-        if (node->type == Node::Type::HORIZONTAL) {
-            tmp += debug(firstChildIndex(index));
-            tmp += debug(firstChildIndex(index) + 1);
-        } else {
-            tmp += debug(firstChildIndex(index));
-            tmp += debug(firstChildIndex(index) + 1);
-        }
+    if (++curStamp == 0) {
+        std::fill(stamp.begin(), stamp.end(), 0);
+        curStamp = 1;
     }
-    return tmp;
+    return curStamp;
 }
 
-#endif
-
 //---------------------------------------------------------
-//   initialize
+//   build
+//    distribute the item indices to the grid cells
+//    (counting sort into one contiguous array)
 //---------------------------------------------------------
 
-void BspTree::initialize(const QRectF& rec, int dep, int index)
+void BspTree::build()
 {
-    Node* node = &nodes[index];
-    if (index == 0) {
-        node->type = Node::Type::HORIZONTAL;
-        node->offset = rec.center().x();
+    dirty = false;
+    if (columns == 0) {
+        setupGrid(int(_items.size()));
     }
-
-    if (dep) {
-        Node::Type type;
-        QRectF rect1, rect2;
-        qreal offset1, offset2;
-
-        if (node->type == Node::Type::HORIZONTAL) {
-            type = Node::Type::VERTICAL;
-            rect1.setRect(rec.left(), rec.top(), rec.width(), rec.height() * .5);
-            rect2.setRect(rect1.left(), rect1.bottom(), rect1.width(), rec.height() - rect1.height());
-            offset1 = rect1.center().x();
-            offset2 = rect2.center().x();
-        } else {
-            type = Node::Type::HORIZONTAL;
-            rect1.setRect(rec.left(), rec.top(), rec.width() * .5, rec.height());
-            rect2.setRect(rect1.right(), rect1.top(), rec.width() - rect1.width(), rect1.height());
-            offset1 = rect1.center().y();
-            offset2 = rect2.center().y();
+    const int cells = columns * rows;
+    cellStart.assign(cells + 1, 0);
+
+    for (const Item& item : _items) {
+        const QRectF bbox = item.bbox.normalized();
+        const int c1 = column(bbox.left());
+        const int c2 = column(bbox.right());
+        for (int r = row(bbox.top()); r <= row(bbox.bottom()); ++r) {
+            for (int c = c1; c <= c2; ++c) {
+                ++cellStart[r * columns + c + 1];
+            }
         }
-
-        int childIndex = firstChildIndex(index);
-
-        Node* child   = &nodes[childIndex];
-        child->offset = offset1;
-        child->type   = type;
-
-        child = &nodes[childIndex + 1];
-        child->offset = offset2;
-        child->type   = type;
-
-        initialize(rect1, dep - 1, childIndex);
-        initialize(rect2, dep - 1, childIndex + 1);
-    } else {
-        node->type      = Node::Type::LEAF;
-        node->leafIndex = leafCnt++;
     }
+    for (int i = 0; i < cells; ++i) {
+        cellStart[i + 1] += cellStart[i];
+    }
+    cellItems.resize(cellStart[cells]);
+
+    std::vector<int> fill(cellStart.begin(), cellStart.end() - 1);
+    for (int idx = 0; idx < int(_items.size()); ++idx) {
+        const QRectF bbox = _items[idx].bbox.normalized();
+        const int c1 = column(bbox.left());
+        const int c2 = column(bbox.right());
+        for (int r = row(bbox.top()); r <= row(bbox.bottom()); ++r) {
+            for (int c = c1; c <= c2; ++c) {
+                cellItems[fill[r * columns + c]++] = idx;
+            }
+        }
+    }
+    stamp.assign(_items.size(), 0);
+    curStamp = 0;
 }
 
 //---------------------------------------------------------
-//   climbTree
+//   items
 //---------------------------------------------------------
 
-void BspTree::climbTree(BspTreeVisitor* visitor, const QPointF& pos, int index)
+QList<Element*> BspTree::items(const QRectF& rec)
 {
-    if (nodes.empty()) {
-        return;
-    }
-
-    Node* node = &nodes[index];
-    int childIndex = firstChildIndex(index);
-
-    switch (node->type) {
-    case Node::Type::LEAF:
-        visitor->visit(&leaves[node->leafIndex]);
-        break;
-    case Node::Type::VERTICAL:
-        if (pos.x() < node->offset) {
-            climbTree(visitor, pos, childIndex);
-        } else {
-            climbTree(visitor, pos, childIndex + 1);
-        }
-        break;
-    case Node::Type::HORIZONTAL:
-        if (pos.y() < node->offset) {
-            climbTree(visitor, pos, childIndex);
-        } else {
-            climbTree(visitor, pos, childIndex + 1);
-        }
-        break;
-    }
+    QList<Element*> l;
+    visit(rec, [&l](Element* e) { l.append(e); });
+    return l;
 }
 
 //---------------------------------------------------------
-//   climbTree
+//   items
 //---------------------------------------------------------
 
-void BspTree::climbTree(BspTreeVisitor* visitor, const QRectF& rec, int index)
+QList<Element*> BspTree::items(const QPointF& pos)
 {
-    if (nodes.empty()) {
-        return;
-    }
-
-    Node* node = &nodes[index];
-    int childIndex = firstChildIndex(index);
-
-    switch (node->type) {
-    case Node::Type::LEAF:
-        visitor->visit(&leaves[node->leafIndex]);
-        break;
-    case Node::Type::VERTICAL:
-        if (rec.left() < node->offset) {
-            climbTree(visitor, rec, childIndex);
-            if (rec.right() >= node->offset) {
-                climbTree(visitor, rec, childIndex + 1);
-            }
-        } else {
-            climbTree(visitor, rec, childIndex + 1);
-        }
-        break;
-    case Node::Type::HORIZONTAL:
-        if (rec.top() < node->offset) {
-            climbTree(visitor, rec, childIndex);
-            if (rec.bottom() >= node->offset) {
-                climbTree(visitor, rec, childIndex + 1);
-            }
-        } else {
-            climbTree(visitor, rec, childIndex + 1);
+    QList<Element*> l;
+    visit(pos, [&l, &pos](Element* e) {
+        if (e->contains(pos)) {
+            l.append(e);
         }
-    }
+    });
+    return l;
 }
 
+#ifndef NDEBUG
 //---------------------------------------------------------
-//   rectForIndex
+//   debug
 //---------------------------------------------------------
 
-QRectF BspTree::rectForIndex(int index) const
+QString BspTree::debug() const
 {
-    if (index <= 0) {
-        return rect;
-    }
-
-    int parentIdx = parentIndex(index);
-    QRectF rec   = rectForIndex(parentIdx);
-    const Node* parent = &nodes.at(parentIdx);
-
-    if (parent->type == Node::Type::HORIZONTAL) {
-        if (index & 1) {
-            rec.setRight(parent->offset);
-        } else {
-            rec.setLeft(parent->offset);
-        }
-    } else {
-        if (index & 1) {
-            rec.setBottom(parent->offset);
-        } else {
-            rec.setTop(parent->offset);
+    QString tmp;
+    for (int r = 0; r < rows; ++r) {
+        for (int c = 0; c < columns; ++c) {
+            const int cell = r * columns + c;
+            const int n = cellStart.empty() ? 0 : cellStart[cell + 1] - cellStart[cell];
+            if (n) {
+                tmp += QString::fromLatin1("[%1, %2, %3, %4] contains %5 items\n")
+                       .arg(rect.left() + c * cellWidth).arg(rect.top() + r * cellHeight)
+                       .arg(cellWidth).arg(cellHeight)
+                       .arg(n);
+            }
         }
     }
-    return rec;
+    return tmp;
 }
+
+#endif
 }
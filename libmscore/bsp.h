@@ -8,59 +8,63 @@
 //  it under the terms of the GNU General Public License version 2
 //  as published by the Free Software Foundation and appearing in
 //  the file LICENCE.GPL
-//
-//  This code is from Qt implementation of QGraphicsItem
-//    Copyright (C) 1992-2007 Trolltech ASA. All rights reserved.
 //=============================================================================
 
 #ifndef __BSP_H__
 #define __BSP_H__
 
 namespace Ms {
-class BspTreeVisitor;
-class InsertItemBspTreeVisitor;
-class RemoveItemBspTreeVisitor;
-class FindItemBspTreeVisitor;
-
 class Element;
 
 //---------------------------------------------------------
 //   BspTree
-//    binary space partitioning
+//    spatial index of the elements of a page
+//
+//    Despite the name this is a uniform grid: the elements
+//    and their bounding boxes are kept in one flat array,
+//    the grid cells refer to them by index. The cells are
+//    built lazily on the first query after an insert or
+//    remove.
+//
+//    The bounding box of an element is taken when it is
+//    inserted and not updated afterwards: an element that
+//    moves or changes its size has to be removed and
+//    inserted again. Pages do this by rebuilding the whole
+//    tree after layout (Page::rebuildBspTree()), so queries
+//    between an edit and the next layout may see the old
+//    position.
 //---------------------------------------------------------
 
 class BspTree
 {
-public:
-    struct Node {
-        enum class Type : char {
-            HORIZONTAL, VERTICAL, LEAF
-        };
-        union {
-            qreal offset;
-            int leafIndex;
-        };
-        Type type;
+    struct Item {
+        QRectF bbox;
+        Element* element;
     };
-private:
-    uint depth;
-    void initialize(const QRectF& rect, int depth, int index);
-    void climbTree(BspTreeVisitor* visitor, const QPointF& pos, int index = 0);
-    void climbTree(BspTreeVisitor* visitor, const QRectF& rect, int index = 0);
-
-    void findItems(QList<Element*>* foundItems, const QRectF& rect, int index);
-    void findItems(QList<Element*>* foundItems, const QPointF& pos, int index);
-    QRectF rectForIndex(int index) const;
-
-    QVector<Node> nodes;
-    QVector<QList<Element*> > leaves;
-    int leafCnt;
+
+    std::vector<Item> _items;
+    std::vector<int> cellStart;           // start of every cell in cellItems, one extra entry at the end
+    std::vector<int> cellItems;           // indices into _items, grouped by cell
+    std::vector<unsigned> stamp;          // avoids reporting items twice during a query
+    unsigned curStamp   { 0 };
+    bool dirty          { false };
+
     QRectF rect;
+    int columns         { 0 };
+    int rows            { 0 };
+    qreal cellWidth     { 1.0 };
+    qreal cellHeight    { 1.0 };
+
+    void setupGrid(int n);
+    void build();
+    int column(qreal x) const;
+    int row(qreal y) const;
+    unsigned nextStamp();
 
 public:
-    BspTree();
+    BspTree() {}
 
-    void initialize(const QRectF& rect, int depth);
+    void initialize(const QRectF& rect, int n);
     void clear();
 
     void insert(Element* item);
@@ -69,28 +73,74 @@ public:
     QList<Element*> items(const QRectF& rect);
     QList<Element*> items(const QPointF& pos);
 
-    int leafCount() const { return leafCnt; }
-    inline int firstChildIndex(int index) const { return index * 2 + 1; }
+    template<typename F> void visit(const QRectF& rect, F func);
+    template<typename F> void visit(const QPointF& pos, F func);
 
-    inline int parentIndex(int index) const
-    {
-        return index > 0 ? ((index & 1) ? ((index - 1) / 2) : ((index - 2) / 2)) : -1;
-    }
+    int leafCount() const { return columns * rows; }
 
 #ifndef NDEBUG
-    QString debug(int index) const;
+    QString debug() const;
 #endif
 };
 
 //---------------------------------------------------------
-//   BspTreeVisitor
+//   visit
+//    call func for every element whose bounding box
+//    intersects rect, without allocating memory
 //---------------------------------------------------------
 
-class BspTreeVisitor
+template<typename F>
+void BspTree::visit(const QRectF& r, F func)
 {
-public:
-    virtual ~BspTreeVisitor() {}
-    virtual void visit(QList<Element*>* items) = 0;
-};
+    if (dirty) {
+        build();
+    }
+    if (_items.empty()) {
+        return;
+    }
+    const unsigned s = nextStamp();
+    const QRectF nr  = r.normalized();
+    const int c1 = column(nr.left());
+    const int c2 = column(nr.right());
+    const int r1 = row(nr.top());
+    const int r2 = row(nr.bottom());
+    for (int ri = r1; ri <= r2; ++ri) {
+        for (int ci = c1; ci <= c2; ++ci) {
+            const int cell = ri * columns + ci;
+            for (int k = cellStart[cell]; k < cellStart[cell + 1]; ++k) {
+                const int idx = cellItems[k];
+                if (stamp[idx] == s) {
+                    continue;
+                }
+                stamp[idx] = s;
+                const Item& item = _items[idx];
+                if (item.bbox.intersects(r)) {
+                    func(item.element);
+                }
+            }
+        }
+    }
+}
+
+//---------------------------------------------------------
+//   visit
+//    call func for every element in the grid cell of pos;
+//    the caller has to check Element::contains()
+//---------------------------------------------------------
+
+template<typename F>
+void BspTree::visit(const QPointF& pos, F func)
+{
+    if (dirty) {
+        build();
+    }
+    if (_items.empty()) {
+        return;
+    }
+    const int cell = row(pos.y()) * columns + column(pos.x());
+    for (int k = cellStart[cell]; k < cellStart[cell + 1]; ++k) {
+        func(_items[cellItems[k]].element);
+    }
+}
 }     // namespace Ms
 #endif
@@ -223,6 +223,10 @@ void Score::startCmd()
         qDebug("===startCmd()");
     }
 
+    // edits are applied to all linked part scores, and deferred
+    // part scores can only be linked to an unedited master score
+    masterScore()->readDeferredExcerpts();
+
     cmdState().reset();
 
     // Start collecting low-level undo operations for a
@@ -244,13 +248,16 @@ void Score::undoRedo(bool undo, EditData* ed)
         return;
     }
     cmdState().reset();
+    UndoMacro* cmd = undo ? undoStack()->last() : undoStack()->next();
     if (undo) {
         undoStack()->undo(ed);
     } else {
         undoStack()->redo(ed);
     }
+    if (cmd) {
+        setPlaylistDirty(cmd);
+    }
     update(false);
-    masterScore()->setPlaylistDirty();    // TODO: flag all individual operations
     updateSelection();
 }
 
@@ -271,6 +278,15 @@ void Score::endCmd(const bool isCmdFromInspector, bool rollback)
         rollback = true;
     }
 
+    // render only the playback of the changed chords again; a
+    // command that changed the score without undo leaves the macro
+    // empty, then the whole playlist has to be rendered
+    if (!undoStack()->current()->empty()) {
+        setPlaylistDirty(undoStack()->current());
+    } else if (dirty()) {
+        masterScore()->setPlaylistDirty();
+    }
+
     if (rollback) {
         undoStack()->current()->unwind();
     }
@@ -284,7 +300,6 @@ void Score::endCmd(const bool isCmdFromInspector, bool rollback)
     undoStack()->endMacro(noUndo);
 
     if (dirty()) {
-        masterScore()->setPlaylistDirty();      // TODO: flag individual operations
         masterScore()->setAutosaveDirty(true);
     }
     MuseScoreCore::mscoreCore->endCmd(isCmdFromInspector, rollback);
@@ -190,7 +190,6 @@ Element::Element(const Element& e)
     _color      = e._color;
     _offsetChanged = e._offsetChanged;
     _minDistance   = e._minDistance;
-    itemDiscovered = false;
 }
 
 //---------------------------------------------------------
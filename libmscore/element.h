@@ -441,8 +441,6 @@ public:
  */
     virtual bool mousePress(EditData&) { return false; }
 
-    mutable bool itemDiscovered      { false };       ///< helper flag for bsp
-
     void scanElements(void* data, void (* func)(void*, Element*), bool all=true) override;
 
     virtual void reset() override;           // reset all properties & position to default
@@ -104,6 +104,59 @@ void Excerpt::read(XmlReader& e)
     }
 }
 
+//---------------------------------------------------------
+//   readDeferred
+//    keep the <Score> element of a part score as XML; only
+//    the title and the track list are needed before the
+//    part score is read
+//---------------------------------------------------------
+
+void Excerpt::readDeferred(XmlReader& e)
+{
+    QXmlStreamWriter xml(&_partXml);
+    int depth   = 0;
+    bool inName = false;
+    QString name;
+    for (;;) {
+        if (e.isStartElement()) {
+            if (depth == 1) {
+                if (e.name() == "name") {
+                    inName = true;
+                } else if (e.name() == "Tracklist") {
+                    int strack = e.intAttribute("sTrack",   -1);
+                    int dtrack = e.intAttribute("dstTrack", -1);
+                    if (strack != -1 && dtrack != -1) {
+                        _tracks.insert(strack, dtrack);
+                    }
+                }
+            }
+            ++depth;
+        } else if (e.isEndElement()) {
+            --depth;
+            inName = false;
+        } else if (e.isCharacters() && inName) {
+            name += e.text();
+        }
+        xml.writeCurrentToken(e);
+        if (depth == 0 || e.atEnd() || e.hasError()) {
+            break;
+        }
+        e.readNext();
+    }
+    _title = name;
+}
+
+//---------------------------------------------------------
+//   takePartXml
+//---------------------------------------------------------
+
+QByteArray Excerpt::takePartXml()
+{
+    QByteArray data;
+    data.swap(_partXml);
+    return data;
+}
+
 //---------------------------------------------------------
 //   operator!=
 //---------------------------------------------------------
@@ -240,12 +293,14 @@ void Excerpt::createExcerpt(Excerpt* excerpt)
         score->setMetaTag("partName", partLabel);
     }
 
-    // initial layout of score
     score->addLayoutFlags(LayoutFlag::FIX_PITCH_VELO);
-    score->doLayout();
 
     // handle transposing instruments
     if (oscore->styleB(Sid::concertPitch) != score->styleB(Sid::concertPitch)) {
+        // initial layout of score, transposition works on the
+        // multimeasure rests created by layout
+        score->doLayout();
+
         for (const Staff* staff : score->staves()) {
             if (staff->staffType(Fraction(0,1))->group() == StaffGroup::PERCUSSION) {
                 continue;
@@ -311,7 +366,8 @@ void Excerpt::createExcerpt(Excerpt* excerpt)
         score->styleChanged();
     }
 
-    // second layout of score
+    // final layout of score; the only one unless the concert
+    // pitch setting differs from the master score
     score->setPlaylistDirty();
     oscore->rebuildMidiMapping();
     oscore->updateChannel();
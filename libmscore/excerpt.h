@@ -28,6 +28,10 @@ class XmlReader;
 
 //---------------------------------------------------------
 //   @@ Excerpt
+//    The part score of an excerpt read from a file is only
+//    kept as XML until MasterScore::readDeferredExcerpts()
+//    is called; until then partScore() is null and parts()
+//    is empty.
 //---------------------------------------------------------
 
 class Excerpt : public QObject
@@ -39,6 +43,8 @@ class Excerpt : public QObject
     QList<Part*> _parts;
     QMultiMap<int, int> _tracks;
 
+    QByteArray _partXml;                          // deferred part score
+
 public:
     Excerpt(MasterScore* s = 0) { _oscore = s; }
     Excerpt(const Excerpt& ex, bool copyPartScore = true);
@@ -56,8 +62,11 @@ public:
     MasterScore* oscore() const { return _oscore; }
     Score* partScore() const { return _partScore; }
     void setPartScore(Score* s);
+    bool partScoreDeferred() const { return !_partXml.isEmpty(); }
+    QByteArray takePartXml();
 
     void read(XmlReader&);
+    void readDeferred(XmlReader&);
 
     bool operator!=(const Excerpt&) const;
     bool operator==(const Excerpt&) const;
@@ -68,6 +68,7 @@ bool ImageStoreItem::isUsed(Score* score) const
 
 void ImageStoreItem::load()
 {
+    fetch();
     if (!_buffer.isEmpty()) {
         return;
     }
@@ -77,12 +78,43 @@ void ImageStoreItem::load()
         return;
     }
     _buffer = inFile.readAll();
+    _archive.clear();
     inFile.close();
     QCryptographicHash h(QCryptographicHash::Md4);
     h.addData(_buffer);
     _hash = h.result();
 }
 
+//---------------------------------------------------------
+//   fetch
+//---------------------------------------------------------
+
+void ImageStoreItem::fetch() const
+{
+    if (_loader) {
+        _buffer = _loader();
+        _loader = nullptr;
+    }
+}
+
+//---------------------------------------------------------
+//   setArchive
+//    the image is now stored in another score file and is
+//    read or copied from there; without a loader it is
+//    read into memory and no file is used any more
+//---------------------------------------------------------
+
+void ImageStoreItem::setArchive(std::function<QByteArray()> f, const QString& archive, uint crc)
+{
+    if (!f) {
+        fetch();
+    } else if (_loader) {
+        _loader = f;
+    }
+    _archive    = archive;
+    _archiveCrc = crc;
+}
+
 //---------------------------------------------------------
 //   hashName
 //---------------------------------------------------------
@@ -122,6 +154,24 @@ inline static int toInt(char c)
     return c - 'a' + 10;
 }
 
+//---------------------------------------------------------
+//   hashFromName
+//    images are stored under the hex md4 hash of their data
+//---------------------------------------------------------
+
+static bool hashFromName(const QString& path, QByteArray& hash)
+{
+    QString s = QFileInfo(path).completeBaseName();
+    if (s.size() != 32) {
+        return false;
+    }
+    hash = QByteArray(16, 0);
+    for (int i = 0; i < 16; ++i) {
+        hash[i] = toInt(s[i * 2].toLatin1()) * 16 + toInt(s[i * 2 + 1].toLatin1());
+    }
+    return true;
+}
+
 #if 0
 //---------------------------------------------------------
 //   dumpHash
@@ -156,8 +206,8 @@ ImageStore::~ImageStore()
 
 ImageStoreItem* ImageStore::getImage(const QString& path) const
 {
-    QString s = QFileInfo(path).completeBaseName();
-    if (s.size() != 32) {
+    QByteArray hash;
+    if (!hashFromName(path, hash)) {
         //
         // some limited support for backward compatibility
         //
@@ -167,17 +217,13 @@ ImageStoreItem* ImageStore::getImage(const QString& path) const
             }
         }
         qDebug("ImageStore::getImage(%s): bad base name <%s>",
-               qPrintable(path), qPrintable(s));
+               qPrintable(path), qPrintable(QFileInfo(path).completeBaseName()));
         for (ImageStoreItem* item : _items) {
             qDebug("    in store: <%s>", qPrintable(item->path()));
         }
 
         return 0;
     }
-    QByteArray hash(16, 0);
-    for (int i = 0; i < 16; ++i) {
-        hash[i] = toInt(s[i * 2].toLatin1()) * 16 + toInt(s[i * 2 + 1].toLatin1());
-    }
     for (ImageStoreItem* item : _items) {
         if (item->hash() == hash) {
             return item;
@@ -207,6 +253,31 @@ ImageStoreItem* ImageStore::add(const QString& path, const QByteArray& ba)
     return item;
 }
 
+//---------------------------------------------------------
+//   addDeferred
+//    add an image stored under its hash name in archive;
+//    the data is only fetched by the loader when it is
+//    first used
+//---------------------------------------------------------
+
+ImageStoreItem* ImageStore::addDeferred(const QString& path, std::function<QByteArray()> loader, const QString& archive,
+                                        uint crc)
+{
+    QByteArray hash;
+    if (!hashFromName(path, hash)) {
+        return add(path, loader());
+    }
+    for (ImageStoreItem* item : _items) {
+        if (item->hash() == hash) {
+            return item;
+        }
+    }
+    ImageStoreItem* item = new ImageStoreItem(path);
+    item->setLoader(loader, hash, archive, crc);
+    _items.push_back(item);
+    return item;
+}
+
 //---------------------------------------------------------
 //   clearUnused
 //---------------------------------------------------------
@@ -26,17 +26,22 @@ class ImageStoreItem
     QList<Image*> _references;
     QString _path;                  // original location of image
     QString _type;                  // image type (file extension)
-    QByteArray _buffer;
+    mutable QByteArray _buffer;
+    mutable std::function<QByteArray()> _loader;  // fetches _buffer on first use
+    QString _archive;               // score file holding the image under hashName()
+    uint _archiveCrc { 0 };         // crc32 of the image in _archive
     QByteArray _hash;               // 16 byte md4 hash of _buffer
 
+    void fetch() const;
+
 public:
     ImageStoreItem(const QString& p);
     void dereference(Image*);
     void reference(Image*);
 
     const QString& path() const { return _path; }
-    QByteArray& buffer() { return _buffer; }
-    const QByteArray& buffer() const { return _buffer; }
+    QByteArray& buffer() { fetch(); return _buffer; }
+    const QByteArray& buffer() const { fetch(); return _buffer; }
     bool loaded() const { return !_buffer.isEmpty(); }
     void setPath(const QString& val);
     bool isUsed(Score*) const;
@@ -44,7 +49,18 @@ public:
     void load();
     QString hashName() const;
     const QByteArray& hash() const { return _hash; }
-    void set(const QByteArray& b, const QByteArray& h) { _buffer = b; _hash = h; }
+    const QString& archive() const { return _archive; }
+    uint archiveCrc() const { return _archiveCrc; }
+    void set(const QByteArray& b, const QByteArray& h) { _buffer = b; _hash = h; _loader = nullptr; _archive.clear(); }
+    void setLoader(std::function<QByteArray()> f, const QByteArray& h, const QString& archive, uint crc)
+    {
+        _buffer.clear();
+        _loader = f;
+        _hash = h;
+        _archive = archive;
+        _archiveCrc = crc;
+    }
+    void setArchive(std::function<QByteArray()> f, const QString& archive, uint crc);
 };
 
 //---------------------------------------------------------
@@ -64,6 +80,7 @@ public:
 
     ImageStoreItem* getImage(const QString& path) const;
     ImageStoreItem* add(const QString& path, const QByteArray&);
+    ImageStoreItem* addDeferred(const QString& path, std::function<QByteArray()> loader, const QString& archive, uint crc);
     void clearUnused();
 
     typedef ItemList::iterator iterator;
@@ -24,6 +24,7 @@
 #include "keysig.h"
 #include "layoutbreak.h"
 #include "layout.h"
+#include "layoutprofiler.h"
 #include "lyrics.h"
 #include "marker.h"
 #include "measure.h"
@@ -67,6 +68,8 @@
 #include "fermata.h"
 #include "measurenumber.h"
 
+#include <numeric>
+
 namespace Ms {
 // #define PAGE_DEBUG
 
@@ -148,6 +151,7 @@ static bool vUp(Chord* chord)
 
 void Score::layoutChords1(Segment* segment, int staffIdx)
 {
+    LayoutTimer timer(this, LayoutPhase::LAYOUT_CHORDS1);
     const Staff* staff = Score::staff(staffIdx);
     const int startTrack = staffIdx * VOICES;
     const int endTrack   = startTrack + VOICES;
@@ -843,6 +847,8 @@ static qreal layoutAccidental(AcEl* me, AcEl* above, AcEl* below, qreal colOffse
 
 void Score::layoutChords3(std::vector<Note*>& notes, const Staff* staff, Segment* segment)
 {
+    LayoutTimer timer(this, LayoutPhase::LAYOUT_CHORDS3);
+
     //---------------------------------------------------
     //    layout accidentals
     //    find column for dots
@@ -1839,13 +1845,25 @@ void LayoutContext::getNextPage()
 
 //---------------------------------------------------------
 //   getNextSystem
+//    reuse the next old system, unless it is complete and
+//    starts after lc.curMeasure: an edit added a system,
+//    and the old one may still be reused unchanged
 //---------------------------------------------------------
 
 System* Score::getNextSystem(LayoutContext& lc)
 {
     bool isVBox = lc.curMeasure->isVBox();
     System* system;
-    if (lc.systemList.empty()) {
+    System* next = lc.systemList.empty() ? nullptr : lc.systemList.front();
+    if (next && next->signatureValid() && !next->measures().empty()) {
+        MeasureBase* mb = next->measures().front();
+        if (mb->system() != next || mb->tick() <= lc.curMeasure->tick()) {
+            next = nullptr;
+        }
+    } else {
+        next = nullptr;
+    }
+    if (lc.systemList.empty() || next) {
         system = new System(this);
         lc.systemOldMeasure = 0;
     } else {
@@ -2387,6 +2405,7 @@ int LayoutContext::adjustMeasureNo(MeasureBase* m)
 
 void Score::createBeams(LayoutContext& lc, Measure* measure)
 {
+    LayoutTimer timer(this, LayoutPhase::CREATE_BEAMS);
     bool crossMeasure = styleB(Sid::crossMeasureValues);
 
     for (int track = 0; track < ntracks(); ++track) {
@@ -2743,6 +2762,7 @@ std::pair<qreal, qreal> extendedStemLenWithTwoNoteTremolo(Tremolo* tremolo, qrea
 
 void Score::getNextMeasure(LayoutContext& lc)
 {
+    LayoutTimer timer(this, LayoutPhase::GET_NEXT_MEASURE);
     lc.prevMeasure = lc.curMeasure;
     lc.curMeasure  = lc.nextMeasure;
     if (!lc.curMeasure) {
@@ -3296,6 +3316,7 @@ static void restoreBeams(Measure* m)
 
 void Score::layoutLyrics(System* system)
 {
+    LayoutTimer timer(this, LayoutPhase::LAYOUT_LYRICS);
     std::vector<int> visibleStaves;
     for (int staffIdx = system->firstVisibleStaff(); staffIdx < nstaves();
          staffIdx = system->nextVisibleStaff(staffIdx)) {
@@ -3701,6 +3722,7 @@ System* Score::collectSystem(LayoutContext& lc)
     if (!lc.curMeasure) {
         return 0;
     }
+    LayoutTimer timer(this, LayoutPhase::COLLECT_SYSTEM);
     Measure* measure  = _systems.empty() ? 0 : _systems.back()->lastMeasure();
     if (measure) {
         lc.firstSystem        = measure->sectionBreak() && _layoutMode != LayoutMode::FLOAT;
@@ -3764,6 +3786,9 @@ System* Score::collectSystem(LayoutContext& lc)
             // vbox:
             getNextMeasure(lc);
             system->layout2();         // compute staff distances
+            if (timer.profiler()) {
+                timer.profiler()->addSystem(system, timer.elapsed());
+            }
             return system;
         }
         // check if lc.curMeasure fits, remove if not
@@ -3860,8 +3885,9 @@ System* Score::collectSystem(LayoutContext& lc)
 
     if (lc.endTick < lc.prevMeasure->tick()) {
         // we've processed the entire range
-        // but we need to continue layout until we reach a system whose last measure is the same as previous layout
-        if (lc.prevMeasure == lc.systemOldMeasure) {
+        // but we need to continue layout until we reach a system whose last measure is the same as previous layout,
+        // or one which ends where a complete old system starts
+        if (lc.prevMeasure == lc.systemOldMeasure || lc.reuseSystems()) {
             // this system ends in the same place as the previous layout
             // ok to stop
             if (lc.curMeasure && lc.curMeasure->isMeasure()) {
@@ -4018,15 +4044,121 @@ System* Score::collectSystem(LayoutContext& lc)
         lc.startWithLongNames = lc.firstSystem && lm->sectionBreakElement()->startWithLongNames();
     }
 
+    if (timer.profiler()) {
+        timer.profiler()->addSystem(system, timer.elapsed());
+    }
     return system;
 }
 
+//---------------------------------------------------------
+//   createSkyline
+//    build the skyline of one staff of a system
+//---------------------------------------------------------
+
+static void createSkyline(System* system, int staffIdx, const LayoutContext& lc)
+{
+    const bool lineMode = system->score()->lineMode();
+    SysStaff* ss = system->staff(staffIdx);
+    Skyline& skyline = ss->skyline();
+    skyline.clear();
+    for (MeasureBase* mb : system->measures()) {
+        if (!mb->isMeasure()) {
+            continue;
+        }
+        Measure* m = toMeasure(mb);
+        MeasureNumber* mno = m->noText(staffIdx);
+        // no need to build skyline outside of range in continuous view
+        if (lineMode && (m->tick() < lc.startTick || m->tick() > lc.endTick)) {
+            continue;
+        }
+        if (mno && mno->addToSkyline()) {
+            ss->skyline().add(mno->bbox().translated(m->pos() + mno->pos()));
+        }
+        if (m->staffLines(staffIdx)->addToSkyline()) {
+            ss->skyline().add(m->staffLines(staffIdx)->bbox().translated(m->pos()));
+        }
+        for (Segment& s : m->segments()) {
+            if (!s.enabled() || s.isTimeSigType()) {             // hack: ignore time signatures
+                continue;
+            }
+            QPointF p(s.pos() + m->pos());
+            if (s.segmentType()
+                & (SegmentType::BarLine | SegmentType::EndBarLine | SegmentType::StartRepeatBarLine
+                   | SegmentType::BeginBarLine)) {
+                BarLine* bl = toBarLine(s.element(staffIdx * VOICES));
+                if (bl && bl->addToSkyline()) {
+                    QRectF r = bl->layoutRect();
+                    skyline.add(r.translated(bl->pos() + p));
+                }
+            } else {
+                int strack = staffIdx * VOICES;
+                int etrack = strack + VOICES;
+                for (Element* e : s.elist()) {
+                    if (!e) {
+                        continue;
+                    }
+                    int effectiveTrack = e->vStaffIdx() * VOICES + e->voice();
+                    if (effectiveTrack < strack || effectiveTrack >= etrack) {
+                        continue;
+                    }
+
+                    // clear layout for chord-based fingerings
+                    // do this before adding chord to skyline
+                    if (e->isChord()) {
+                        Chord* c = toChord(e);
+                        std::list<Note*> notes;
+                        for (auto gc : c->graceNotes()) {
+                            for (auto n : gc->notes()) {
+                                notes.push_back(n);
+                            }
+                        }
+                        for (auto n : c->notes()) {
+                            notes.push_back(n);
+                        }
+                        for (Note* note : notes) {
+                            for (Element* en : note->el()) {
+                                if (en->isFingering()) {
+                                    Fingering* f = toFingering(en);
+                                    if (f->layoutType() == ElementType::CHORD) {
+                                        f->setPos(QPointF());
+                                        f->setbbox(QRectF());
+                                    }
+                                }
+                            }
+                        }
+                    }
+
+                    // add element to skyline
+                    if (e->addToSkyline()) {
+                        skyline.add(e->shape().translated(e->pos() + p));
+                    }
+
+                    // add tremolo to skyline
+                    if (e->isChord() && toChord(e)->tremolo()) {
+                        Tremolo* t = toChord(e)->tremolo();
+                        Chord* c1 = t->chord1();
+                        Chord* c2 = t->chord2();
+                        if (!t->twoNotes() || (c1 && !c1->staffMove() && c2 && !c2->staffMove())) {
+                            if (t->chord() == e && t->addToSkyline()) {
+                                skyline.add(t->shape().translated(t->pos() + e->pos() + p));
+                            }
+                        }
+                    }
+                }
+            }
+        }
+    }
+}
+
 //---------------------------------------------------------
 //   layoutSystemElements
 //---------------------------------------------------------
 
 void Score::layoutSystemElements(System* system, LayoutContext& lc)
 {
+    LayoutTimer timer(this, LayoutPhase::LAYOUT_SYSTEM_ELEMENTS);
+    system->invalidateSignature();
+
     //-------------------------------------------------------------
     //    create cr segment list to speed up computations
     //-------------------------------------------------------------
@@ -4078,98 +4210,19 @@ void Score::layoutSystemElements(System* system, LayoutContext& lc)
 
     //-------------------------------------------------------------
     //    create skylines
+    //    every staff only touches its own skyline and the elements
+    //    of its own tracks, so the staves can be processed in parallel
     //-------------------------------------------------------------
 
-    for (int staffIdx = 0; staffIdx < nstaves(); ++staffIdx) {
-        SysStaff* ss = system->staff(staffIdx);
-        Skyline& skyline = ss->skyline();
-        skyline.clear();
-        for (MeasureBase* mb : system->measures()) {
-            if (!mb->isMeasure()) {
-                continue;
-            }
-            Measure* m = toMeasure(mb);
-            MeasureNumber* mno = m->noText(staffIdx);
-            // no need to build skyline outside of range in continuous view
-            if (lineMode() && (m->tick() < lc.startTick || m->tick() > lc.endTick)) {
-                continue;
-            }
-            if (mno && mno->addToSkyline()) {
-                ss->skyline().add(mno->bbox().translated(m->pos() + mno->pos()));
-            }
-            if (m->staffLines(staffIdx)->addToSkyline()) {
-                ss->skyline().add(m->staffLines(staffIdx)->bbox().translated(m->pos()));
-            }
-            for (Segment& s : m->segments()) {
-                if (!s.enabled() || s.isTimeSigType()) {             // hack: ignore time signatures
-                    continue;
-                }
-                QPointF p(s.pos() + m->pos());
-                if (s.segmentType()
-                    & (SegmentType::BarLine | SegmentType::EndBarLine | SegmentType::StartRepeatBarLine
-                       | SegmentType::BeginBarLine)) {
-                    BarLine* bl = toBarLine(s.element(staffIdx * VOICES));
-                    if (bl && bl->addToSkyline()) {
-                        QRectF r = bl->layoutRect();
-                        skyline.add(r.translated(bl->pos() + p));
-                    }
-                } else {
-                    int strack = staffIdx * VOICES;
-                    int etrack = strack + VOICES;
-                    for (Element* e : s.elist()) {
-                        if (!e) {
-                            continue;
-                        }
-                        int effectiveTrack = e->vStaffIdx() * VOICES + e->voice();
-                        if (effectiveTrack < strack || effectiveTrack >= etrack) {
-                            continue;
-                        }
-
-                        // clear layout for chord-based fingerings
-                        // do this before adding chord to skyline
-                        if (e->isChord()) {
-                            Chord* c = toChord(e);
-                            std::list<Note*> notes;
-                            for (auto gc : c->graceNotes()) {
-                                for (auto n : gc->notes()) {
-                                    notes.push_back(n);
-                                }
-                            }
-                            for (auto n : c->notes()) {
-                                notes.push_back(n);
-                            }
-                            for (Note* note : notes) {
-                                for (Element* en : note->el()) {
-                                    if (en->isFingering()) {
-                                        Fingering* f = toFingering(en);
-                                        if (f->layoutType() == ElementType::CHORD) {
-                                            f->setPos(QPointF());
-                                            f->setbbox(QRectF());
-                                        }
-                                    }
-                                }
-                            }
-                        }
-
-                        // add element to skyline
-                        if (e->addToSkyline()) {
-                            skyline.add(e->shape().translated(e->pos() + p));
-                        }
-
-                        // add tremolo to skyline
-                        if (e->isChord() && toChord(e)->tremolo()) {
-                            Tremolo* t = toChord(e)->tremolo();
-                            Chord* c1 = t->chord1();
-                            Chord* c2 = t->chord2();
-                            if (!t->twoNotes() || (c1 && !c1->staffMove() && c2 && !c2->staffMove())) {
-                                if (t->chord() == e && t->addToSkyline()) {
-                                    skyline.add(t->shape().translated(t->pos() + e->pos() + p));
-                                }
-                            }
-                        }
-                    }
-                }
-            }
+    if (MScore::parallelLayout && nstaves() > 1) {
+        std::vector<int> staves(nstaves());
+        std::iota(staves.begin(), staves.end(), 0);
+        QtConcurrent::blockingMap(staves, [system, &lc](int staffIdx) {
+            createSkyline(system, staffIdx, lc);
+        });
+    } else {
+        for (int staffIdx = 0; staffIdx < nstaves(); ++staffIdx) {
+            createSkyline(system, staffIdx, lc);
         }
     }
 
@@ -4603,6 +4656,7 @@ void Score::layoutSystemElements(System* system, LayoutContext& lc)
 
 void LayoutContext::collectPage()
 {
+    LayoutTimer timer(score, LayoutPhase::COLLECT_PAGE);
     const qreal slb = score->styleP(Sid::staffLowerBorder);
     bool breakPages = score->layoutMode() != LayoutMode::SYSTEM;
     //qreal y         = prevSystem ? prevSystem->y() + prevSystem->height() : page->tm();
@@ -4757,6 +4811,17 @@ void LayoutContext::collectPage()
     Fraction stick = Fraction(-1,1);
     for (System* s : page->systems()) {
         Score* currentScore = s->score();
+
+        // The per-measure pass below is not needed for a system
+        // reused from the previous layout unless the system before
+        // it was laid out again: ties and glissandi from there may
+        // end in this system.
+        bool unchanged = s->signatureUnchanged();
+        if (unchanged && prevSystemUnchanged) {
+            continue;
+        }
+        prevSystemUnchanged = unchanged;
+
         for (MeasureBase* mb : s->measures()) {
             if (!mb->isMeasure()) {
                 continue;
@@ -4822,6 +4887,9 @@ void LayoutContext::collectPage()
             m->layout2();
         }
     }
+    for (System* s : page->systems()) {
+        s->saveSignature();
+    }
 
     if (score->systemMode()) {
         System* s = page->systems().last();
@@ -4832,6 +4900,45 @@ void LayoutContext::collectPage()
     page->rebuildBspTree();
 }
 
+//---------------------------------------------------------
+//   reuseSystems
+//    Called when collectSystem() has passed the layout
+//    range and the system just collected does not end at
+//    systemOldMeasure. If a complete old system starts at
+//    curMeasure, it and all old systems after it are laid
+//    out as before and are reused like after a system
+//    ending at systemOldMeasure. The old systems before it
+//    lost their measures to the systems collected again.
+//---------------------------------------------------------
+
+bool LayoutContext::reuseSystems()
+{
+    if (!curMeasure) {
+        return false;
+    }
+    int i = 0;
+    for (; i < systemList.size(); ++i) {
+        const System* s = systemList[i];
+        if (s->measures().empty() || !s->signatureValid()) {
+            continue;
+        }
+        MeasureBase* mb = s->measures().front();
+        if (mb == curMeasure) {
+            break;
+        }
+        if (mb->system() == s && mb->tick() > curMeasure->tick()) {
+            return false;
+        }
+    }
+    if (i == systemList.size()) {
+        return false;
+    }
+    while (i--) {
+        obsoleteSystems.append(systemList.takeFirst());
+    }
+    return true;
+}
+
 //---------------------------------------------------------
 //   doLayout
 //    do a complete (re-) layout
@@ -4862,6 +4969,10 @@ public:
 void Score::doLayoutRange(const Fraction& st, const Fraction& et)
 {
     CmdStateLocker cmdStateLocker(this);
+    if (MScore::layoutProfiling) {
+        layoutProfiler()->startLayout();
+    }
+    LayoutTimer timer(this, LayoutPhase::DO_LAYOUT_RANGE);
     LayoutContext lc(this);
 
     Fraction stick(st);
@@ -5046,6 +5157,10 @@ void LayoutContext::layout()
     } while (curSystem && !(rangeDone && lmb == pageOldMeasure));
     // && page->system(0)->measures().back()->tick() > endTick // FIXME: perhaps the first measure was meant? Or last system?
 
+    // no page refers to them any more
+    qDeleteAll(obsoleteSystems);
+    obsoleteSystems.clear();
+
     if (!curSystem) {
         // The end of the score. The remaining systems are not needed...
         qDeleteAll(systemList);
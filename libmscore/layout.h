@@ -31,6 +31,7 @@ struct LayoutContext {
     Fraction tick            { 0, 1 };
 
     QList<System*> systemList;            // reusable systems
+    QList<System*> obsoleteSystems;       // old systems whose measures were collected again
     std::set<Spanner*> processedSpanners;
 
     System* prevSystem       { 0 };       // used during page layout
@@ -39,6 +40,7 @@ struct LayoutContext {
     MeasureBase* systemOldMeasure;
     MeasureBase* pageOldMeasure;
     bool rangeDone           { false };
+    bool prevSystemUnchanged { false };   // last system finished by collectPage() was reused as is
 
     MeasureBase* prevMeasure { 0 };
     MeasureBase* curMeasure  { 0 };
@@ -59,6 +61,7 @@ struct LayoutContext {
     int adjustMeasureNo(MeasureBase*);
     void getNextPage();
     void collectPage();
+    bool reuseSystems();
 };
 
 //---------------------------------------------------------
@@ -0,0 +1,142 @@
+//=============================================================================
+//  MuseScore
+//  Music Composition & Notation
+//
+//  Copyright (C) 2020 Werner Schweer
+//
+//  This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License version 2
+//  as published by the Free Software Foundation and appearing in
+//  the file LICENCE.GPL
+//=============================================================================
+
+#include "layoutprofiler.h"
+#include "score.h"
+#include "system.h"
+#include "measurebase.h"
+
+namespace Ms {
+//---------------------------------------------------------
+//   LayoutTimer
+//---------------------------------------------------------
+
+LayoutTimer::LayoutTimer(Score* score, LayoutPhase phase)
+    : _profiler(MScore::layoutProfiling ? score->layoutProfiler() : nullptr), _phase(phase)
+{
+    if (_profiler) {
+        _timer.start();
+    }
+}
+
+//---------------------------------------------------------
+//   phaseName
+//---------------------------------------------------------
+
+const char* LayoutProfiler::phaseName(LayoutPhase phase)
+{
+    switch (phase) {
+    case LayoutPhase::DO_LAYOUT_RANGE:        return "doLayoutRange";
+    case LayoutPhase::GET_NEXT_MEASURE:       return "getNextMeasure";
+    case LayoutPhase::CREATE_BEAMS:           return "createBeams";
+    case LayoutPhase::LAYOUT_CHORDS1:         return "layoutChords1";
+    case LayoutPhase::LAYOUT_CHORDS3:         return "layoutChords3";
+    case LayoutPhase::COLLECT_SYSTEM:         return "collectSystem";
+    case LayoutPhase::LAYOUT_SYSTEM_ELEMENTS: return "layoutSystemElements";
+    case LayoutPhase::LAYOUT_LYRICS:          return "layoutLyrics";
+    case LayoutPhase::COLLECT_PAGE:           return "collectPage";
+    case LayoutPhase::REBUILD_BSP_TREE:       return "rebuildBspTree";
+    case LayoutPhase::PHASES:                 break;
+    }
+    return "";
+}
+
+//---------------------------------------------------------
+//   startLayout
+//    the per system breakdown only describes the most
+//    recent layout
+//---------------------------------------------------------
+
+void LayoutProfiler::startLayout()
+{
+    _systems.clear();
+    _lastSystemElements = 0;
+}
+
+//---------------------------------------------------------
+//   add
+//---------------------------------------------------------
+
+void LayoutProfiler::add(LayoutPhase phase, qint64 ns)
+{
+    Counter& c = _counters[int(phase)];
+    ++c.count;
+    c.total += ns;
+    c.max    = qMax(c.max, ns);
+    if (phase == LayoutPhase::LAYOUT_SYSTEM_ELEMENTS) {
+        _lastSystemElements = ns;
+    }
+}
+
+//---------------------------------------------------------
+//   addSystem
+//    ns is the collectSystem time of system
+//---------------------------------------------------------
+
+void LayoutProfiler::addSystem(const System* system, qint64 ns)
+{
+    SystemTimes st;
+    st.tick                 = system->measures().empty() ? 0 : system->measures().front()->tick().ticks();
+    st.measures             = int(system->measures().size());
+    st.collectSystem        = ns;
+    st.layoutSystemElements = _lastSystemElements;
+    _systems.push_back(st);
+    _lastSystemElements = 0;
+}
+
+//---------------------------------------------------------
+//   reset
+//---------------------------------------------------------
+
+void LayoutProfiler::reset()
+{
+    for (Counter& c : _counters) {
+        c = Counter();
+    }
+    startLayout();
+}
+
+//---------------------------------------------------------
+//   toJson
+//    times are in milliseconds
+//---------------------------------------------------------
+
+QJsonObject LayoutProfiler::toJson() const
+{
+    auto ms = [](qint64 ns) { return double(ns) / 1e6; };
+
+    QJsonObject phases;
+    for (int i = 0; i < int(LayoutPhase::PHASES); ++i) {
+        const Counter& c = _counters[i];
+        QJsonObject o;
+        o["count"]   = c.count;
+        o["totalMs"] = ms(c.total);
+        o["maxMs"]   = ms(c.max);
+        phases[phaseName(LayoutPhase(i))] = o;
+    }
+
+    QJsonArray systems;
+    for (const SystemTimes& st : _systems) {
+        QJsonObject o;
+        o["tick"]                   = st.tick;
+        o["measures"]               = st.measures;
+        o["collectSystemMs"]        = ms(st.collectSystem);
+        o["layoutSystemElementsMs"] = ms(st.layoutSystemElements);
+        systems.append(o);
+    }
+
+    QJsonObject report;
+    report["phases"]  = phases;
+    report["systems"] = systems;
+    return report;
+}
+}
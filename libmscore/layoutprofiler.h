@@ -0,0 +1,103 @@
+//=============================================================================
+//  MuseScore
+//  Music Composition & Notation
+//
+//  Copyright (C) 2020 Werner Schweer
+//
+//  This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License version 2
+//  as published by the Free Software Foundation and appearing in
+//  the file LICENCE.GPL
+//=============================================================================
+
+#ifndef __LAYOUTPROFILER_H__
+#define __LAYOUTPROFILER_H__
+
+#include "mscore.h"
+
+namespace Ms {
+class Score;
+class System;
+
+//---------------------------------------------------------
+//   LayoutPhase
+//---------------------------------------------------------
+
+enum class LayoutPhase : char {
+    DO_LAYOUT_RANGE,
+    GET_NEXT_MEASURE,
+    CREATE_BEAMS,
+    LAYOUT_CHORDS1,
+    LAYOUT_CHORDS3,
+    COLLECT_SYSTEM,
+    LAYOUT_SYSTEM_ELEMENTS,
+    LAYOUT_LYRICS,
+    COLLECT_PAGE,
+    REBUILD_BSP_TREE,
+    PHASES
+};
+
+//---------------------------------------------------------
+//   LayoutProfiler
+//    per score layout timing, enabled by
+//    MScore::layoutProfiling. Phase times are inclusive:
+//    getNextMeasure contains createBeams and layoutChords1,
+//    collectSystem contains layoutSystemElements etc.
+//---------------------------------------------------------
+
+class LayoutProfiler
+{
+    struct Counter {
+        int count { 0 };
+        qint64 total { 0 };           // nanoseconds
+        qint64 max { 0 };
+    };
+    struct SystemTimes {
+        int tick;
+        int measures;
+        qint64 collectSystem;
+        qint64 layoutSystemElements;
+    };
+
+    Counter _counters[int(LayoutPhase::PHASES)];
+    std::vector<SystemTimes> _systems;       // systems collected by the last layout
+    qint64 _lastSystemElements { 0 };
+
+public:
+    static const char* phaseName(LayoutPhase);
+
+    void startLayout();
+    void add(LayoutPhase, qint64 ns);
+    void addSystem(const System*, qint64 ns);
+    void reset();
+    QJsonObject toJson() const;
+};
+
+//---------------------------------------------------------
+//   LayoutTimer
+//    adds the lifetime of the object to a layout phase;
+//    costs a single flag test if profiling is disabled
+//---------------------------------------------------------
+
+class LayoutTimer
+{
+    LayoutProfiler* _profiler;
+    LayoutPhase _phase;
+    QElapsedTimer _timer;
+
+public:
+    LayoutTimer(Score* score, LayoutPhase phase);
+    LayoutTimer(const LayoutTimer&) = delete;
+    LayoutTimer& operator=(const LayoutTimer&) = delete;
+    ~LayoutTimer()
+    {
+        if (_profiler) {
+            _profiler->add(_phase, _timer.nsecsElapsed());
+        }
+    }
+
+    LayoutProfiler* profiler() const { return _profiler; }
+    qint64 elapsed() const { return _timer.nsecsElapsed(); }
+};
+}     // namespace Ms
+#endif
@@ -138,6 +138,9 @@ int MasterScore::getNextFreeDrumMidiMapping()
 void MasterScore::rebuildExcerptsMidiMapping()
 {
     for (Excerpt* ex : excerpts()) {
+        if (!ex->partScore()) {
+            continue;               // deferred, mapped by readDeferredExcerpts()
+        }
         for (Part* p : ex->partScore()->parts()) {
             const Part* masterPart = p->masterPart();
             if (!masterPart->score()->isMaster()) {
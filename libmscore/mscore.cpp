@@ -108,7 +108,10 @@ int MScore::sampleRate  = 44100;
 int MScore::mtcType;
 
 bool MScore::noExcerpts = false;
+bool MScore::deferExcerpts = true;
 bool MScore::noImages = false;
+bool MScore::parallelLayout = false;
+bool MScore::layoutProfiling = qEnvironmentVariableIsSet("MSCORE_LAYOUT_PROFILE");
 bool MScore::pdfPrinting = false;
 bool MScore::svgPrinting = false;
 
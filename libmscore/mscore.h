@@ -370,8 +370,12 @@ public:
     static bool noGui;
 
     static bool noExcerpts;
+    static bool deferExcerpts;      // keep part scores as XML until MasterScore::readDeferredExcerpts()
     static bool noImages;
 
+    static bool parallelLayout;
+    static bool layoutProfiling;
+
     static bool pdfPrinting;
     static bool svgPrinting;
     static double pixelRatio;
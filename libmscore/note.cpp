@@ -769,7 +769,7 @@ void Note::setPitch(int val)
     Q_ASSERT(pitchIsValid(val));
     if (_pitch != val) {
         _pitch = val;
-        score()->setPlaylistDirty();
+        score()->setPlaylistDirty(this);
     }
 }
 
@@ -2949,7 +2949,7 @@ bool Note::setProperty(Pid propertyId, const QVariant& v)
     switch (propertyId) {
     case Pid::PITCH:
         setPitch(v.toInt());
-        score()->setPlaylistDirty();
+        score()->setPlaylistDirty(this);
         break;
     case Pid::TPC1:
         _tpc[0] = v.toInt();
@@ -2978,11 +2978,11 @@ bool Note::setProperty(Pid propertyId, const QVariant& v)
         break;
     case Pid::VELO_OFFSET:
         setVeloOffset(v.toInt());
-        score()->setPlaylistDirty();
+        score()->setPlaylistDirty(this);
         break;
     case Pid::TUNING:
         setTuning(v.toDouble());
-        score()->setPlaylistDirty();
+        score()->setPlaylistDirty(this);
         break;
     case Pid::FRET:
         setFret(v.toInt());
@@ -2998,7 +2998,7 @@ bool Note::setProperty(Pid propertyId, const QVariant& v)
         break;
     case Pid::VELO_TYPE:
         setVeloType(ValueType(v.toInt()));
-        score()->setPlaylistDirty();
+        score()->setPlaylistDirty(this);
         break;
     case Pid::VISIBLE: {
         setVisible(v.toBool());
@@ -3009,7 +3009,7 @@ bool Note::setProperty(Pid propertyId, const QVariant& v)
     }
     case Pid::PLAY:
         setPlay(v.toBool());
-        score()->setPlaylistDirty();
+        score()->setPlaylistDirty(this);
         break;
     case Pid::FIXED:
         setFixed(v.toBool());
@@ -28,6 +28,7 @@
 #include "staff.h"
 #include "system.h"
 #include "mscore.h"
+#include "layoutprofiler.h"
 #include "segment.h"
 
 namespace Ms {
@@ -248,6 +249,7 @@ static void countElements(void* data, Element* /*e*/)
 
 void Page::doRebuildBspTree()
 {
+    LayoutTimer timer(score(), LayoutPhase::REBUILD_BSP_TREE);
     int n = 0;
     scanElements(&n, countElements, false);
 
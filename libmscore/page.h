@@ -76,6 +76,18 @@ public:
 
     QList<Element*> items(const QRectF& r);
     QList<Element*> items(const QPointF& p);
+#ifdef USE_BSP
+    template<typename F> void visitItems(const QRectF& r, F func)
+    {
+        if (!bspTreeValid) {
+            doRebuildBspTree();
+        }
+        bspTree.visit(r, func);
+    }
+
+#else
+    template<typename F> void visitItems(const QRectF&, F) {}
+#endif
     void rebuildBspTree() { bspTreeValid = false; }
     QPointF pagePos() const override { return QPointF(); }       ///< position in page coordinates
     QList<Element*> elements();                 ///< list of visible elements
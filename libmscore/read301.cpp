@@ -153,6 +153,8 @@ bool Score::read(XmlReader& e)
         } else if (tag == "Score") {            // recursion
             if (MScore::noExcerpts) {
                 e.skipCurrentElement();
+            } else if (isMaster() && MScore::deferExcerpts) {
+                masterScore()->deferExcerpt(e);
             } else {
                 e.tracks().clear();             // ???
                 MasterScore* m = masterScore();
@@ -288,6 +290,81 @@ bool MasterScore::read(XmlReader& e)
     return true;
 }
 
+//---------------------------------------------------------
+//   deferExcerpt
+//    keep the part score at e as XML until
+//    readDeferredExcerpts() is called
+//---------------------------------------------------------
+
+void MasterScore::deferExcerpt(XmlReader& e)
+{
+    if (!_excerptLinks) {
+        _excerptLinks.reset(new ExcerptLinks(e.excerptLinks()));
+    }
+    Excerpt* ex = new Excerpt(this);
+    ex->readDeferred(e);
+    _excerpts.append(ex);
+}
+
+//---------------------------------------------------------
+//   readDeferredExcerpts
+//    Read all part scores kept as XML by deferExcerpt().
+//    They are read in file order by one reader which
+//    starts with the link state the master score reader
+//    had at the first part, so they are linked exactly as
+//    if they had been read together with the master score.
+//    Must be called before the master score is edited.
+//---------------------------------------------------------
+
+void MasterScore::readDeferredExcerpts()
+{
+    if (!_excerptLinks) {
+        return;
+    }
+    QList<Excerpt*> deferred;
+    QByteArray data("<Excerpts>");
+    for (Excerpt* ex : _excerpts) {
+        if (ex->partScoreDeferred()) {
+            deferred.append(ex);
+            data += ex->takePartXml();
+        }
+    }
+    data += "</Excerpts>";
+
+    XmlReader e(data);
+    e.setDocName(fileInfo()->completeBaseName());
+    e.setExcerptLinks(*_excerptLinks);
+    _excerptLinks.reset();
+
+    e.readNextStartElement();
+    for (Excerpt* ex : deferred) {
+        if (!e.readNextStartElement()) {
+            break;
+        }
+        e.tracks().clear();
+        Score* s = new Score(this, MScore::baseStyle());
+        ex->setPartScore(s);
+        e.setLastMeasure(nullptr);
+        if (!s->read(e)) {
+            qWarning("readDeferredExcerpts: cannot read part <%s>", qPrintable(ex->title()));
+        }
+        ex->setTracks(e.tracks());
+        initExcerpt(ex);
+    }
+    rebuildExcerptsMidiMapping();
+
+    for (Excerpt* ex : deferred) {
+        Score* s = ex->partScore();
+        if (!s) {
+            continue;
+        }
+        s->setPlaylistDirty();
+        s->addLayoutFlags(LayoutFlag::FIX_PITCH_VELO);
+        s->setLayoutAll();
+        s->doLayout();
+    }
+}
+
 //---------------------------------------------------------
 //   addMovement
 //---------------------------------------------------------
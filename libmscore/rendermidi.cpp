@@ -2369,26 +2369,30 @@ void MidiRenderer::renderChunk(const Chunk& chunk, EventMap* events, const Conte
 
     // NOTE:JT this is a temporary fix for duplicate events until polyphonic aftertouch support
     // can be implemented. This removes duplicate SND events.
+    // The events are compacted in place, erasing them one by one
+    // would move the rest of the event array each time.
     int lastChannel = -1;
     int lastController = -1;
     int lastValue = -1;
-    for (auto i = events->begin(); i != events->end();) {
+    auto out = events->begin();
+    for (auto i = events->begin(); i != events->end(); ++i) {
         if (i->second.type() == ME_CONTROLLER) {
-            auto& event = i->second;
+            const auto& event = i->second;
             if (event.channel() == lastChannel
                 && event.controller() == lastController
                 && event.value() == lastValue) {
-                i = events->erase(i);
-            } else {
-                lastChannel = event.channel();
-                lastController = event.controller();
-                lastValue = event.value();
-                i++;
+                continue;
             }
-        } else {
-            i++;
+            lastChannel = event.channel();
+            lastController = event.controller();
+            lastValue = event.value();
+        }
+        if (out != i) {
+            *out = std::move(*i);
         }
+        ++out;
     }
+    events->erase(out, events->end());
 }
 
 //---------------------------------------------------------
@@ -163,6 +163,14 @@ RepeatList::RepeatList(Score* s)
 
 RepeatList::~RepeatList()
 {
+    // no conversion can be running any more
+    delete _timeIndex.exchange(nullptr);
+    TimeIndex* index = _retired.exchange(nullptr);
+    while (index) {
+        TimeIndex* next = index->_nextRetired;
+        delete index;
+        index = next;
+    }
     qDeleteAll(*this);
 }
 
@@ -200,9 +208,26 @@ void RepeatList::update(bool expand)
 
 //---------------------------------------------------------
 //   updateTempo
+//    recompute the segment times and publish a new time
+//    index; not to be called from the sequencer thread
 //---------------------------------------------------------
 
 void RepeatList::updateTempo()
+{
+    updateSegmentTimes();
+    publishTimeIndex(new TimeIndex(this, _score->tempomap()));
+    collectTimeIndices();
+}
+
+//---------------------------------------------------------
+//   updateSegmentTimes
+//    recompute the segment times only, for an index the
+//    sequencer published for a new relative tempo; they
+//    are only read by the linear conversions, which the
+//    sequencer does not use while that index is current
+//---------------------------------------------------------
+
+void RepeatList::updateSegmentTimes()
 {
     const TempoMap* tl = _score->tempomap();
 
@@ -219,6 +244,235 @@ void RepeatList::updateTempo()
     }
 }
 
+//---------------------------------------------------------
+//   publishTimeIndex
+//    make index the current one and retire the previous
+//    one; this neither allocates nor locks and is safe
+//    in the sequencer thread
+//---------------------------------------------------------
+
+void RepeatList::publishTimeIndex(TimeIndex* index)
+{
+    TimeIndex* old = _timeIndex.exchange(index);
+    if (old) {
+        retire(old, old);
+    }
+}
+
+//---------------------------------------------------------
+//   retire
+//    push the list first ... last of indices which are not
+//    published any more
+//---------------------------------------------------------
+
+void RepeatList::retire(TimeIndex* first, TimeIndex* last)
+{
+    TimeIndex* head = _retired.load();
+    do {
+        last->_nextRetired = head;
+    } while (!_retired.compare_exchange_weak(head, first));
+}
+
+//---------------------------------------------------------
+//   collectTimeIndices
+//    delete the retired indices if no conversion is
+//    running; a conversion starting later only sees the
+//    published index. Otherwise they are kept for the
+//    next call. Not to be called from the sequencer thread.
+//---------------------------------------------------------
+
+void RepeatList::collectTimeIndices()
+{
+    TimeIndex* first = _retired.exchange(nullptr);
+    if (!first) {
+        return;
+    }
+    if (_readers.load()) {
+        TimeIndex* last = first;
+        while (last->_nextRetired) {
+            last = last->_nextRetired;
+        }
+        retire(first, last);
+        return;
+    }
+    while (first) {
+        TimeIndex* next = first->_nextRetired;
+        delete first;
+        first = next;
+    }
+}
+
+//---------------------------------------------------------
+//   IndexReader
+//    the published time index, if it is up to date with
+//    the tempo map; while a reader exists, retired
+//    indices are not deleted
+//---------------------------------------------------------
+
+class RepeatList::IndexReader
+{
+    const RepeatList* _rl;
+
+public:
+    const TimeIndex* index;
+
+    IndexReader(const RepeatList* rl)
+        : _rl(rl)
+    {
+        ++_rl->_readers;
+        index = rl->_timeIndex.load();
+        if (index && index->tempoSN() != rl->_score->tempomap()->tempoSN()) {
+            index = nullptr;
+        }
+    }
+
+    ~IndexReader() { --_rl->_readers; }
+};
+
+//---------------------------------------------------------
+//   TimeIndex
+//    Flatten the segment list and the tempo map into
+//    sorted arrays, so that utick <-> utime conversions
+//    are binary searches instead of list and map walks.
+//    The segment times are computed the same way as in
+//    RepeatList::updateTempo(), from tl instead of the
+//    score tempo map.
+//---------------------------------------------------------
+
+TimeIndex::TimeIndex(const RepeatList* rl, const TempoMap* tl)
+{
+    _nextRetired = nullptr;
+    _score    = rl->score();
+    _tempoSN  = tl->tempoSN();
+    _relTempo = tl->relTempo();
+
+    _segmentUtick.reserve(rl->size());
+    _segmentTickOffset.reserve(rl->size());
+    _segmentUtime.reserve(rl->size());
+    _segmentTimeOffset.reserve(rl->size());
+    int utick = 0;
+    qreal t   = 0;
+    for (const RepeatSegment* s : *rl) {
+        qreal ct = tl->tick2time(s->tick);
+        _segmentUtick.push_back(utick);
+        _segmentTickOffset.push_back(utick - s->tick);
+        _segmentUtime.push_back(t);
+        _segmentTimeOffset.push_back(t - ct);
+        utick += s->len();
+        t     += tl->tick2time(s->tick + s->len()) - ct;
+    }
+
+    _tempoPoints.reserve(tl->size());
+    _tempoTicks.reserve(tl->size());
+    _tempoTimes.reserve(tl->size());
+    for (const auto& e : *tl) {
+        TempoPoint p;
+        p.tick    = e.first;
+        p.time    = e.second.time;
+        p.pause   = e.second.pause;
+        p.tempo   = e.second.tempo;
+        p.divisor = MScore::division * p.tempo * _relTempo;
+        _tempoPoints.push_back(p);
+        _tempoTicks.push_back(p.tick);
+        _tempoTimes.push_back(p.time);
+    }
+}
+
+//---------------------------------------------------------
+//   seek
+//    return the index of the last element <= key, or -1;
+//    hint is a previous result and makes ascending
+//    lookups O(1)
+//---------------------------------------------------------
+
+int TimeIndex::seek(const std::vector<int>& v, int hint, int key)
+{
+    auto first = v.begin();
+    if (hint >= 0 && v[hint] <= key) {
+        if (hint + 1 == int(v.size()) || v[hint + 1] > key) {
+            return hint;
+        }
+        first += hint + 1;
+    }
+    return int(std::upper_bound(first, v.end(), key) - v.begin()) - 1;
+}
+
+//---------------------------------------------------------
+//   tick2time
+//    same as TempoMap::tick2time(); point is the index of
+//    the last tempo point at or before tick, or -1
+//---------------------------------------------------------
+
+qreal TimeIndex::tick2time(int tick, int point) const
+{
+    if (point < 0) {
+        return qreal(tick) / (MScore::division * 2.0 * _relTempo);
+    }
+    const TempoPoint& p = _tempoPoints[point];
+    return p.time + qreal(tick - p.tick) / p.divisor;
+}
+
+//---------------------------------------------------------
+//   time2tick
+//    same as TempoMap::time2tick(); tempo point times are
+//    non-decreasing, so the first point at or after time
+//    is the one whose pause may contain it
+//---------------------------------------------------------
+
+int TimeIndex::time2tick(qreal time) const
+{
+    int tick    = 0;
+    qreal delta = 0.0;
+    qreal tempo = 2.0;
+
+    size_t i = std::lower_bound(_tempoTimes.begin(), _tempoTimes.end(), time) - _tempoTimes.begin();
+    if (i > 0) {
+        const TempoPoint& p = _tempoPoints[i - 1];
+        delta = p.time;
+        tick  = p.tick;
+        tempo = p.tempo;
+    }
+    if (i < _tempoPoints.size()) {
+        const TempoPoint& e = _tempoPoints[i];
+        // if in a pause period, wait on previous tick
+        if ((time <= e.time) && (time > e.time - e.pause)) {
+            delta = (time - (e.time - e.pause) + delta);
+        }
+    }
+    delta = time - delta;
+    tick += lrint(delta * _relTempo * MScore::division * tempo);
+    return tick;
+}
+
+//---------------------------------------------------------
+//   utick2utime
+//---------------------------------------------------------
+
+qreal TimeIndex::utick2utime(int tick) const
+{
+    int i = seek(_segmentUtick, -1, tick);
+    if (i < 0) {
+        return 0.0;
+    }
+    int t = tick - _segmentTickOffset[i];
+    return tick2time(t, seek(_tempoTicks, -1, t)) + _segmentTimeOffset[i];
+}
+
+//---------------------------------------------------------
+//   utime2utick
+//    return false if time is before the first segment
+//---------------------------------------------------------
+
+bool TimeIndex::utime2utick(qreal time, int* tick) const
+{
+    int i = int(std::upper_bound(_segmentUtime.begin(), _segmentUtime.end(), time) - _segmentUtime.begin()) - 1;
+    if (i < 0 || time < _segmentUtime[i]) {
+        return false;
+    }
+    *tick = time2tick(time - _segmentTimeOffset[i]) + _segmentTickOffset[i];
+    return true;
+}
+
 //---------------------------------------------------------
 //   utick2tick
 //---------------------------------------------------------
@@ -267,6 +521,21 @@ int RepeatList::tick2utick(int tick) const
 //---------------------------------------------------------
 
 qreal RepeatList::utick2utime(int tick) const
+{
+    IndexReader reader(this);
+    if (reader.index) {
+        return reader.index->utick2utime(tick);
+    }
+    return linearUtick2utime(tick);
+}
+
+//---------------------------------------------------------
+//   linearUtick2utime
+//    walk the segment list and the tempo map; the
+//    reference for utick2utime()
+//---------------------------------------------------------
+
+qreal RepeatList::linearUtick2utime(int tick) const
 {
     unsigned n = size();
     unsigned ii = (idx1 < n) && (tick >= at(idx1)->utick) ? idx1 : 0;
@@ -280,11 +549,72 @@ qreal RepeatList::utick2utime(int tick) const
     return 0.0;
 }
 
+//---------------------------------------------------------
+//   utick2utime
+//    batched conversion; ascending input (like the
+//    events of an EventMap) is converted in linear time
+//---------------------------------------------------------
+
+std::vector<qreal> RepeatList::utick2utime(const std::vector<int>& uticks) const
+{
+    std::vector<qreal> utimes;
+    utimes.reserve(uticks.size());
+    IndexReader reader(this);
+    const TimeIndex* index = reader.index;
+    if (!index) {
+        for (int tick : uticks) {
+            utimes.push_back(linearUtick2utime(tick));
+        }
+        return utimes;
+    }
+    int segment = -1;
+    int point   = -1;
+    for (int tick : uticks) {
+        int i = TimeIndex::seek(index->_segmentUtick, segment, tick);
+        if (i < 0) {
+            utimes.push_back(0.0);
+            continue;
+        }
+        if (i != segment) {
+            segment = i;
+            point   = -1;
+        }
+        int t = tick - index->_segmentTickOffset[i];
+        point = TimeIndex::seek(index->_tempoTicks, point, t);
+        utimes.push_back(index->tick2time(t, point) + index->_segmentTimeOffset[i]);
+    }
+    return utimes;
+}
+
 //---------------------------------------------------------
 //   utime2utick
 //---------------------------------------------------------
 
 int RepeatList::utime2utick(qreal t) const
+{
+    {
+        IndexReader reader(this);
+        if (reader.index) {
+            int tick;
+            if (reader.index->utime2utick(t, &tick)) {
+                return tick;
+            }
+            if (MScore::debugMode) {
+                qFatal("time %f not found in RepeatList", t);
+            }
+            return 0;
+        }
+    }
+    return linearUtime2utick(t);
+}
+
+//---------------------------------------------------------
+//   linearUtime2utick
+//    walk the segment list and the tempo map; the
+//    reference for utime2utick()
+//---------------------------------------------------------
+
+int RepeatList::linearUtime2utick(qreal t) const
 {
     unsigned n = size();
     unsigned ii = (idx2 < n) && (t >= at(idx2)->utime) ? idx2 : 0;
@@ -330,6 +660,7 @@ void RepeatList::flatten()
 {
     qDeleteAll(*this);
     clear();
+    publishTimeIndex(nullptr);
 
     Measure* m = _score->firstMeasure();
     if (!m) {
@@ -347,6 +678,7 @@ void RepeatList::flatten()
     }while (m);
     push_back(s);
 
+    updateTempo();
     _expanded = false;
 }
 
@@ -364,6 +696,7 @@ void RepeatList::unwind()
 {
     qDeleteAll(*this);
     clear();
+    publishTimeIndex(nullptr);
     _voltaRanges.clear();
     _jumpsTaken.clear();
     Measure* fm = _score->firstMeasure();
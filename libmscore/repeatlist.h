@@ -13,8 +13,12 @@
 #ifndef __REPEATLIST_H__
 #define __REPEATLIST_H__
 
+#include <atomic>
+
 namespace Ms {
 class Score;
+class TempoMap;
+class RepeatList;
 class Measure;
 class Volta;
 class Jump;
@@ -46,15 +50,79 @@ public:
     friend class RepeatList;
 };
 
+//---------------------------------------------------------
+//   TimeIndex
+//    Immutable utick <-> utime conversion tables, built
+//    from the repeat segments and a TempoMap. A RepeatList
+//    publishes its index through an atomic pointer, so that
+//    the sequencer can read it while the gui thread builds
+//    the next one; a replaced index is retired and deleted
+//    once no reader uses it any more. Results are bit
+//    identical to the TempoMap::tick2time() and
+//    TempoMap::time2tick() based conversions.
+//---------------------------------------------------------
+
+class TimeIndex
+{
+    //---------------------------------------------------------
+    //   TempoPoint
+    //    flattened copy of a TempoMap entry
+    //---------------------------------------------------------
+
+    struct TempoPoint {
+        int tick;
+        qreal time;
+        qreal pause;
+        qreal tempo;
+        qreal divisor;            // MScore::division * tempo * relTempo, as computed by TempoMap
+    };
+
+    const Score* _score;
+    int _tempoSN;                 // TempoMap serial number the index was built from
+    qreal _relTempo;
+    std::vector<int> _segmentUtick;
+    std::vector<int> _segmentTickOffset;   // utick - tick
+    std::vector<qreal> _segmentUtime;
+    std::vector<qreal> _segmentTimeOffset;
+    std::vector<TempoPoint> _tempoPoints;
+    std::vector<int> _tempoTicks;     // _tempoPoints[i].tick, for binary search
+    std::vector<qreal> _tempoTimes;   // _tempoPoints[i].time, for binary search
+
+    TimeIndex* _nextRetired;          // RepeatList retired list
+
+    static int seek(const std::vector<int>& v, int hint, int key);
+    qreal tick2time(int tick, int point) const;
+    int time2tick(qreal time) const;
+
+    friend class RepeatList;
+
+public:
+    TimeIndex(const RepeatList* rl, const TempoMap* tl);
+    TimeIndex(const TimeIndex&) = delete;
+    TimeIndex& operator=(const TimeIndex&) = delete;
+
+    const Score* score() const { return _score; }
+    int tempoSN() const { return _tempoSN; }
+    qreal relTempo() const { return _relTempo; }
+    qreal utick2utime(int tick) const;
+    bool utime2utick(qreal time, int* tick) const;
+};
+
 //---------------------------------------------------------
 //   RepeatList
 //---------------------------------------------------------
 
 class RepeatList : public QList<RepeatSegment*>
 {
+    class IndexReader;
+
     Score* _score;
     mutable unsigned idx1, idx2;     // cached values
 
+    std::atomic<TimeIndex*> _timeIndex { nullptr };   // rebuilt by updateTempo()
+    std::atomic<TimeIndex*> _retired { nullptr };     // replaced indices, deleted by collectTimeIndices()
+    mutable std::atomic<int> _readers { 0 };          // conversions using _timeIndex
+
     bool _expanded = false;
     bool _scoreChanged = true;
 
@@ -70,6 +138,7 @@ class RepeatList : public QList<RepeatSegment*>
 
     void unwind();
     void flatten();
+    void retire(TimeIndex* first, TimeIndex* last);
 
 public:
     RepeatList(Score* s);
@@ -84,7 +153,13 @@ public:
     void dump() const;
     int utime2utick(qreal) const;
     qreal utick2utime(int) const;
+    std::vector<qreal> utick2utime(const std::vector<int>& uticks) const;
+    int linearUtime2utick(qreal) const;
+    qreal linearUtick2utime(int) const;
     void updateTempo();
+    void updateSegmentTimes();
+    void publishTimeIndex(TimeIndex*);
+    void collectTimeIndices();
     int ticks() const;
 };
 }     // namespace Ms
@@ -59,7 +59,9 @@
 #include "revisions.h"
 #include "tie.h"
 #include "tiemap.h"
+#include "tremolo.h"
 #include "layoutbreak.h"
+#include "layoutprofiler.h"
 #include "harmony.h"
 #include "mscore.h"
 #ifdef OMR
@@ -379,6 +381,7 @@ Score::~Score()
     qDeleteAll(_parts);
     qDeleteAll(_staves);
 //      qDeleteAll(_pages);         // TODO: check
+    delete _layoutProfiler;
     _masterScore = 0;
 
     imageStore.clearUnused();
@@ -406,6 +409,7 @@ Score* Score::clone()
     XmlReader r(buffer.buffer());
     MasterScore* score = new MasterScore(style());
     score->read1(r, true);
+    score->readDeferredExcerpts();
 
     score->addLayoutFlags(LayoutFlag::FIX_PITCH_VELO);
     score->doLayout();
@@ -799,9 +803,143 @@ void Score::setPlaylistDirty()
 void MasterScore::setPlaylistDirty()
 {
     _playlistDirty = true;
+    _playlistTick1 = Fraction(-1, 1);
+    _playlistTick2 = Fraction(-1, 1);
     _repeatList->setScoreChanged();
 }
 
+//---------------------------------------------------------
+//   setPlaylistDirty
+//    only the events between tick1 and tick2 changed
+//---------------------------------------------------------
+
+void Score::setPlaylistDirty(const Fraction& tick1, const Fraction& tick2)
+{
+    masterScore()->setPlaylistDirty(tick1, tick2);
+}
+
+void MasterScore::setPlaylistDirty(const Fraction& tick1, const Fraction& tick2)
+{
+    if (!_playlistDirty) {
+        _playlistDirty = true;
+        _playlistTick1 = tick1;
+        _playlistTick2 = tick2;
+    } else if (_playlistTick1 >= Fraction(0, 1)) {
+        _playlistTick1 = qMin(_playlistTick1, tick1);
+        _playlistTick2 = qMax(_playlistTick2, tick2);
+    }
+}
+
+//---------------------------------------------------------
+//   playbackRange
+//    the ticks whose playback depends on se; returns false
+//    if se may change the playback of the whole score
+//---------------------------------------------------------
+
+static bool playbackRange(const ScoreElement* se, Fraction& tick1, Fraction& tick2)
+{
+    if (!se || !se->isElement()) {
+        return false;
+    }
+    const Element* e = static_cast<const Element*>(se);
+    if (e->isTie()) {
+        // a removed tie is no longer linked from its notes: take
+        // the range of both of them
+        const Tie* tie = toTie(e);
+        if (!playbackRange(tie->startNote(), tick1, tick2)) {
+            return false;
+        }
+        Fraction t1;
+        Fraction t2;
+        if (tie->endNote() && playbackRange(tie->endNote(), t1, t2)) {
+            tick1 = qMin(tick1, t1);
+            tick2 = qMax(tick2, t2);
+        }
+        return true;
+    }
+    while (e && !e->isChordRest()) {
+        e = e->parent();
+    }
+    if (!e) {
+        return false;
+    }
+    const ChordRest* cr = toChordRest(e);
+    if (cr->isChord() && toChord(cr)->isGrace()) {
+        cr = toChordRest(cr->parent());
+    }
+    if (!cr->segment() || !cr->measure()) {
+        return false;
+    }
+    // the chords are rendered with the play events of their
+    // neighbours, start at the measure
+    tick1 = cr->measure()->tick();
+    tick2 = cr->tick() + cr->actualTicks();
+    if (!cr->isChord()) {
+        return true;
+    }
+    const Chord* c = toChord(cr);
+    if (c->tremolo() && c->tremolo()->chord2()) {
+        const Chord* c2 = c->tremolo()->chord2();
+        tick2 = qMax(tick2, c2->tick() + c2->actualTicks());
+    }
+    // tied notes are played by the first note of the tie
+    for (const Note* n : c->notes()) {
+        for (const Note* t = n; t->tieBack() && t->tieBack()->startNote(); t = t->tieBack()->startNote()) {
+            const Chord* tc = t->tieBack()->startNote()->chord();
+            tick1 = qMin(tick1, tc->measure() ? tc->measure()->tick() : tc->tick());
+        }
+        for (const Note* t = n; t->tieFor() && t->tieFor()->endNote(); t = t->tieFor()->endNote()) {
+            const Chord* tc = t->tieFor()->endNote()->chord();
+            tick2 = qMax(tick2, tc->tick() + tc->actualTicks());
+        }
+    }
+    return true;
+}
+
+//---------------------------------------------------------
+//   setPlaylistDirty
+//    the playback of element se changed
+//---------------------------------------------------------
+
+void Score::setPlaylistDirty(const ScoreElement* se)
+{
+    Fraction tick1;
+    Fraction tick2;
+    if (playbackRange(se, tick1, tick2)) {
+        setPlaylistDirty(tick1, tick2);
+    } else {
+        setPlaylistDirty();
+    }
+}
+
+//---------------------------------------------------------
+//   setPlaylistDirty
+//    cmd (an UndoMacro) was done or undone; if all its
+//    commands change single chords only the playlist
+//    around them has to be rendered again
+//---------------------------------------------------------
+
+void Score::setPlaylistDirty(const UndoCommand* cmd)
+{
+    Fraction tick1;
+    Fraction tick2;
+    bool first = true;
+    for (const UndoCommand* c : cmd->commands()) {
+        Fraction t1;
+        Fraction t2;
+        if (!playbackRange(c->changedElement(), t1, t2)) {
+            setPlaylistDirty();
+            return;
+        }
+        tick1 = first ? t1 : qMin(tick1, t1);
+        tick2 = first ? t2 : qMax(tick2, t2);
+        first = false;
+    }
+    if (!first) {
+        setPlaylistDirty(tick1, tick2);
+    }
+}
+
 //---------------------------------------------------------
 //   spell
 //---------------------------------------------------------
@@ -1484,7 +1622,7 @@ void Score::addElement(Element* element)
     break;
 
     case ElementType::CHORD:
-        setPlaylistDirty();
+        setPlaylistDirty(element);
         // create playlist does not work here bc. tremolos may not be complete
         // createPlayEvents(toChord(element));
         break;
@@ -1854,6 +1992,18 @@ Segment* Score::lastSegmentMM() const
     return m ? m->last() : 0;
 }
 
+//---------------------------------------------------------
+//   layoutProfiler
+//---------------------------------------------------------
+
+LayoutProfiler* Score::layoutProfiler()
+{
+    if (!_layoutProfiler) {
+        _layoutProfiler = new LayoutProfiler;
+    }
+    return _layoutProfiler;
+}
+
 //---------------------------------------------------------
 //   utick2utime
 //---------------------------------------------------------
@@ -1887,7 +2037,6 @@ void MasterScore::setExpandRepeats(bool expand)
 
 //---------------------------------------------------------
 //   updateRepeatListTempo
-///   needed for usage in Seq::processMessages
 //---------------------------------------------------------
 
 void MasterScore::updateRepeatListTempo()
@@ -1895,6 +2044,37 @@ void MasterScore::updateRepeatListTempo()
     _repeatList->updateTempo();
 }
 
+//---------------------------------------------------------
+//   publishRepeatListTimeIndex
+///   needed for usage in Seq::processMessages
+//---------------------------------------------------------
+
+void MasterScore::publishRepeatListTimeIndex(TimeIndex* index)
+{
+    _repeatList->publishTimeIndex(index);
+}
+
+//---------------------------------------------------------
+//   updateRepeatListSegmentTimes
+//    called by the gui thread after the sequencer published
+//    a time index for a new relative tempo
+//---------------------------------------------------------
+
+void MasterScore::updateRepeatListSegmentTimes()
+{
+    _repeatList->updateSegmentTimes();
+}
+
+//---------------------------------------------------------
+//   collectRepeatListTimeIndices
+//    delete the time indices the sequencer no longer uses
+//---------------------------------------------------------
+
+void MasterScore::collectRepeatListTimeIndices()
+{
+    _repeatList->collectTimeIndices();
+}
+
 //---------------------------------------------------------
 //   repeatList
 //---------------------------------------------------------
@@ -1998,6 +2178,19 @@ void Score::setMetaTag(const QString& tag, const QString& val)
 //---------------------------------------------------------
 
 void MasterScore::addExcerpt(Excerpt* ex)
+{
+    initExcerpt(ex);
+    excerpts().append(ex);
+    setExcerptsChanged(true);
+}
+
+//---------------------------------------------------------
+//   initExcerpt
+//    set parts and tracks of an excerpt from the links
+//    of its part score
+//---------------------------------------------------------
+
+void MasterScore::initExcerpt(Excerpt* ex)
 {
     Score* score = ex->partScore();
 
@@ -2044,8 +2237,6 @@ void MasterScore::addExcerpt(Excerpt* ex)
         }
         ex->setTracks(tracks);
     }
-    excerpts().append(ex);
-    setExcerptsChanged(true);
 }
 
 //---------------------------------------------------------
@@ -2082,6 +2273,7 @@ MasterScore* MasterScore::clone()
     XmlReader r(buffer.buffer());
     MasterScore* score = new MasterScore(style());
     score->read1(r, true);
+    score->readDeferredExcerpts();
 
     score->addLayoutFlags(LayoutFlag::FIX_PITCH_VELO);
     score->doLayout();
@@ -3862,7 +4054,9 @@ void Score::linkId(int val)
 //---------------------------------------------------------
 //   scoreList
 //    return a list of scores containing the root score
-//    and all part scores (if there are any)
+//    and all part scores (if there are any); deferred
+//    part scores have no Score yet and are left out, they
+//    are read before any edit (see Score::startCmd())
 //---------------------------------------------------------
 
 QList<Score*> Score::scoreList()
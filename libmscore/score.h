@@ -62,6 +62,7 @@ class Instrument;
 class KeyList;
 class KeySig;
 class KeySigEvent;
+class LayoutProfiler;
 class LinkedElements;
 class Lyrics;
 class MasterSynthesizer;
@@ -85,6 +86,7 @@ class Spanner;
 class Staff;
 class System;
 class TempoMap;
+class TimeIndex;
 class Text;
 class TimeSig;
 class TimeSigMap;
@@ -98,6 +100,7 @@ class Channel;
 struct Interval;
 struct TEvent;
 struct LayoutContext;
+struct ExcerptLinks;
 
 enum class Tid;
 enum class ClefType : signed char;
@@ -390,6 +393,27 @@ public:
     void setFooterText(Text* t, int index) { _footersText[index] = t; }
 };
 
+//---------------------------------------------------------
+//   ScoreFileEntry
+//    a file of a compressed score file; the contents are
+//    either data, an image saved as PNG or the unchanged
+//    entry of the same name in the score file archive,
+//    which must still have the checksum crc. crc is 0 for
+//    the other entries; it is set explicitly everywhere, as
+//    a member initializer would make this no aggregate in
+//    C++11.
+//---------------------------------------------------------
+
+struct ScoreFileEntry {
+    QString path;
+    QByteArray data;
+    QImage image;
+    QString archive;
+    uint crc;
+};
+
+typedef std::vector<ScoreFileEntry> ScoreFileEntries;     // in the order they are written
+
 //---------------------------------------------------------------------------------------
 //   @@ Score
 //   @P composer        string            composer of the score (read only)
@@ -454,6 +478,7 @@ private:
     int _currentLayer { 0 };
 
     ScoreFont* _scoreFont;
+    LayoutProfiler* _layoutProfiler { nullptr };   // created on demand if MScore::layoutProfiling is set
     int _pageNumberOffset { 0 };          ///< Offset for page numbers.
 
     UpdateState _updateState;
@@ -641,6 +666,9 @@ public:
     Excerpt* excerpt() { return _excerpt; }
     void setExcerpt(Excerpt* e) { _excerpt = e; }
 
+    LayoutProfiler* layoutProfiler();
+    bool hasLayoutProfiler() const { return _layoutProfiler; }
+
     System* collectSystem(LayoutContext&);
     void layoutSystemElements(System* system, LayoutContext& lc);
     void getNextMeasure(LayoutContext&);        // get next measure for layout
@@ -836,6 +864,8 @@ public:
     bool saveFile(QIODevice* f, bool msczFormat, bool onlySelection = false);
     bool saveCompressedFile(QFileInfo&, bool onlySelection, bool createThumbnail = true);
     bool saveCompressedFile(QIODevice*, const QFileInfo&, bool onlySelection, bool createThumbnail = true);
+    bool compressedFileEntries(ScoreFileEntries&, const QFileInfo&, bool onlySelection, bool createThumbnail = true);
+    static bool writeCompressedFile(QIODevice*, const ScoreFileEntries&, QString* error = nullptr);
 
     void print(QPainter* printer, int page);
     ChordRest* getSelectedChordRest() const;
@@ -898,6 +928,9 @@ public:
     bool autosaveDirty() const { return _autosaveDirty; }
     virtual bool playlistDirty() const;
     virtual void setPlaylistDirty();
+    virtual void setPlaylistDirty(const Fraction& tick1, const Fraction& tick2);
+    void setPlaylistDirty(const ScoreElement*);
+    void setPlaylistDirty(const UndoCommand*);
 
     void spell();
     void spell(int startStaff, int endStaff, Segment* startSegment, Segment* endSegment);
@@ -1320,7 +1353,10 @@ class MasterScore : public Score
     RepeatList* _repeatList;
     bool _expandRepeats     { MScore::playRepeats };
     bool _playlistDirty     { true };
+    Fraction _playlistTick1 { -1, 1 };    // changed part of the playlist,
+    Fraction _playlistTick2 { -1, 1 };    // -1 if the whole playlist changed
     QList<Excerpt*> _excerpts;
+    std::unique_ptr<ExcerptLinks> _excerptLinks;    // set while part scores are deferred
     std::vector<PartChannelSettingsLink> _playbackSettingsLinks;
     Score* _playbackScore = nullptr;
     Revisions* _revisions;
@@ -1374,12 +1410,19 @@ public:
     virtual TimeSigMap* sigmap() const override { return _sigmap; }
     virtual TempoMap* tempomap() const override { return _tempomap; }
 
+    using Score::setPlaylistDirty;
     virtual bool playlistDirty() const override { return _playlistDirty; }
     virtual void setPlaylistDirty() override;
+    virtual void setPlaylistDirty(const Fraction& tick1, const Fraction& tick2) override;
     void setPlaylistClean() { _playlistDirty = false; }
+    Fraction playlistTick1() const { return _playlistTick1; }
+    Fraction playlistTick2() const { return _playlistTick2; }
 
     void setExpandRepeats(bool expandRepeats);
     void updateRepeatListTempo();
+    void updateRepeatListSegmentTimes();
+    void publishRepeatListTimeIndex(TimeIndex*);
+    void collectRepeatListTimeIndices();
     virtual const RepeatList& repeatList() const override;
 
     virtual QList<Excerpt*>& excerpts() override { return _excerpts; }
@@ -1415,6 +1458,7 @@ public:
     void setTempomap(TempoMap* tm);
 
     bool saveFile(bool generateBackup = true);
+    void setArchive(const QString& path);
     FileError read1(XmlReader&, bool ignoreVersionError);
     FileError loadCompressedMsc(QIODevice*, bool ignoreVersionError);
     FileError loadMsc(QString name, bool ignoreVersionError);
@@ -1458,6 +1502,9 @@ public:
     void setPos(POS pos, Fraction tick);
 
     void addExcerpt(Excerpt*);
+    void initExcerpt(Excerpt*);
+    void deferExcerpt(XmlReader&);
+    void readDeferredExcerpts();
     void removeExcerpt(Excerpt*);
     void deleteExcerpt(Excerpt*);
 
@@ -85,6 +85,11 @@ static void writeMeasure(XmlWriter& xml, MeasureBase* m, int staffIdx, bool writ
 
 void Score::writeMovement(XmlWriter& xml, bool selectionOnly)
 {
+    // part scores are written from their Score
+    if (isMaster() && !selectionOnly) {
+        masterScore()->readDeferredExcerpts();
+    }
+
     // if we have multi measure rests and some parts are hidden,
     // then some layout information is missing:
     // relayout with all parts set visible
@@ -523,6 +528,9 @@ bool MasterScore::saveFile(bool generateBackup)
     QFile::setPermissions(name, QFile::ReadOwner | QFile::WriteOwner | QFile::ReadUser
                           | QFile::ReadGroup | QFile::ReadOther);
 
+    // later saves copy unchanged images and audio from the saved file
+    setArchive(suffix == "mscz" ? name : QString());
+
     undoStack()->setClean();
     setSaved(true);
     info.refresh();
@@ -539,12 +547,22 @@ bool Score::saveCompressedFile(QFileInfo& info, bool onlySelection, bool createT
     if (readOnly() && info == *masterScore()->fileInfo()) {
         return false;
     }
+    ScoreFileEntries entries;
+    if (!compressedFileEntries(entries, info, onlySelection, createThumbnail)) {
+        return false;
+    }
+    // the file may be the archive some entries are copied from,
+    // writeCompressedFile() only opens it when they are read
     QFile fp(info.filePath());
-    if (!fp.open(QIODevice::WriteOnly)) {
-        MScore::lastError = tr("Open File\n%1\nfailed: %2").arg(info.filePath(), strerror(errno));
+    QString error;
+    if (!writeCompressedFile(&fp, entries, &error)) {
+        if (error.isEmpty()) {
+            error = tr("Open File\n%1\nfailed: %2").arg(info.filePath(), fp.errorString());
+        }
+        MScore::lastError = error;
         return false;
     }
-    return saveCompressedFile(&fp, info, onlySelection, createThumbnail);
+    return true;
 }
 
 //---------------------------------------------------------
@@ -596,8 +614,31 @@ QImage Score::createThumbnail()
 
 bool Score::saveCompressedFile(QIODevice* f, const QFileInfo& info, bool onlySelection, bool doCreateThumbnail)
 {
-    MQZipWriter uz(f);
+    ScoreFileEntries entries;
+    if (!compressedFileEntries(entries, info, onlySelection, doCreateThumbnail)) {
+        return false;
+    }
+    QString error;
+    if (!writeCompressedFile(f, entries, &error)) {
+        if (!error.isEmpty()) {
+            MScore::lastError = error;
+        }
+        return false;
+    }
+    return true;
+}
 
+//---------------------------------------------------------
+//   compressedFileEntries
+//    collect the files of a compressed score file; the
+//    entries do not refer to the score, so they can be
+//    written on any thread. Images and audio which are
+//    unchanged since they were loaded are not read here,
+//    they are copied from the score file as they are.
+//---------------------------------------------------------
+
+bool Score::compressedFileEntries(ScoreFileEntries& entries, const QFileInfo& info, bool onlySelection, bool doCreateThumbnail)
+{
     QString fn = info.completeBaseName() + ".mscx";
     QBuffer cbuf;
     cbuf.open(QIODevice::ReadWrite);
@@ -619,19 +660,13 @@ bool Score::saveCompressedFile(QIODevice* f, const QFileInfo& info, bool onlySel
     xml.etag();
     cbuf.seek(0);
     //uz.addDirectory("META-INF");
-    uz.addFile("META-INF/container.xml", cbuf.data());
+    entries.push_back({ "META-INF/container.xml", cbuf.data(), QImage(), QString(), 0 });
 
     QBuffer dbuf;
     dbuf.open(QIODevice::ReadWrite);
     saveFile(&dbuf, true, onlySelection);
     dbuf.seek(0);
-    uz.addFile(fn, dbuf.data());
-
-    QFileDevice* fd = dynamic_cast<QFileDevice*>(f);
-    if (fd) { // if is file (may be buffer)
-        fd->flush();     // flush to preserve score data in case of
-    }
-    // any failures on the further operations.
+    entries.push_back({ fn, dbuf.data(), QImage(), QString(), 0 });
 
     // save images
     //uz.addDirectory("Pictures");
@@ -640,22 +675,20 @@ bool Score::saveCompressedFile(QIODevice* f, const QFileInfo& info, bool onlySel
             continue;
         }
         QString path = QString("Pictures/") + ip->hashName();
-        uz.addFile(path, ip->buffer());
+        if (ip->archive().isEmpty()) {
+            entries.push_back({ path, ip->buffer(), QImage(), QString(), 0 });
+        } else {
+            entries.push_back({ path, QByteArray(), QImage(), ip->archive(), ip->archiveCrc() });
+        }
     }
 
-    // create thumbnail
+    // create thumbnail; painting needs the score, so unlike
+    // the PNG encoding it is not done concurrently with the
+    // other entries. Like all entries it is complete before
+    // anything is written, so a failure here cannot leave a
+    // partly written file.
     if (doCreateThumbnail && !pages().isEmpty()) {
-        QImage pm = createThumbnail();
-
-        QByteArray ba;
-        QBuffer b(&ba);
-        if (!b.open(QIODevice::WriteOnly)) {
-            qDebug("open buffer failed");
-        }
-        if (!pm.save(&b, "PNG")) {
-            qDebug("save failed");
-        }
-        uz.addFile("Thumbnails/thumbnail.png", ba);
+        entries.push_back({ "Thumbnails/thumbnail.png", QByteArray(), createThumbnail(), QString(), 0 });
     }
 
 #ifdef OMR
@@ -666,15 +699,8 @@ bool Score::saveCompressedFile(QIODevice* f, const QFileInfo& info, bool onlySel
         int n = masterScore()->omr()->numPages();
         for (int i = 0; i < n; ++i) {
             QString path = QString("OmrPages/page%1.png").arg(i + 1);
-            QBuffer cbuf1;
             OmrPage* page = masterScore()->omr()->page(i);
-            const QImage& image = page->image();
-            if (!image.save(&cbuf1, "PNG")) {
-                MScore::lastError = tr("Save file: cannot save image (%1x%2)").arg(image.width(), image.height());
-                return false;
-            }
-            uz.addFile(path, cbuf1.data());
-            cbuf1.close();
+            entries.push_back({ path, QByteArray(), page->image(), QString(), 0 });
         }
     }
 #endif
@@ -682,9 +708,88 @@ bool Score::saveCompressedFile(QIODevice* f, const QFileInfo& info, bool onlySel
     // save audio
     //
     if (_audio) {
-        uz.addFile("audio.ogg", _audio->data());
+        if (_audio->archive().isEmpty()) {
+            entries.push_back({ "audio.ogg", _audio->data(), QImage(), QString(), 0 });
+        } else {
+            entries.push_back({ "audio.ogg", QByteArray(), QImage(), _audio->archive(), _audio->archiveCrc() });
+        }
+    }
+    return true;
+}
+
+//---------------------------------------------------------
+//   compressEntry
+//    may run on any thread; fails if an archive entry was
+//    changed or removed since it was loaded, its data is
+//    not available any more
+//---------------------------------------------------------
+
+static bool compressEntry(const ScoreFileEntry& entry, MQZipWriter::CompressedFile* file)
+{
+    if (!entry.archive.isEmpty()) {
+        MQZipReader source(entry.archive);
+        if (source.compressedFileData(entry.path, *file) && file->crc == entry.crc) {
+            return true;
+        }
+        qWarning("compressEntry: cannot copy <%s> from <%s>", qPrintable(entry.path), qPrintable(entry.archive));
+        return false;
     }
+    if (!entry.image.isNull()) {
+        QByteArray ba;
+        QBuffer b(&ba);
+        b.open(QIODevice::WriteOnly);
+        if (!entry.image.save(&b, "PNG")) {
+            qDebug("compressEntry: cannot save image <%s> (%dx%d)", qPrintable(entry.path),
+                   entry.image.width(), entry.image.height());
+        }
+        *file = MQZipWriter::compress(ba, MQZipWriter::AlwaysCompress);
+        return true;
+    }
+    *file = MQZipWriter::compress(entry.data, MQZipWriter::AlwaysCompress);
+    return true;
+}
+
+//---------------------------------------------------------
+//   writeCompressedFile
+//    write the entries collected by compressedFileEntries();
+//    they are compressed concurrently before f is opened,
+//    if it is not open yet, so they may be copied from the
+//    file being overwritten. Nothing is written if an entry
+//    cannot be copied; the reason is returned in error,
+//    which stays empty if f cannot be opened.
+//    May run on any thread.
+//---------------------------------------------------------
 
+bool Score::writeCompressedFile(QIODevice* f, const ScoreFileEntries& entries, QString* error)
+{
+    struct Job {
+        const ScoreFileEntry* entry;
+        MQZipWriter::CompressedFile file;
+        bool ok;
+    };
+    std::vector<Job> jobs;
+    jobs.reserve(entries.size());
+    for (const ScoreFileEntry& e : entries) {
+        jobs.push_back({ &e, MQZipWriter::CompressedFile(), false });
+    }
+    QtConcurrent::blockingMap(jobs, [](Job& j) { j.ok = compressEntry(*j.entry, &j.file); });
+
+    for (const Job& j : jobs) {
+        if (!j.ok) {
+            if (error) {
+                *error = QObject::tr("%1 could not be copied from %2:\nthe file was changed or removed since it was loaded")
+                         .arg(j.entry->path, j.entry->archive);
+            }
+            return false;
+        }
+    }
+    if (!f->isOpen() && !f->open(QIODevice::WriteOnly)) {
+        return false;
+    }
+    MQZipWriter uz(f);
+    for (const Job& j : jobs) {
+        uz.addCompressedFile(j.entry->path, j.file);
+    }
     uz.close();
     return true;
 }
@@ -841,6 +946,76 @@ QString readRootFile(MQZipReader* uz, QList<QString>& images)
     return rootfile;
 }
 
+//---------------------------------------------------------
+//   entryChecksums
+//---------------------------------------------------------
+
+static QHash<QString, uint> entryChecksums(MQZipReader* uz)
+{
+    QHash<QString, uint> crcs;
+    for (const MQZipReader::FileInfo& fi : uz->fileInfoList()) {
+        crcs.insert(fi.filePath, fi.crc);
+    }
+    return crcs;
+}
+
+//---------------------------------------------------------
+//   archiveLoader
+//    read the entry name of the score file archive when
+//    it is first used; the file is only opened then, and
+//    the entry must still have the checksum crc
+//---------------------------------------------------------
+
+static std::function<QByteArray()> archiveLoader(const QString& archive, const QString& name, uint crc)
+{
+    return [archive, name, crc]() {
+        MQZipReader zip(archive);
+        QByteArray data;
+        if (!zip.fileData(name, crc, &data)) {
+            qWarning("cannot read <%s> from <%s>: the file was changed since it was loaded",
+                     qPrintable(name), qPrintable(archive));
+            MScore::lastError = QObject::tr("%1 was changed on disk, %2 could not be loaded").arg(archive, name);
+            return QByteArray();
+        }
+        return data;
+    };
+}
+
+//---------------------------------------------------------
+//   setArchive
+//    the score was saved to path: images and audio which
+//    are still unchanged are read or copied from there by
+//    later saves. An empty path, or an entry missing in the
+//    file, reads them into memory.
+//---------------------------------------------------------
+
+void MasterScore::setArchive(const QString& path)
+{
+    QHash<QString, uint> crcs;
+    if (!path.isEmpty()) {
+        MQZipReader uz(path);
+        crcs = entryChecksums(&uz);
+    }
+    for (ImageStoreItem* ip : imageStore) {
+        if (!ip->isUsed(this)) {
+            continue;
+        }
+        QString name = QString("Pictures/") + ip->hashName();
+        if (crcs.contains(name)) {
+            ip->setArchive(archiveLoader(path, name, crcs[name]), path, crcs[name]);
+        } else {
+            ip->setArchive(nullptr, QString(), 0);
+        }
+    }
+    if (_audio) {
+        if (crcs.contains("audio.ogg")) {
+            _audio->setArchive(archiveLoader(path, "audio.ogg", crcs["audio.ogg"]), path, crcs["audio.ogg"]);
+        } else {
+            _audio->setArchive(nullptr, QString(), 0);
+        }
+    }
+}
+
 //---------------------------------------------------------
 //   loadCompressedMsc
 //    return false on error
@@ -856,27 +1031,53 @@ Score::FileError MasterScore::loadCompressedMsc(QIODevice* io, bool ignoreVersio
         return FileError::FILE_NO_ROOTFILE;
     }
 
+    //
+    // images and audio of a score file are inflated from the
+    // file when they are first used
+    //
+    QFile* file = qobject_cast<QFile*>(io);
+    QString filePath;
+    if (file && !qobject_cast<QTemporaryFile*>(io) && !file->fileName().isEmpty()) {
+        filePath = QFileInfo(file->fileName()).absoluteFilePath();
+    }
+    // the file may be changed or replaced before the data is used:
+    // an entry is only taken if it still has the checksum it has now
+    QHash<QString, uint> crcs;
+    if (!filePath.isEmpty()) {
+        crcs = entryChecksums(&uz);
+    }
+
     //
     // load images
     //
     if (!MScore::noImages) {
         foreach (const QString& s, sl) {
-            QByteArray dbuf = uz.fileData(s);
-            imageStore.add(s, dbuf);
+            if (filePath.isEmpty()) {
+                imageStore.add(s, uz.fileData(s));
+            } else {
+                const uint crc = crcs.value(s);
+                imageStore.addDeferred(s, archiveLoader(filePath, s, crc), filePath, crc);
+            }
         }
     }
 
-    QByteArray dbuf = uz.fileData(rootfile);
-    if (dbuf.isEmpty()) {
+    //
+    // the score is inflated on a background thread while it is parsed
+    //
+    std::unique_ptr<QIODevice> dev(uz.fileDevice(rootfile));
+    if (!dev) {
         QVector<MQZipReader::FileInfo> fil = uz.fileInfoList();
         foreach (const MQZipReader::FileInfo& fi, fil) {
             if (fi.filePath.endsWith(".mscx")) {
-                dbuf = uz.fileData(fi.filePath);
+                dev.reset(uz.fileDevice(fi.filePath));
                 break;
             }
         }
     }
-    XmlReader e(dbuf);
+    if (!dev) {
+        return FileError::FILE_CORRUPTED;
+    }
+    XmlReader e(dev.get());
     e.setDocName(masterScore()->fileInfo()->completeBaseName());
 
     FileError retval = read1(e, ignoreVersionError);
@@ -904,8 +1105,12 @@ Score::FileError MasterScore::loadCompressedMsc(QIODevice* io, bool ignoreVersio
     //  read audio
     //
     if (audio()) {
-        QByteArray dbuf1 = uz.fileData("audio.ogg");
-        audio()->setData(dbuf1);
+        if (filePath.isEmpty()) {
+            audio()->setData(uz.fileData("audio.ogg"));
+        } else {
+            const uint crc = crcs.value("audio.ogg");
+            audio()->setLoader(archiveLoader(filePath, "audio.ogg", crc), filePath, crc);
+        }
     }
     return retval;
 }
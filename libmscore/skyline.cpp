@@ -47,6 +47,7 @@ SkylineLine::SegIter SkylineLine::insert(SegIter i, qreal x, qreal y, qreal w)
     if (i != seg.end() && xr > i->x) {
         i->x = xr;
     }
+    setDirty(i);
     return seg.emplace(i, x, y, w);
 }
 
@@ -56,6 +57,7 @@ SkylineLine::SegIter SkylineLine::insert(SegIter i, qreal x, qreal y, qreal w)
 
 void SkylineLine::append(qreal x, qreal y, qreal w)
 {
+    setDirty(seg.end());
     seg.emplace_back(x, y, w);
 }
 
@@ -145,6 +147,7 @@ void SkylineLine::add(qreal x, qreal y, qreal w)
             } else {
                 i->w = w2;
                 i->y = y;
+                setDirty(i);
                 DP("       B w2 %f\n", w2);
             }
             if (w3 > 0.0000001) {
@@ -156,6 +159,7 @@ void SkylineLine::add(qreal x, qreal y, qreal w)
         } else if ((x <= cx) && ((x + w) >= (cx + i->w))) {                 // F
             DP("    change(F) cx %f y %f\n", cx, y);
             i->y = y;
+            setDirty(i);
         } else if (x < cx) {                                            // C
             qreal w1 = x + w - cx;
             i->w    -= w1;
@@ -198,6 +202,69 @@ void Skyline::clear()
     _south.clear();
 }
 
+void SkylineLine::clear()
+{
+    seg.clear();
+    blockY.clear();
+    dirtyFrom = 0;
+}
+
+//---------------------------------------------------------
+//   setDirty
+//    segment i and all following segments have moved
+//    or changed their y value
+//---------------------------------------------------------
+
+void SkylineLine::setDirty(SegConstIter i)
+{
+    dirtyFrom = qMin(dirtyFrom, size_t(i - seg.cbegin()));
+}
+
+//---------------------------------------------------------
+//   updateBlocks
+//---------------------------------------------------------
+
+void SkylineLine::updateBlocks() const
+{
+    if (dirtyFrom >= seg.size()) {
+        return;
+    }
+    const size_t n = (seg.size() + BLOCK_SIZE - 1) / BLOCK_SIZE;
+    blockY.resize(n);
+    for (size_t b = dirtyFrom / BLOCK_SIZE; b < n; ++b) {
+        const size_t from = b * BLOCK_SIZE;
+        const size_t to   = qMin(from + BLOCK_SIZE, seg.size());
+        qreal y = seg[from].y;
+        for (size_t k = from + 1; k < to; ++k) {
+            y = outer(y, seg[k].y);
+        }
+        blockY[b] = y;
+    }
+    dirtyFrom = seg.size();
+}
+
+//---------------------------------------------------------
+//   outerY
+//    outermost y value of the segments [from, to),
+//    the range must not be empty
+//---------------------------------------------------------
+
+qreal SkylineLine::outerY(size_t from, size_t to) const
+{
+    qreal y  = seg[from].y;
+    size_t k = from + 1;
+    for (; k < to && (k % BLOCK_SIZE); ++k) {
+        y = outer(y, seg[k].y);
+    }
+    for (; k + BLOCK_SIZE <= to; k += BLOCK_SIZE) {
+        y = outer(y, blockY[k / BLOCK_SIZE]);
+    }
+    for (; k < to; ++k) {
+        y = outer(y, seg[k].y);
+    }
+    return y;
+}
+
 //-------------------------------------------------------------------
 //   minDistance
 //    a is located below this skyline.
@@ -210,6 +277,54 @@ qreal Skyline::minDistance(const Skyline& s) const
 }
 
 qreal SkylineLine::minDistance(const SkylineLine& sl) const
+{
+    //
+    // The autoplace code mostly compares the skyline of a single element
+    // against the skyline of a whole staff. Walking the long line from the
+    // start for every element makes autoplace quadratic, so look up the
+    // segments overlapping each segment of the short line by their x
+    // position and take their outermost y value from the block index.
+    //
+    const SkylineLine* s1 = seg.size() <= sl.seg.size() ? this : &sl;     // short line
+    const SkylineLine* s2 = s1 == this ? &sl : this;                      // long line
+    if (north || !sl.north || s1->seg.size() * 4 > s2->seg.size()) {
+        return linearMinDistance(sl);
+    }
+    s2->updateBlocks();
+
+    qreal dist = MINIMUM_Y;
+    for (const SkylineSegment& s : s1->seg) {
+        // the filler segments of an element skyline (from x = 0 up to
+        // the element) would cover everything to the left of it
+        if (!s1->valid(s)) {
+            continue;
+        }
+        auto a = std::upper_bound(s2->seg.begin(), s2->seg.end(), s.x,
+                                  [](qreal x, const SkylineSegment& ss) { return x < ss.x; });
+        if (a != s2->seg.begin()) {
+            --a;
+        }
+        if (a != s2->seg.end() && a->x + a->w <= s.x) {
+            ++a;
+        }
+        auto b = std::lower_bound(a, s2->seg.end(), s.x + s.w,
+                                  [](const SkylineSegment& ss, qreal x) { return ss.x < x; });
+        if (a == b) {
+            continue;
+        }
+        qreal y = s2->outerY(a - s2->seg.begin(), b - s2->seg.begin());
+        dist = qMax(dist, s1 == this ? s.y - y : y - s.y);
+    }
+    return dist;
+}
+
+//---------------------------------------------------------
+//   linearMinDistance
+//    walk both lines, used if they have a similar size;
+//    the reference for minDistance()
+//---------------------------------------------------------
+
+qreal SkylineLine::linearMinDistance(const SkylineLine& sl) const
 {
     qreal dist = MINIMUM_Y;
 
@@ -320,17 +435,13 @@ void SkylineLine::dump() const
 
 qreal SkylineLine::max() const
 {
-    qreal val;
-    if (north) {
-        val = MAXIMUM_Y;
-        for (const SkylineSegment& s : *this) {
-            val = qMin(val, s.y);
-        }
-    } else {
-        val = MINIMUM_Y;
-        for (const SkylineSegment& s : *this) {
-            val = qMax(val, s.y);
-        }
+    if (seg.empty()) {
+        return north ? MAXIMUM_Y : MINIMUM_Y;
+    }
+    updateBlocks();
+    qreal val = blockY.front();
+    for (qreal y : blockY) {
+        val = outer(val, y);
     }
     return val;
 }
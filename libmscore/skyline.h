@@ -40,15 +40,26 @@ struct SkylineSegment {
 
 class SkylineLine
 {
+    static constexpr size_t BLOCK_SIZE = 32;
+
     const bool north;
     std::vector<SkylineSegment> seg;
     typedef std::vector<SkylineSegment>::iterator SegIter;
     typedef std::vector<SkylineSegment>::const_iterator SegConstIter;
 
+    // per block of BLOCK_SIZE segments the outermost y value
+    // (minimum for north, maximum for south); updated lazily
+    mutable std::vector<qreal> blockY;
+    mutable size_t dirtyFrom { 0 };       // first segment not covered by blockY
+
     SegIter insert(SegIter i, qreal x, qreal y, qreal w);
     void append(qreal x, qreal y, qreal w);
     SegIter find(qreal x);
     SegConstIter find(qreal x) const;
+    void setDirty(SegConstIter i);
+    void updateBlocks() const;
+    qreal outer(qreal a, qreal b) const { return north ? qMin(a, b) : qMax(a, b); }
+    qreal outerY(size_t from, size_t to) const;
 
 public:
     SkylineLine(bool n)
@@ -56,10 +67,11 @@ public:
     void add(const Shape& s);
     void add(const QRectF& r);
     void add(qreal x, qreal y, qreal w);
-    void clear() { seg.clear(); }
+    void clear();
     void paint(QPainter&) const;
     void dump() const;
     qreal minDistance(const SkylineLine&) const;
+    qreal linearMinDistance(const SkylineLine&) const;
     qreal max() const;
     bool valid(const SkylineSegment& s) const;
     bool isNorth() const { return north; }
@@ -106,6 +106,7 @@ void System::clear()
         }
     }
     _spannerSegments.clear();
+    invalidateSignature();
     // _systemDividers are reused
 }
 
@@ -1166,6 +1167,47 @@ Fraction System::snapNote(const Fraction& tick, const QPointF p, int staff) cons
     return toMeasure(ml.back())->snap(tick, p - pos());          // TODO: MeasureBase
 }
 
+//---------------------------------------------------------
+//   signature
+//---------------------------------------------------------
+
+SystemSignature System::signature() const
+{
+    SystemSignature s;
+    if (!ml.empty()) {
+        s.first = ml.front();
+        s.last  = ml.back();
+    }
+    s.width  = width();
+    s.height = height();
+    s.staffY.reserve(_staves.size());
+    for (const SysStaff* ss : _staves) {
+        s.staffY.push_back(ss->show() ? ss->y() : -1.0);
+    }
+    return s;
+}
+
+//---------------------------------------------------------
+//   saveSignature
+//---------------------------------------------------------
+
+void System::saveSignature()
+{
+    _signature      = signature();
+    _signatureValid = true;
+}
+
+//---------------------------------------------------------
+//   signatureUnchanged
+//    true if the system was not laid out again since
+//    saveSignature() was called
+//---------------------------------------------------------
+
+bool System::signatureUnchanged() const
+{
+    return _signatureValid && _signature == signature();
+}
+
 //---------------------------------------------------------
 //   firstMeasure
 //---------------------------------------------------------
@@ -74,6 +74,32 @@ public:
     ~SysStaff();
 };
 
+//---------------------------------------------------------
+//   SystemSignature
+///    Layout inputs of a system as seen by page layout.
+///    It is saved when the page of the system is finished.
+///    A system with a saved signature is complete and can
+///    be reused by a later relayout which reaches its first
+///    measure (LayoutContext::reuseSystems()); if the
+///    signature did not change, LayoutContext::collectPage()
+///    also skips the per-measure pass for the system.
+//---------------------------------------------------------
+
+struct SystemSignature {
+    const MeasureBase* first { nullptr };
+    const MeasureBase* last  { nullptr };
+    qreal width              { 0.0 };
+    qreal height             { 0.0 };
+    std::vector<qreal> staffY;
+
+    bool operator==(const SystemSignature& s) const
+    {
+        return first == s.first && last == s.last && width == s.width && height == s.height && staffY == s.staffY;
+    }
+
+    bool operator!=(const SystemSignature& s) const { return !(*this == s); }
+};
+
 //---------------------------------------------------------
 //   System
 ///    One row of measures for all instruments;
@@ -93,6 +119,8 @@ class System final : public Element
     qreal _leftMargin              { 0.0 };         ///< left margin for instrument name, brackets etc.
     mutable bool fixedDownDistance { false };
     qreal _distance                { 0.0 };         // temp. variable used during layout
+    SystemSignature _signature;                     // saved by LayoutContext::collectPage()
+    bool _signatureValid           { false };
 
     int firstVisibleSysStaff() const;
     int lastVisibleSysStaff() const;
@@ -190,6 +218,12 @@ public:
     qreal distance() const { return _distance; }
     void setDistance(qreal d) { _distance = d; }
 
+    SystemSignature signature() const;
+    void saveSignature();
+    void invalidateSignature() { _signatureValid = false; }
+    bool signatureValid() const { return _signatureValid; }
+    bool signatureUnchanged() const;
+
     int firstSysStaffOfPart(const Part* part) const;
     int firstVisibleSysStaffOfPart(const Part* part) const;
     int lastSysStaffOfPart(const Part* part) const;
@@ -2126,7 +2126,7 @@ void ChangeNoteEvents::flip(EditData*)
 
 void ChangeNoteEventList::flip(EditData*)
 {
-    note->score()->setPlaylistDirty();
+    note->score()->setPlaylistDirty(note);
     // Get copy of current list.
     NoteEventList nel = note->playEvents();
     // Replace current copy with new list.
@@ -2147,7 +2147,7 @@ void ChangeNoteEventList::flip(EditData*)
 
 void ChangeChordPlayEventType::flip(EditData*)
 {
-    chord->score()->setPlaylistDirty();
+    chord->score()->setPlaylistDirty(chord);
     // Flips data between NoteEventList's.
     size_t n = chord->notes().size();
     for (size_t i = 0; i < n; ++i) {
@@ -2434,7 +2434,7 @@ void InsertTimeUnmanagedSpanner::flip(EditData*)
 
 void ChangeNoteEvent::flip(EditData*)
 {
-    note->score()->setPlaylistDirty();
+    note->score()->setPlaylistDirty(note);
     NoteEvent e = *oldEvent;
     *oldEvent   = newEvent;
     newEvent    = e;
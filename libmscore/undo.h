@@ -126,6 +126,9 @@ public:
 // #endif
 
     virtual bool isFiltered(Filter, const Element* /* target */) const { return false; }
+    // the element changed by the command, nullptr if the command
+    // may change more than one element
+    virtual const ScoreElement* changedElement() const { return nullptr; }
     bool hasFilteredChildren(Filter, const Element* target) const;
     bool hasUnfilteredChildren(const std::vector<Filter>& filters, const Element* target) const;
     void filterChildren(UndoCommand::Filter f, Element* target);
@@ -206,6 +209,7 @@ public:
     UndoMacro* current() const { return curCmd; }
     UndoMacro* last() const { return curIdx > 0 ? list[curIdx - 1] : 0; }
     UndoMacro* prev() const { return curIdx > 1 ? list[curIdx - 2] : 0; }
+    UndoMacro* next() const { return canRedo() ? list[curIdx] : 0; }
     void undo(EditData*);
     void redo(EditData*);
     void rollback();
@@ -378,6 +382,7 @@ class ChangePitch : public UndoCommand
 
 public:
     ChangePitch(Note* note, int pitch, int tpc1, int tpc2);
+    const ScoreElement* changedElement() const override { return note; }
     UNDO_NAME("ChangePitch")
 };
 
@@ -397,6 +402,7 @@ class ChangeFretting : public UndoCommand
 
 public:
     ChangeFretting(Note* note, int pitch, int string, int fret, int tpc1, int tpc2);
+    const ScoreElement* changedElement() const override { return note; }
     UNDO_NAME("ChangeFretting")
 };
 
@@ -564,6 +570,7 @@ class AddElement : public UndoCommand
 public:
     AddElement(Element*);
     Element* getElement() const { return element; }
+    const ScoreElement* changedElement() const override { return element; }
     virtual void cleanup(bool);
     virtual const char* name() const override;
 
@@ -580,6 +587,7 @@ class RemoveElement : public UndoCommand
 
 public:
     RemoveElement(Element*);
+    const ScoreElement* changedElement() const override { return element; }
     virtual void undo(EditData*) override;
     virtual void redo(EditData*) override;
     virtual void cleanup(bool);
@@ -762,6 +770,7 @@ class ChangeChordStaffMove : public UndoCommand
 
 public:
     ChangeChordStaffMove(ChordRest* cr, int);
+    const ScoreElement* changedElement() const override { return chordRest; }
     UNDO_NAME("ChangeChordStaffMove")
 };
 
@@ -778,6 +787,7 @@ class ChangeVelocity : public UndoCommand
 
 public:
     ChangeVelocity(Note*, Note::ValueType, int);
+    const ScoreElement* changedElement() const override { return note; }
     UNDO_NAME("ChangeVelocity")
 };
 
@@ -981,6 +991,7 @@ class ChangeNoteEventList : public UndoCommand
 public:
     ChangeNoteEventList(Ms::Note* n, NoteEventList& ne)
         : note(n), newEvents(ne), newPetype(PlayEventType::User) {}
+    const ScoreElement* changedElement() const override { return note; }
     UNDO_NAME("ChangeNoteEventList")
 };
 
@@ -1003,6 +1014,7 @@ public:
         events = c->getNoteEventLists();
     }
 
+    const ScoreElement* changedElement() const override { return chord; }
     UNDO_NAME("ChangeChordPlayEventType")
 };
 
@@ -1097,6 +1109,7 @@ public:
         : element(e), id(i), property(v), flags(ps) {}
     Pid getId() const { return id; }
     ScoreElement* getElement() const { return element; }
+    const ScoreElement* changedElement() const override { return element; }
     QVariant data() const { return property; }
     UNDO_NAME("ChangeProperty")
 
@@ -1304,6 +1317,7 @@ class ChangeNoteEvent : public UndoCommand
 public:
     ChangeNoteEvent(Note* n, NoteEvent* oe, const NoteEvent& ne)
         : note(n), oldEvent(oe), newEvent(ne), newPetype(PlayEventType::User) {}
+    const ScoreElement* changedElement() const override { return note; }
     UNDO_NAME("ChangeNoteEvent")
 };
 
@@ -1325,6 +1339,7 @@ protected:
 public:
     LinkUnlink() {}
     ~LinkUnlink();
+    const ScoreElement* changedElement() const override { return e; }
 };
 
 //---------------------------------------------------------
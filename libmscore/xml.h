@@ -62,6 +62,21 @@ public:
     int assignLocalIndex(const Location& mainElementInfo);
 };
 
+//---------------------------------------------------------
+//   ExcerptLinks
+//    link state of a XmlReader when the first part score
+//    of a master score is reached. Deferred part scores
+//    are read with a reader restored to this state. The
+//    LinkedElements belong to elements of the master
+//    score, which therefore must not be edited before the
+//    part scores are read.
+//---------------------------------------------------------
+
+struct ExcerptLinks {
+    QMap<int, QList<QPair<LinkedElements*, Location> > > staffLinkedElements;
+    LinksIndexer linksIndexer;
+};
+
 //---------------------------------------------------------
 //   XmlReader
 //---------------------------------------------------------
@@ -211,6 +226,9 @@ public:
 
     QList<std::pair<Element*, QPointF> >& fixOffsets() { return _fixOffsets; }
 
+    ExcerptLinks excerptLinks() const { return { _staffLinkedElements, _linksIndexer }; }
+    void setExcerptLinks(const ExcerptLinks& l) { _staffLinkedElements = l.staffLinkedElements; _linksIndexer = l.linksIndexer; }
+
     // for reading old files (< 3.01)
     QMap<int, QList<QPair<LinkedElements*, Location> > >& staffLinkedElements() { return _staffLinkedElements; }
     void setOffsetLines(qint64 val) { _offsetLines = val; }
@@ -218,14 +236,25 @@ public:
 
 //---------------------------------------------------------
 //   XmlWriter
+//    writes UTF-8 into a byte buffer which is handed to the
+//    device (or appended to the string) whenever the
+//    outermost element is closed, the buffer is full or on
+//    flush(). The names of the open elements are kept in a
+//    single buffer reused for the whole document.
 //---------------------------------------------------------
 
-class XmlWriter : public QTextStream
+class XmlWriter
 {
     static const int BS = 2048;
+    static const int BUFFER_SIZE = 64 * 1024;
+
+    QIODevice* _device { nullptr };
+    QString* _string   { nullptr };
+    QByteArray _buffer;                 // output not yet flushed
+    QByteArray _names;                  // names of the open elements
+    std::vector<int> _stack;            // start of each open element name in _names
 
     Score* _score;
-    QList<QString> stack;
     SelectionFilter _filter;
 
     Fraction _curTick    { 0, 1 };       // used to optimize output
@@ -246,10 +275,38 @@ class XmlWriter : public QTextStream
     bool _recordElements = false;
 
     void putLevel();
+    void put(const char* s, int len) { _buffer.append(s, len); }
+    void put(const char* s) { _buffer.append(s); }
+    void put(char c) { _buffer.append(c); }
+    void putLatin1(const char*);
+    void putString(const QString&);
+    void putEscaped(const QString&);
+    void putInt(qlonglong);
+    void putDouble(double);
+    void push(const char* name, int len);
+    void putTag(const char* name, int len, const QVariant& data);
+    void written();
 
 public:
     XmlWriter(Score*);
     XmlWriter(Score* s, QIODevice* dev);
+    XmlWriter(const XmlWriter&) = delete;
+    XmlWriter& operator=(const XmlWriter&) = delete;
+    ~XmlWriter();
+
+    QIODevice* device() const { return _device; }
+    void setDevice(QIODevice*);
+    void setString(QString*, QIODevice::OpenMode = QIODevice::ReadWrite);
+    void flush();
+
+    XmlWriter& operator<<(const char* s) { putLatin1(s); written(); return *this; }
+    XmlWriter& operator<<(char c);
+    XmlWriter& operator<<(QChar c) { putString(QString(c)); written(); return *this; }
+    XmlWriter& operator<<(const QString& s) { putString(s); written(); return *this; }
+    XmlWriter& operator<<(const QByteArray& s) { put(s.constData(), s.size()); written(); return *this; }
+    XmlWriter& operator<<(int v) { putInt(v); written(); return *this; }
+    XmlWriter& operator<<(qlonglong v) { putInt(v); written(); return *this; }
+    XmlWriter& operator<<(double v) { putDouble(v); written(); return *this; }
 
     Fraction curTick() const { return _curTick; }
     void setCurTick(const Fraction& v) { _curTick   = v; }
@@ -288,6 +345,7 @@ public:
 
     void header();
 
+    void stag(const char*);
     void stag(const QString&);
     void etag();
 
@@ -14,10 +14,7 @@
 #include "property.h"
 #include "scoreElement.h"
 
-#if (QT_VERSION >= QT_VERSION_CHECK(5, 15, 0)) //???
-#define endl Qt::endl
-#define dec Qt::dec
-#endif
+#include <cmath>
 
 namespace Ms {
 //---------------------------------------------------------
@@ -27,14 +24,197 @@ namespace Ms {
 XmlWriter::XmlWriter(Score* s)
 {
     _score = s;
-    setCodec("UTF-8");
+    _buffer.reserve(BUFFER_SIZE + BS);
+    _names.reserve(256);
 }
 
 XmlWriter::XmlWriter(Score* s, QIODevice* device)
-    : QTextStream(device)
+    : XmlWriter(s)
 {
-    _score = s;
-    setCodec("UTF-8");
+    _device = device;
+}
+
+XmlWriter::~XmlWriter()
+{
+    flush();
+}
+
+//---------------------------------------------------------
+//   setDevice
+//---------------------------------------------------------
+
+void XmlWriter::setDevice(QIODevice* device)
+{
+    flush();
+    _device = device;
+    _string = nullptr;
+}
+
+//---------------------------------------------------------
+//   setString
+//    the output is appended to s
+//---------------------------------------------------------
+
+void XmlWriter::setString(QString* s, QIODevice::OpenMode)
+{
+    flush();
+    _device = nullptr;
+    _string = s;
+}
+
+//---------------------------------------------------------
+//   flush
+//---------------------------------------------------------
+
+void XmlWriter::flush()
+{
+    if (_buffer.isEmpty()) {
+        return;
+    }
+    if (_device) {
+        _device->write(_buffer);
+    } else if (_string) {
+        _string->append(QString::fromUtf8(_buffer));
+    }
+    _buffer.resize(0);            // keeps the reserved capacity
+}
+
+//---------------------------------------------------------
+//   written
+//    called after each write; the output is flushed once
+//    the document (or fragment) is complete, so it can be
+//    read from the device while the writer still exists
+//---------------------------------------------------------
+
+void XmlWriter::written()
+{
+    if (_stack.empty() || _buffer.size() >= BUFFER_SIZE) {
+        flush();
+    }
+}
+
+//---------------------------------------------------------
+//   operator<<
+//    char and const char* are Latin-1, as for QTextStream
+//---------------------------------------------------------
+
+XmlWriter& XmlWriter::operator<<(char c)
+{
+    if (uchar(c) < 0x80) {
+        put(c);
+    } else {
+        putString(QString(QChar::fromLatin1(c)));
+    }
+    written();
+    return *this;
+}
+
+//---------------------------------------------------------
+//   putLatin1
+//---------------------------------------------------------
+
+void XmlWriter::putLatin1(const char* s)
+{
+    const char* p = s;
+    while (*p && uchar(*p) < 0x80) {
+        ++p;
+    }
+    put(s, int(p - s));
+    if (*p) {
+        putString(QString::fromLatin1(p));
+    }
+}
+
+//---------------------------------------------------------
+//   putString
+//---------------------------------------------------------
+
+void XmlWriter::putString(const QString& s)
+{
+    const QChar* p = s.constData();
+    const int n    = s.size();
+    int i = 0;
+    for (; i < n && p[i].unicode() < 0x80; ++i) {
+        put(char(p[i].unicode()));
+    }
+    if (i < n) {
+        _buffer.append(QString::fromRawData(p + i, n - i).toUtf8());
+    }
+}
+
+//---------------------------------------------------------
+//   putEscaped
+//    write xmlString(s)
+//---------------------------------------------------------
+
+void XmlWriter::putEscaped(const QString& s)
+{
+    const QChar* p = s.constData();
+    const int n    = s.size();
+    for (int i = 0; i < n; ++i) {
+        const ushort c = p[i].unicode();
+        switch (c) {
+        case '<':
+            put("&lt;", 4);
+            break;
+        case '>':
+            put("&gt;", 4);
+            break;
+        case '&':
+            put("&amp;", 5);
+            break;
+        case '\"':
+            put("&quot;", 6);
+            break;
+        default:
+            if (c >= 0x80) {
+                // the rest is converted in one go, up to the next escape
+                int k = i + 1;
+                while (k < n && p[k].unicode() >= 0x80) {
+                    ++k;
+                }
+                _buffer.append(QString::fromRawData(p + i, k - i).toUtf8());
+                i = k - 1;
+            } else if (c >= 0x20 || c == 0x09 || c == 0x0A || c == 0x0D) {
+                put(char(c));
+            }
+            // ignore invalid characters in xml 1.0
+            break;
+        }
+    }
+}
+
+//---------------------------------------------------------
+//   putInt
+//---------------------------------------------------------
+
+void XmlWriter::putInt(qlonglong v)
+{
+    char buffer[24];
+    char* p = buffer + sizeof(buffer);
+    qulonglong u = v < 0 ? 0 - qulonglong(v) : qulonglong(v);
+    do {
+        *--p = char('0' + u % 10);
+        u /= 10;
+    } while (u);
+    if (v < 0) {
+        *--p = '-';
+    }
+    put(p, int(buffer + sizeof(buffer) - p));
+}
+
+//---------------------------------------------------------
+//   putDouble
+//    same as QString::number(v), six significant digits
+//---------------------------------------------------------
+
+void XmlWriter::putDouble(double v)
+{
+    if (v == std::floor(v) && qAbs(v) < 1e6 && !(v == 0.0 && std::signbit(v))) {
+        putInt(qlonglong(v));
+    } else {
+        _buffer.append(QByteArray::number(v, 'g', 6));
+    }
 }
 
 //---------------------------------------------------------
@@ -55,19 +235,34 @@ void XmlWriter::pTag(const char* name, PlaceText place)
 
 void XmlWriter::putLevel()
 {
-    int level = stack.size();
-    for (int i = 0; i < level * 2; ++i) {
-        *this << ' ';
+    static const char spaces[] = "                                                                ";
+    int n = int(_stack.size()) * 2;
+    while (n > 0) {
+        const int k = qMin(n, int(sizeof(spaces)) - 1);
+        put(spaces, k);
+        n -= k;
     }
 }
 
+//---------------------------------------------------------
+//   push
+//    open element name
+//---------------------------------------------------------
+
+void XmlWriter::push(const char* name, int len)
+{
+    _stack.push_back(_names.size());
+    _names.append(name, len);
+}
+
 //---------------------------------------------------------
 //   header
 //---------------------------------------------------------
 
 void XmlWriter::header()
 {
-    *this << "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n";
+    put("<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n");
+    written();
 }
 
 //---------------------------------------------------------
@@ -75,11 +270,20 @@ void XmlWriter::header()
 //    <mops attribute="value">
 //---------------------------------------------------------
 
-void XmlWriter::stag(const QString& s)
+void XmlWriter::stag(const char* s)
 {
     putLevel();
-    *this << '<' << s << '>' << endl;
-    stack.append(s.split(' ')[0]);
+    put('<');
+    put(s);
+    put(">\n", 2);
+    const char* e = strchr(s, ' ');
+    push(s, e ? int(e - s) : int(strlen(s)));
+}
+
+void XmlWriter::stag(const QString& s)
+{
+    const QByteArray ba = s.toUtf8();
+    stag(ba.constData());
 }
 
 //---------------------------------------------------------
@@ -99,13 +303,16 @@ void XmlWriter::stag(const ScoreElement* se, const QString& attributes)
 
 void XmlWriter::stag(const QString& name, const ScoreElement* se, const QString& attributes)
 {
+    const QByteArray ba = name.toUtf8();
     putLevel();
-    *this << '<' << name;
+    put('<');
+    put(ba.constData(), ba.size());
     if (!attributes.isEmpty()) {
-        *this << ' ' << attributes;
+        put(' ');
+        putString(attributes);
     }
-    *this << '>' << endl;
-    stack.append(name);
+    put(">\n", 2);
+    push(ba.constData(), ba.size());
 
     if (_recordElements) {
         _elements.emplace_back(se, name);
@@ -120,7 +327,13 @@ void XmlWriter::stag(const QString& name, const ScoreElement* se, const QString&
 void XmlWriter::etag()
 {
     putLevel();
-    *this << "</" << stack.takeLast() << '>' << endl;
+    const int start = _stack.back();
+    _stack.pop_back();
+    put("</", 2);
+    put(_names.constData() + start, _names.size() - start);
+    put(">\n", 2);
+    _names.resize(start);
+    written();
 }
 
 //---------------------------------------------------------
@@ -133,12 +346,13 @@ void XmlWriter::tagE(const char* format, ...)
     va_list args;
     va_start(args, format);
     putLevel();
-    *this << '<';
+    put('<');
     char buffer[BS];
     vsnprintf(buffer, BS, format, args);
-    *this << buffer;
+    putLatin1(buffer);
     va_end(args);
-    *this << "/>" << endl;
+    put("/>\n", 3);
+    written();
 }
 
 //---------------------------------------------------------
@@ -148,7 +362,10 @@ void XmlWriter::tagE(const char* format, ...)
 void XmlWriter::tagE(const QString& s)
 {
     putLevel();
-    *this << '<' << s << "/>\n";
+    put('<');
+    putString(s);
+    put("/>\n", 3);
+    written();
 }
 
 //---------------------------------------------------------
@@ -159,7 +376,10 @@ void XmlWriter::tagE(const QString& s)
 void XmlWriter::ntag(const char* name)
 {
     putLevel();
-    *this << "<" << name << ">";
+    put('<');
+    putLatin1(name);
+    put('>');
+    written();
 }
 
 //---------------------------------------------------------
@@ -169,7 +389,10 @@ void XmlWriter::ntag(const char* name)
 
 void XmlWriter::netag(const char* s)
 {
-    *this << "</" << s << '>' << endl;
+    put("</", 2);
+    putLatin1(s);
+    put(">\n", 2);
+    written();
 }
 
 //---------------------------------------------------------
@@ -202,13 +425,36 @@ void XmlWriter::tag(Pid id, QVariant data, QVariant defaultData)
 void XmlWriter::tag(const char* name, QVariant data, QVariant defaultData)
 {
     if (data != defaultData) {
-        tag(QString(name), data);
+        putTag(name, int(strlen(name)), data);
     }
 }
 
 void XmlWriter::tag(const QString& name, QVariant data)
 {
-    QString ename(name.split(' ')[0]);
+    const QByteArray ba = name.toUtf8();
+    putTag(ba.constData(), ba.size(), data);
+}
+
+//---------------------------------------------------------
+//   putTag
+//    name is UTF-8 and may contain attributes; the names
+//    of properties are written as they are
+//---------------------------------------------------------
+
+void XmlWriter::putTag(const char* name, int len, const QVariant& data)
+{
+    const char* e = static_cast<const char*>(memchr(name, ' ', len));
+    const int elen = e ? int(e - name) : len;
+    auto open = [&]() {
+        put('<');
+        put(name, len);
+        put('>');
+    };
+    auto close = [&](int n) {
+        put("</", 2);
+        put(name, n);
+        put(">\n", 2);
+    };
 
     putLevel();
     switch (data.type()) {
@@ -216,73 +462,114 @@ void XmlWriter::tag(const QString& name, QVariant data)
     case QVariant::Char:
     case QVariant::Int:
     case QVariant::UInt:
-        *this << "<" << name << ">";
-        *this << data.toInt();
-        *this << "</" << ename << ">\n";
+        open();
+        putInt(data.toInt());
+        close(elen);
         break;
     case QVariant::LongLong:
-        *this << "<" << name << ">";
-        *this << data.toLongLong();
-        *this << "</" << ename << ">\n";
+        open();
+        putInt(data.toLongLong());
+        close(elen);
         break;
     case QVariant::Double:
-        *this << "<" << name << ">";
-        *this << data.value<double>();
-        *this << "</" << ename << ">\n";
+        open();
+        putDouble(data.value<double>());
+        close(elen);
         break;
     case QVariant::String:
-        *this << "<" << name << ">";
-        *this << xmlString(data.value<QString>());
-        *this << "</" << ename << ">\n";
+        open();
+        putEscaped(data.value<QString>());
+        close(elen);
         break;
     case QVariant::Color:
     {
         QColor color(data.value<QColor>());
-        *this << QString("<%1 r=\"%2\" g=\"%3\" b=\"%4\" a=\"%5\"/>\n")
-            .arg(name).arg(color.red()).arg(color.green()).arg(color.blue()).arg(color.alpha());
+        put('<');
+        put(name, len);
+        put(" r=\"", 4);
+        putInt(color.red());
+        put("\" g=\"", 5);
+        putInt(color.green());
+        put("\" b=\"", 5);
+        putInt(color.blue());
+        put("\" a=\"", 5);
+        putInt(color.alpha());
+        put("\"/>\n", 4);
     }
     break;
     case QVariant::Rect:
     {
         const QRect& r(data.value<QRect>());
-        *this
-            << QString("<%1 x=\"%2\" y=\"%3\" w=\"%4\" h=\"%5\"/>\n").arg(name).arg(r.x()).arg(r.y()).arg(r.width())
-            .arg(
-            r.height());
+        put('<');
+        put(name, len);
+        put(" x=\"", 4);
+        putInt(r.x());
+        put("\" y=\"", 5);
+        putInt(r.y());
+        put("\" w=\"", 5);
+        putInt(r.width());
+        put("\" h=\"", 5);
+        putInt(r.height());
+        put("\"/>\n", 4);
     }
     break;
     case QVariant::RectF:
     {
         const QRectF& r(data.value<QRectF>());
-        *this
-            << QString("<%1 x=\"%2\" y=\"%3\" w=\"%4\" h=\"%5\"/>\n").arg(name).arg(r.x()).arg(r.y()).arg(r.width())
-            .arg(
-            r.height());
+        put('<');
+        put(name, len);
+        put(" x=\"", 4);
+        putDouble(r.x());
+        put("\" y=\"", 5);
+        putDouble(r.y());
+        put("\" w=\"", 5);
+        putDouble(r.width());
+        put("\" h=\"", 5);
+        putDouble(r.height());
+        put("\"/>\n", 4);
     }
     break;
     case QVariant::PointF:
     {
         const QPointF& p(data.value<QPointF>());
-        *this << QString("<%1 x=\"%2\" y=\"%3\"/>\n").arg(name).arg(p.x()).arg(p.y());
+        put('<');
+        put(name, len);
+        put(" x=\"", 4);
+        putDouble(p.x());
+        put("\" y=\"", 5);
+        putDouble(p.y());
+        put("\"/>\n", 4);
     }
     break;
     case QVariant::SizeF:
     {
         const QSizeF& p(data.value<QSizeF>());
-        *this << QString("<%1 w=\"%2\" h=\"%3\"/>\n").arg(name).arg(p.width()).arg(p.height());
+        put('<');
+        put(name, len);
+        put(" w=\"", 4);
+        putDouble(p.width());
+        put("\" h=\"", 5);
+        putDouble(p.height());
+        put("\"/>\n", 4);
     }
     break;
     default: {
         const char* type = data.typeName();
         if (strcmp(type, "Ms::Spatium") == 0) {
-            *this << "<" << name << ">";
-            *this << data.value<Spatium>().val();
-            *this << "</" << ename << ">\n";
+            open();
+            putDouble(data.value<Spatium>().val());
+            close(elen);
         } else if (strcmp(type, "Ms::Fraction") == 0) {
             const Fraction& f = data.value<Fraction>();
-            *this << QString("<%1>%2/%3</%1>\n").arg(name).arg(f.numerator()).arg(f.denominator());
+            open();
+            putInt(f.numerator());
+            put('/');
+            putInt(f.denominator());
+            close(len);
         } else if (strcmp(type, "Ms::Direction") == 0) {
-            *this << QString("<%1>%2</%1>\n").arg(name).arg(toString(data.value<Direction>()));
+            open();
+            put(toString(data.value<Direction>()));
+            close(len);
         } else if (strcmp(type, "Ms::Align") == 0) {
             // TODO: remove from here? (handled in Ms::propertyWritableValue())
             Align a = Align(data.toInt());
@@ -304,13 +591,18 @@ void XmlWriter::tag(const QString& name, QVariant data)
             } else {
                 v = "top";
             }
-            *this << QString("<%1>%2,%3</%1>\n").arg(name).arg(h).arg(v);
+            open();
+            put(h);
+            put(',');
+            put(v);
+            close(len);
         } else {
             qFatal("XmlWriter::tag: unsupported type %d %s", data.type(), type);
         }
     }
     break;
     }
+    written();
 }
 
 void XmlWriter::tag(const char* name, const QWidget* g)
@@ -325,7 +617,10 @@ void XmlWriter::tag(const char* name, const QWidget* g)
 void XmlWriter::comment(const QString& text)
 {
     putLevel();
-    *this << "<!-- " << text << " -->" << endl;
+    put("<!-- ", 5);
+    putString(text);
+    put(" -->\n", 5);
+    written();
 }
 
 //---------------------------------------------------------
@@ -373,26 +668,28 @@ QString XmlWriter::xmlString(const QString& s)
 
 void XmlWriter::dump(int len, const unsigned char* p)
 {
+    QString line;
+    QTextStream ts(&line);
+    ts.setNumberFlags(QTextStream::ShowBase);
+    ts.setIntegerBase(16);
+
     putLevel();
     int col = 0;
-    setFieldWidth(5);
-    setNumberFlags(numberFlags() | QTextStream::ShowBase);
-    setIntegerBase(16);
     for (int i = 0; i < len; ++i, ++col) {
         if (col >= 16) {
-            setFieldWidth(0);
-            *this << endl;
+            ts << '\n';
+            putString(line);
+            line.clear();
             col = 0;
             putLevel();
-            setFieldWidth(5);
         }
-        *this << (p[i] & 0xff);
+        ts << qSetFieldWidth(5) << (p[i] & 0xff) << qSetFieldWidth(0);
     }
     if (col) {
-        *this << endl << dec;
+        ts << '\n';
     }
-    setFieldWidth(0);
-    setIntegerBase(10);
+    putString(line);
+    written();
 }
 
 //---------------------------------------------------------
@@ -402,7 +699,8 @@ void XmlWriter::dump(int len, const unsigned char* p)
 
 void XmlWriter::writeXml(const QString& name, QString s)
 {
-    QString ename(name.split(' ')[0]);
+    const QByteArray ba = name.toUtf8();
+    const char* e = static_cast<const char*>(memchr(ba.constData(), ' ', ba.size()));
     putLevel();
     for (int i = 0; i < s.size(); ++i) {
         ushort c = s.at(i).unicode();
@@ -410,9 +708,14 @@ void XmlWriter::writeXml(const QString& name, QString s)
             s[i] = '?';
         }
     }
-    *this << "<" << name << ">";
-    *this << s;
-    *this << "</" << ename << ">\n";
+    put('<');
+    put(ba.constData(), ba.size());
+    put('>');
+    putString(s);
+    put("</", 2);
+    put(ba.constData(), e ? int(e - ba.constData()) : ba.size());
+    put(">\n", 2);
+    written();
 }
 
 //---------------------------------------------------------
@@ -0,0 +1,399 @@
+//=============================================================================
+//  MuseScore
+//  Music Composition & Notation
+//
+//  Copyright (C) 2020 Werner Schweer and others
+//
+//  This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License version 2.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+//=============================================================================
+
+#include <algorithm>
+#include <map>
+#include <memory>
+#include <QtConcurrent>
+#include <QTemporaryFile>
+
+#include "audiorenderer.h"
+#include "libmscore/score.h"
+#include "libmscore/part.h"
+#include "libmscore/instrument.h"
+#include "libmscore/repeatlist.h"
+#include "libmscore/mscore.h"
+#include "audio/midi/msynthesizer.h"
+#include "musescore.h"
+
+namespace Ms {
+static const unsigned CHUNK = 16 * AudioRenderer::FRAMES;    // frames rendered per stem and step
+static const int MAX_STEMS   = 4;                            // synthesizers created by assignChannels
+
+//---------------------------------------------------------
+//   AudioRenderer
+//    synth is used for the first stem and for the master
+//    effects; it is switched to dry rendering and should
+//    only be deleted afterwards
+//---------------------------------------------------------
+
+AudioRenderer::AudioRenderer(Score* score, const EventMap& events, MasterSynthesizer* synth,
+                             const SynthesizerState& state, int sampleRate)
+    : _score(score), _eventMap(events), _synth(synth), _state(state), _sampleRate(sampleRate)
+{
+}
+
+AudioRenderer::~AudioRenderer()
+{
+    for (Stem& s : _stems) {
+        if (s.owned) {
+            delete s.synth;
+        }
+    }
+}
+
+//---------------------------------------------------------
+//   prepare
+//    convert the events to frames and distribute the
+//    channels over the stems
+//---------------------------------------------------------
+
+void AudioRenderer::prepare()
+{
+    MasterScore* ms = _score->masterScore();
+    EventMap::const_iterator endPos = _eventMap.cend();
+    --endPos;
+    _endTime    = (_score->utick2utime(endPos->first) + 1) * _sampleRate;
+    _maxEndTime = (_score->utick2utime(endPos->first) + 3) * _sampleRate;
+
+    // convert all event times once, the event map is sorted by tick
+    std::vector<int> eventTicks;
+    eventTicks.reserve(_eventMap.size());
+    for (const auto& e : _eventMap) {
+        eventTicks.push_back(e.first);
+    }
+    const std::vector<qreal> eventTimes = _score->repeatList().utick2utime(eventTicks);
+
+    // the channel state does not change while exporting, so muted
+    // channels are dropped here
+    std::map<int, int> weight;          // events per channel
+    size_t idx = 0;
+    _events.reserve(_eventMap.size());
+    for (const auto& e : _eventMap) {
+        const NPlayEvent& pe = e.second;
+        const qreal time = eventTimes[idx++];
+        if (!pe.isChannelEvent()) {
+            continue;
+        }
+        const Channel* c = ms->midiMapping(pe.channel())->articulation();
+        if (c->mute()) {
+            continue;
+        }
+        _events.push_back({ int(time * _sampleRate), _synth->index(c->synti()), pe });
+        ++weight[pe.channel()];
+    }
+    for (Part* part : _score->parts()) {
+        const InstrumentList* il = part->instruments();
+        for (auto i = il->begin(); i != il->end(); i++) {
+            for (const Channel* instrChan : i->second->channel()) {
+                weight.emplace(ms->playbackChannel(instrChan)->channel(), 0);
+            }
+        }
+    }
+
+    if (_partWriter) {
+        assignParts();
+    } else {
+        assignChannels(weight);
+    }
+    std::map<int, int> stemOfChannel;
+    for (size_t i = 0; i < _stems.size(); ++i) {
+        for (int c : _stems[i].channels) {
+            stemOfChannel[c] = int(i);
+        }
+    }
+    for (size_t i = 0; i < _events.size(); ++i) {
+        auto c = stemOfChannel.find(_events[i].event.channel());
+        if (c != stemOfChannel.end()) {
+            _stems[c->second].events.push_back(int(i));
+        }
+    }
+
+    const int stems = int(_stems.size());
+    for (int i = 0; i < stems; ++i) {
+        Stem& s = _stems[i];
+        if (i == 0) {
+            s.synth = _synth;
+        } else {
+            s.synth = synthesizerFactory();
+            s.synth->init();
+            s.synth->setSampleRate(_sampleRate);
+            if (!s.synth->setState(_state) || !s.synth->hasSoundFontsLoaded()) {
+                s.synth->init();
+            }
+            s.owned = true;
+        }
+        if (stems > 1) {
+            // the stems already use all cores
+            s.synth->setDspThreads(1);
+        }
+        s.synth->setDry(true);
+        s.buffer.resize(CHUNK * 2);
+    }
+}
+
+//---------------------------------------------------------
+//   assignChannels
+//    one stem per core, but at most MAX_STEMS: every stem
+//    beyond the first is a synthesizer of its own. Longest
+//    processing time first: the busiest channel goes to the
+//    stem with the least events
+//---------------------------------------------------------
+
+void AudioRenderer::assignChannels(const std::map<int, int>& weight)
+{
+    const int stems = qBound(1, qMin(QThread::idealThreadCount(), MAX_STEMS), int(weight.size()));
+    std::vector<std::pair<int, int> > channels(weight.begin(), weight.end());
+    std::stable_sort(channels.begin(), channels.end(),
+                     [](const std::pair<int, int>& a, const std::pair<int, int>& b) { return a.second > b.second; });
+    std::vector<int> load(stems, 0);
+    _stems.resize(stems);
+    for (const auto& c : channels) {
+        const int s = int(std::min_element(load.begin(), load.end()) - load.begin());
+        load[s] += c.second;
+        _stems[s].channels.push_back(c.first);
+    }
+}
+
+//---------------------------------------------------------
+//   assignParts
+//    one stem per part
+//---------------------------------------------------------
+
+void AudioRenderer::assignParts()
+{
+    MasterScore* ms = _score->masterScore();
+    _stems.resize(qMax(_score->parts().size(), 1));
+    int idx = 0;
+    for (Part* part : _score->parts()) {
+        const InstrumentList* il = part->instruments();
+        for (auto i = il->begin(); i != il->end(); i++) {
+            for (const Channel* instrChan : i->second->channel()) {
+                _stems[idx].channels.push_back(ms->playbackChannel(instrChan)->channel());
+            }
+        }
+        ++idx;
+    }
+}
+
+//---------------------------------------------------------
+//   initStem
+//    reset the synthesizer and send the initialization
+//    events of the stem channels
+//---------------------------------------------------------
+
+void AudioRenderer::initStem(Stem& stem)
+{
+    MasterScore* ms = _score->masterScore();
+    stem.synth->allSoundsOff(-1);
+    stem.pos      = 0;
+    stem.notesOff = false;
+    for (Part* part : _score->parts()) {
+        const InstrumentList* il = part->instruments();
+        for (auto i = il->begin(); i != il->end(); i++) {
+            for (const Channel* instrChan : i->second->channel()) {
+                const Channel* a = ms->playbackChannel(instrChan);
+                if (std::find(stem.channels.begin(), stem.channels.end(), a->channel()) == stem.channels.end()) {
+                    continue;
+                }
+                for (MidiCoreEvent e : a->initList()) {
+                    if (e.type() == ME_INVALID) {
+                        continue;
+                    }
+                    e.setChannel(a->channel());
+                    int syntiIdx = stem.synth->index(ms->midiMapping(a->channel())->articulation()->synti());
+                    stem.synth->play(e, syntiIdx);
+                }
+            }
+        }
+    }
+}
+
+//---------------------------------------------------------
+//   renderChunk
+//    render CHUNK frames of a stem starting at frame start;
+//    may run on any thread.
+//    Commands a synthesizer gets from another thread than
+//    the one that processed last are queued until its next
+//    process() call, so the final note offs are sent right
+//    before processing the rest of their block: they never
+//    wait for the next chunk, which may run on another
+//    thread after the first events of that chunk.
+//---------------------------------------------------------
+
+void AudioRenderer::renderChunk(Stem& stem, int start)
+{
+    MasterSynthesizer* synth = stem.synth;
+    float* p = stem.buffer.data();
+    memset(p, 0, sizeof(float) * CHUNK * 2);
+
+    for (unsigned b = 0; b < CHUNK; b += FRAMES) {
+        float* block = p;
+        int playTime  = start + b;
+        unsigned frames = FRAMES;
+        const int endTime = playTime + FRAMES;
+        for (; stem.pos < stem.events.size(); ++stem.pos) {
+            const Event& e = _events[stem.events[stem.pos]];
+            if (e.frame >= endTime) {
+                break;
+            }
+            const int n = qMax(e.frame - playTime, 0);
+            if (n) {
+                synth->process(n, p);
+                p += 2 * n;
+            }
+            playTime += n;
+            frames   -= n;
+            synth->play(e.event, e.synti);
+        }
+        if (!stem.notesOff && _endTime < endTime) {
+            const int n = qMax(_endTime - playTime, 0);
+            if (n) {
+                synth->process(n, p);
+                p += 2 * n;
+            }
+            frames -= n;
+            synth->allNotesOff(-1);
+            stem.notesOff = true;
+        }
+        if (frames) {
+            synth->process(frames, p);
+            p += 2 * frames;
+        }
+        if (_partWriter) {
+            synth->processEffects(FRAMES, block);
+        }
+    }
+}
+
+//---------------------------------------------------------
+//   render
+//    returns false if cancelled or aborted by a writer
+//---------------------------------------------------------
+
+bool AudioRenderer::render(Writer write)
+{
+    if (_eventMap.empty()) {
+        return false;
+    }
+    prepare();
+    for (Stem& s : _stems) {
+        initStem(s);
+    }
+
+    // output 0 is the mix, output i + 1 part i
+    const size_t outputs = _partWriter ? _stems.size() + 1 : 1;
+    auto deliver = [&](size_t idx, const float* block) {
+        return idx ? _partWriter(int(idx - 1), block) : write(block);
+    };
+    std::vector<std::unique_ptr<QTemporaryFile> > tmp;
+    if (_normalize) {
+        for (size_t i = 0; i < outputs; ++i) {
+            tmp.emplace_back(new QTemporaryFile);
+            if (!tmp.back()->open()) {
+                qDebug("AudioRenderer: cannot create temporary file");
+                return false;
+            }
+        }
+    }
+    auto output = [&](size_t idx, const float* block) {
+        if (!_normalize) {
+            return deliver(idx, block);
+        }
+        const qint64 size = FRAMES * 2 * sizeof(float);
+        if (tmp[idx]->write(reinterpret_cast<const char*>(block), size) != size) {
+            qDebug("AudioRenderer: write to temporary file failed");
+            return false;
+        }
+        return true;
+    };
+
+    float block[FRAMES * 2];
+    float peak = 0.0;
+    bool done  = false;
+    for (int chunkStart = 0; !done; chunkStart += CHUNK) {
+        if (_stems.size() == 1) {
+            renderChunk(_stems[0], chunkStart);
+        } else {
+            QtConcurrent::blockingMap(_stems, [this, chunkStart](Stem& s) { renderChunk(s, chunkStart); });
+        }
+
+        // mix in stem order, the result does not depend on
+        // the thread scheduling
+        for (unsigned b = 0; b < CHUNK && !done; b += FRAMES) {
+            memset(block, 0, sizeof(block));
+            float stemMax = 0.0;
+            for (size_t s = 0; s < _stems.size(); ++s) {
+                const float* src = _stems[s].buffer.data() + b * 2;
+                for (unsigned i = 0; i < FRAMES * 2; ++i) {
+                    block[i] += src[i];
+                }
+                if (_partWriter) {
+                    for (unsigned i = 0; i < FRAMES * 2; ++i) {
+                        stemMax = qMax(stemMax, qAbs(src[i]));
+                    }
+                    if (!output(s + 1, src)) {
+                        return false;
+                    }
+                }
+            }
+            if (!_partWriter) {
+                _synth->processEffects(FRAMES, block);
+            }
+
+            float max = 0.0;
+            for (unsigned i = 0; i < FRAMES * 2; ++i) {
+                max = qMax(max, qAbs(block[i]));
+            }
+            // stems and mix share the gain, so the stems still add up to the mix
+            peak = qMax(peak, qMax(max, stemMax));
+            if (!output(0, block)) {
+                return false;
+            }
+            const int playTime = chunkStart + b + FRAMES;
+            // create sound until the sound decays, but not beyond the hard limit
+            done = (playTime >= _endTime && max * peak < 0.000001) || playTime > _maxEndTime;
+        }
+        if (_progress && !_progress(float(chunkStart + CHUNK) / _endTime)) {
+            return false;
+        }
+    }
+
+    if (!_normalize) {
+        return true;
+    }
+    if (peak == 0.0) {
+        qDebug("song is empty");
+        return true;
+    }
+    const float gain = 0.99 / peak;
+    for (size_t o = 0; o < outputs; ++o) {
+        tmp[o]->seek(0);
+        while (tmp[o]->read(reinterpret_cast<char*>(block), sizeof(block)) == qint64(sizeof(block))) {
+            for (unsigned i = 0; i < FRAMES * 2; ++i) {
+                block[i] *= gain;
+            }
+            if (!deliver(o, block)) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+}
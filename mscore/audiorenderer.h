@@ -0,0 +1,110 @@
+//=============================================================================
+//  MuseScore
+//  Music Composition & Notation
+//
+//  Copyright (C) 2020 Werner Schweer and others
+//
+//  This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License version 2.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+//=============================================================================
+
+#ifndef __AUDIORENDERER_H__
+#define __AUDIORENDERER_H__
+
+#include <map>
+#include "audio/midi/event.h"
+#include "libmscore/synthesizerstate.h"
+
+namespace Ms {
+class MasterSynthesizer;
+class Score;
+
+//---------------------------------------------------------
+//   AudioRenderer
+//    Renders a score into audio faster than realtime for
+//    the audio exports.
+//
+//    The MIDI channels are split into stems which are
+//    rendered concurrently, one synthesizer per stem. The
+//    synthesizers share the sample data: SF2 samples are
+//    mapped from the file, SF3 samples come from the
+//    SampleDecoder cache and SFZ instruments are shared by
+//    all Zerberus instances; only the preset tables and
+//    voices exist per stem. The stems are rendered dry and
+//    mixed in a fixed order;
+//    the master effects and gain of the given synthesizer
+//    are applied to the mix. With normalization the mix is
+//    kept in a temporary file while rendering, so the score
+//    is synthesized only once.
+//
+//    With a part writer every part of the score becomes a
+//    stem of its own. The master effects are then applied
+//    to each stem, the stems are passed to the part writer
+//    and their sum is the mix.
+//---------------------------------------------------------
+
+class AudioRenderer
+{
+public:
+    static const unsigned FRAMES = 512;           // frames per block passed to the writer
+    // receives FRAMES interleaved stereo frames; returns false to abort
+    typedef std::function<bool (const float*)> Writer;
+    typedef std::function<bool (int part, const float*)> PartWriter;
+
+private:
+    struct Event {
+        int frame;
+        int synti;
+        NPlayEvent event;
+    };
+    struct Stem {
+        MasterSynthesizer* synth { nullptr };
+        bool owned               { false };
+        std::vector<int> channels;
+        std::vector<int> events;                  // indices into _events
+        size_t pos               { 0 };
+        bool notesOff            { false };       // the final note offs were sent
+        std::vector<float> buffer;
+    };
+
+    Score* _score;
+    const EventMap& _eventMap;
+    MasterSynthesizer* _synth;
+    SynthesizerState _state;
+    int _sampleRate;
+    bool _normalize { false };
+    std::function<bool(float)> _progress;
+    PartWriter _partWriter;
+
+    std::vector<Event> _events;
+    std::vector<Stem> _stems;
+    int _endTime    { 0 };
+    int _maxEndTime { 0 };
+
+    void prepare();
+    void assignChannels(const std::map<int, int>& weight);
+    void assignParts();
+    void initStem(Stem&);
+    void renderChunk(Stem&, int start);
+
+public:
+    AudioRenderer(Score*, const EventMap&, MasterSynthesizer*, const SynthesizerState&, int sampleRate);
+    ~AudioRenderer();
+
+    void setNormalize(bool val) { _normalize = val; }
+    void setProgress(std::function<bool(float)> f) { _progress = f; }
+    void setPartWriter(PartWriter w) { _partWriter = w; }
+
+    bool render(Writer write);
+};
+}     // namespace Ms
+#endif
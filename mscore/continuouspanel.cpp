@@ -111,7 +111,6 @@ void ContinuousPanel::paint(const QRect&, QPainter& painter)
 
     const Measure* _currentMeasure = 0;
     for (const Element* e : el) {
-        e->itemDiscovered = 0;
         if (!e->visible() && !_score->showInvisible()) {
             continue;
         }
@@ -151,7 +150,6 @@ void ContinuousPanel::paint(const QRect&, QPainter& painter)
     qreal _xPosTimeSig  = 0;
 
     for (const Element* e : el) {
-        e->itemDiscovered = 0;
         if (!e->visible() && !_score->showInvisible()) {
             continue;
         }
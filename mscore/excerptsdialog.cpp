@@ -162,6 +162,7 @@ void MuseScore::startExcerptsDialog()
     if (cs == 0) {
         return;
     }
+    cs->masterScore()->readDeferredExcerpts();
     ExcerptsDialog ed(cs->masterScore(), 0);
     MuseScore::restoreGeometry(&ed);
     ed.exec();
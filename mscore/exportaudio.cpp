@@ -24,8 +24,10 @@
 #include "libmscore/score.h"
 #include "libmscore/note.h"
 #include "libmscore/part.h"
+#include "libmscore/repeatlist.h"
 #include "libmscore/mscore.h"
 #include "audio/midi/msynthesizer.h"
+#include "audiorenderer.h"
 #include "musescore.h"
 #include "preferences.h"
 
@@ -40,6 +42,25 @@ namespace Ms {
 /// If the callback function is non zero an returns false the export will be canceled.
 ///
 bool MuseScore::saveAudio(Score* score, QIODevice* device, std::function<bool(float)> updateProgress)
+{
+    return saveAudio(score, device, std::vector<QIODevice*>(), updateProgress);
+}
+
+///
+/// \brief Function to synthesize audio of the whole score and of every part in one pass
+/// \param score The score to output
+/// \param device The output device for the whole score
+/// \param parts Output devices for the parts of the score, in score order; may be empty
+/// \param updateProgress An optional callback function that will be notified with the progress in range [0, 1]
+/// \return True on success, false otherwise.
+///
+/// The part outputs add up to the output of the whole score. The master effects
+/// (reverb, chorus and the effects of the mixer) are applied to every part output,
+/// not to their sum, so a part output sounds like the part played solo.
+/// Fails if writing to any of the devices fails.
+///
+bool MuseScore::saveAudio(Score* score, QIODevice* device, const std::vector<QIODevice*>& parts,
+                          std::function<bool(float)> updateProgress)
 {
     if (!device) {
         qDebug() << "Invalid device";
@@ -50,6 +71,20 @@ bool MuseScore::saveAudio(Score* score, QIODevice* device, std::function<bool(fl
         qDebug() << "Could not write to device";
         return false;
     }
+    // closes the devices opened so far
+    auto closeDevices = [device, &parts](size_t openParts) {
+        device->close();
+        for (size_t i = 0; i < openParts; ++i) {
+            parts[i]->close();
+        }
+    };
+    for (size_t i = 0; i < parts.size(); ++i) {
+        if (!parts[i]->open(QIODevice::WriteOnly)) {
+            qDebug() << "Could not write to part device";
+            closeDevices(i);
+            return false;
+        }
+    }
 
     EventMap events;
     // In non-GUI mode current synthesizer settings won't
@@ -59,7 +94,7 @@ bool MuseScore::saveAudio(Score* score, QIODevice* device, std::function<bool(fl
     if (useCurrentSynthesizerState) {
         score->renderMidi(&events, synthesizerState());
         if (events.empty()) {
-            device->close();
+            closeDevices(parts.size());
             return false;
         }
     }
@@ -83,6 +118,8 @@ bool MuseScore::saveAudio(Score* score, QIODevice* device, std::function<bool(fl
         }
 
         if (events.empty()) {
+            delete synth;
+            closeDevices(parts.size());
             return false;
         }
     }
@@ -90,139 +127,49 @@ bool MuseScore::saveAudio(Score* score, QIODevice* device, std::function<bool(fl
     int oldSampleRate  = MScore::sampleRate;
     MScore::sampleRate = sampleRate;
 
-    float peak  = 0.0;
-    double gain = 1.0;
-    EventMap::const_iterator endPos = events.cend();
-    --endPos;
-    const int et = (score->utick2utime(endPos->first) + 1) * MScore::sampleRate;
-    const int maxEndTime = (score->utick2utime(endPos->first) + 3) * MScore::sampleRate;
-
-    bool cancelled = false;
-    int passes = preferences.getBool(PREF_EXPORT_AUDIO_NORMALIZE) ? 2 : 1;
-    for (int pass = 0; pass < passes; ++pass) {
-        EventMap::const_iterator playPos;
-        playPos = events.cbegin();
-        synth->allSoundsOff(-1);
-
-        //
-        // init instruments
-        //
-        for (Part* part : score->parts()) {
-            const InstrumentList* il = part->instruments();
-            for (auto i = il->begin(); i != il->end(); i++) {
-                for (const Channel* instrChan : i->second->channel()) {
-                    const Channel* a = score->masterScore()->playbackChannel(instrChan);
-                    for (MidiCoreEvent e : a->initList()) {
-                        if (e.type() == ME_INVALID) {
-                            continue;
-                        }
-                        e.setChannel(a->channel());
-                        int syntiIdx = synth->index(score->masterScore()->midiMapping(
-                                                        a->channel())->articulation()->synti());
-                        synth->play(e, syntiIdx);
-                    }
-                }
-            }
-        }
-
-        static const unsigned FRAMES = 512;
-        float buffer[FRAMES * 2];
-        int playTime = 0;
-
-        for (;;) {
-            unsigned frames = FRAMES;
-            //
-            // collect events for one segment
-            //
-            float max = 0.0;
-            memset(buffer, 0, sizeof(float) * FRAMES * 2);
-            int endTime = playTime + frames;
-            float* p = buffer;
-            for (; playPos != events.cend(); ++playPos) {
-                int f = score->utick2utime(playPos->first) * MScore::sampleRate;
-                if (f >= endTime) {
-                    break;
-                }
-                int n = f - playTime;
-                if (n) {
-                    synth->process(n, p);
-                    p += 2 * n;
-                }
-
-                playTime  += n;
-                frames    -= n;
-                const NPlayEvent& e = playPos->second;
-                if (e.isChannelEvent()) {
-                    int channelIdx = e.channel();
-                    const Channel* c = score->masterScore()->midiMapping(channelIdx)->articulation();
-                    if (!c->mute()) {
-                        synth->play(e, synth->index(c->synti()));
-                    }
-                }
-            }
-            if (frames) {
-                synth->process(frames, p);
-                playTime += frames;
-            }
-            if (pass == 1) {
-                for (unsigned i = 0; i < FRAMES * 2; ++i) {
-                    max = qMax(max, qAbs(buffer[i]));
-                    buffer[i] *= gain;
-                }
-            } else {
-                for (unsigned i = 0; i < FRAMES * 2; ++i) {
-                    max = qMax(max, qAbs(buffer[i]));
-                    peak = qMax(peak, qAbs(buffer[i]));
-                }
-            }
-            if (pass == (passes - 1)) {
-                device->write(reinterpret_cast<const char*>(buffer), 2 * FRAMES * sizeof(float));
-            }
-            playTime = endTime;
-            if (updateProgress) {
-                // normalize to [0, 1] range
-                if (!updateProgress(float(pass * et + playTime) / passes / et)) {
-                    cancelled = true;
-                    break;
-                }
-            }
-            if (playTime >= et) {
-                synth->allNotesOff(-1);
-            }
-            // create sound until the sound decays
-            if (playTime >= et && max * peak < 0.000001) {
-                break;
-            }
-            // hard limit
-            if (playTime > maxEndTime) {
-                break;
+    AudioRenderer renderer(score, events, synth, state, sampleRate);
+    renderer.setNormalize(preferences.getBool(PREF_EXPORT_AUDIO_NORMALIZE));
+    renderer.setProgress(updateProgress);
+    if (!parts.empty()) {
+        renderer.setPartWriter([&parts](int part, const float* buffer) {
+            const qint64 size = 2 * AudioRenderer::FRAMES * sizeof(float);
+            if (part < int(parts.size()) && parts[part]->write(reinterpret_cast<const char*>(buffer), size) != size) {
+                qDebug() << "Could not write to part device";
+                return false;
             }
-        }
-        if (cancelled) {
-            break;
-        }
-        if (pass == 0 && peak == 0.0) {
-            qDebug("song is empty");
-            break;
-        }
-        gain = 0.99 / peak;
+            return true;
+        });
     }
+    const bool ok = renderer.render([device](const float* buffer) {
+        const qint64 size = 2 * AudioRenderer::FRAMES * sizeof(float);
+        if (device->write(reinterpret_cast<const char*>(buffer), size) != size) {
+            qDebug() << "Could not write to device";
+            return false;
+        }
+        return true;
+    });
 
     MScore::sampleRate = oldSampleRate;
     delete synth;
 
-    device->close();
+    closeDevices(parts.size());
 
-    return !cancelled;
+    return ok;
 }
 
 #ifdef HAS_AUDIOFILE
 
 //---------------------------------------------------------
 //   saveAudio
+//    if parts is set, every part is also written to a file
+//    of its own, named like name with "__part__<n>" added
+//    before the extension. The master effects are applied
+//    to every part file, which then add up to name; see
+//    AudioRenderer. If the export fails or is cancelled
+//    none of the files is kept.
 //---------------------------------------------------------
 
-bool MuseScore::saveAudio(Score* score, const QString& name)
+bool MuseScore::saveAudio(Score* score, const QString& name, bool parts)
 {
     // QIODevice - SoundFile wrapper class
     class SoundFileDevice : public QIODevice
@@ -258,8 +205,11 @@ bool MuseScore::saveAudio(Score* score, const QString& name)
 
         virtual qint64 writeData(const char* dta, qint64 len) override final
         {
-            size_t trueFrames = len / sizeof(float) / 2;
-            sf_writef_float(sf, reinterpret_cast<const float*>(dta), trueFrames);
+            sf_count_t trueFrames = len / sizeof(float) / 2;
+            if (sf_writef_float(sf, reinterpret_cast<const float*>(dta), trueFrames) != trueFrames) {
+                qDebug("write soundfile failed: %s", sf_strerror(sf));
+                return -1;
+            }
             return trueFrames * 2 * sizeof(float);
         }
 
@@ -317,19 +267,25 @@ bool MuseScore::saveAudio(Score* score, const QString& name)
         return false;
     }
 
-    MasterSynthesizer* synth = synthesizerFactory();
-    synth->init();
-    int sampleRate = preferences.getInt(PREF_EXPORT_AUDIO_SAMPLERATE);
-    synth->setSampleRate(sampleRate);
-    bool r = synth->setState(score->synthesizerState());
-    if (!r) {
-        synth->init();
-    }
-
-    int oldSampleRate  = MScore::sampleRate;
-    MScore::sampleRate = sampleRate;
+    // the synthesizers are created by the device variant of
+    // saveAudio(), which loads the sound fonts only once
+    const int sampleRate = preferences.getInt(PREF_EXPORT_AUDIO_SAMPLERATE);
 
     SoundFileDevice device(sampleRate, format, name);
+    std::vector<std::unique_ptr<SoundFileDevice> > partDevices;
+    std::vector<QIODevice*> partOutputs;
+    QStringList partNames;
+    if (parts) {
+        const QString suffix = "." + QFileInfo(name).suffix();
+        const QString base   = name.left(name.size() - suffix.size());
+        const int n          = score->parts().size();
+        const int padding    = QString::number(n).size();
+        for (int i = 0; i < n; ++i) {
+            partNames.append(base + QString("__part__%1").arg(i, padding, 10, QLatin1Char('0')) + suffix);
+            partDevices.emplace_back(new SoundFileDevice(sampleRate, format, partNames.back()));
+            partOutputs.push_back(partDevices.back().get());
+        }
+    }
 
     // dummy callback function that will be used if there is no gui
     std::function<bool(float)> progressCallback = [](float) { return true; };
@@ -363,16 +319,16 @@ bool MuseScore::saveAudio(Score* score, const QString& name)
     progress.setRange(0, 1000);
 
     // Save the audio to the SoundFile device
-    bool result = saveAudio(score, &device, progressCallback);
+    bool result = saveAudio(score, &device, partOutputs, progressCallback);
 
-    bool wasCanceled = progress.wasCanceled();
     progress.close();
 
-    MScore::sampleRate = oldSampleRate;
-    delete synth;
-
-    if (wasCanceled) {
+    // do not leave partly written files behind
+    if (!result) {
         QFile::remove(name);
+        for (const QString& n : partNames) {
+            QFile::remove(n);
+        }
     }
 
     return result;
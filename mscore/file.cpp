@@ -448,6 +448,9 @@ bool MuseScore::saveFile(MasterScore* score)
     if (score == 0) {
         return false;
     }
+    // the autosave may still be copying entries from the score
+    // file; its open handle would make the rename fail on Windows
+    waitForAutosave();
     if (score->created()) {
         QString fileBaseName = score->masterScore()->fileInfo()->completeBaseName();
         QString fileName = score->masterScore()->fileInfo()->fileName();
@@ -520,6 +523,7 @@ bool MuseScore::saveFile(MasterScore* score)
     }
     QString tmp = score->tmpName();
     if (!tmp.isEmpty()) {
+        waitForAutosave();
         QFile f(tmp);
         if (!f.remove()) {
             qDebug("cannot remove temporary file <%s>", qPrintable(f.fileName()));
@@ -602,6 +606,7 @@ MasterScore* MuseScore::getNewFile()
             delete score;
             return 0;
         }
+        tscore->readDeferredExcerpts();        // parts of the template are copied below
         score->setStyle(tscore->style());
 
         // create instruments from template
@@ -1906,6 +1911,7 @@ bool MuseScore::exportParts()
         return false;
     }
 
+    cs->masterScore()->readDeferredExcerpts();
     Score* thisScore = cs->masterScore();
     bool overwrite = false;
     bool noToAll = false;
@@ -2022,9 +2028,12 @@ bool MuseScore::saveAs(Score* cs_, bool saveCopy, const QString& path, const QSt
         }
         try {
             if (ext == "mscz") {
-                cs_->saveCompressedFile(fi, false);
+                rv = cs_->saveCompressedFile(fi, false);
             } else {
-                cs_->saveFile(fi);
+                rv = cs_->saveFile(fi);
+            }
+            if (!rv && !MScore::noGui) {
+                QMessageBox::critical(this, tr("Save As"), MScore::lastError);
             }
         }
         catch (QString s) {
@@ -2045,6 +2054,10 @@ bool MuseScore::saveAs(Score* cs_, bool saveCopy, const QString& path, const QSt
 
         if (rv && !saveCopy) {
             cs_->masterScore()->fileInfo()->setFile(fn);
+            if (cs_->isMaster()) {
+                // later saves copy unchanged images and audio from the new file
+                cs_->masterScore()->setArchive(ext == "mscz" ? fn : QString());
+            }
             updateWindowTitle(cs_);
             cs_->undoStack()->setClean();
             dirtyChanged(cs_);
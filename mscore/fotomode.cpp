@@ -611,7 +611,7 @@ void ScoreView::paintRect(bool printMode, QPainter& p, const QRectF& r, double m
             break;
         }
         p.translate(page->pos());
-        QList<Element*> ell = page->items(r.translated(-page->pos()));
+        std::vector<Element*>& ell = pageItems(page, r.translated(-page->pos()));
         drawElements(p, ell, nullptr);
         p.translate(-page->pos());
     }
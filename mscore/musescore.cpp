@@ -14,6 +14,8 @@
 
 #include <fenv.h>
 #include <QStyleFactory>
+#include <QLocalServer>
+#include <QLocalSocket>
 
 #include "framework/global/modularity/ioc.h"
 #include "framework/ui/iuiengine.h"
@@ -23,6 +25,7 @@
 #include "mu4/scenes/palette/internal/palette/masterpalette.h"
 #include "mu4/cloud/internal/cloudmanager.h"
 #include "mp3exporter.h"
+#include "audiorenderer.h"
 #include "mu3paletteadapter.h"
 #include "mu3inspectoradapter.h"
 
@@ -43,6 +46,8 @@
 #include "libmscore/xml.h"
 #include "seq.h"
 #include "libmscore/tempo.h"
+#include "libmscore/repeatlist.h"
+#include "libmscore/layoutprofiler.h"
 #include "libmscore/sym.h"
 #include "pagesettings.h"
 #include "debugger/debugger.h"
@@ -207,6 +212,7 @@ static bool rawDiffMode = false;
 static bool diffMode = false;
 static bool scriptTestMode = false;
 bool processJob = false;
+static int jobWorkers = 1;
 bool externalIcons = false;
 bool pluginMode = false;
 static bool startWithNewScore = false;
@@ -227,6 +233,7 @@ QString mscoreGlobalShare;
 
 static QString outFileName;
 static QString jsonFileName;
+static QString serverName;
 static QString audioDriver;
 static QString pluginName;
 static QString styleFile;
@@ -405,6 +412,9 @@ void MuseScore::closeEvent(QCloseEvent* ev)
         scoreWasShown.remove(score);
     }
 
+    // a pending autosave must not overwrite the session of the clean exit
+    disconnect(&autosaveWatcher, nullptr, this, nullptr);
+    waitForAutosave();
     writeSessionFile(true);
     for (MasterScore* score : scoreList) {
         if (!score->tmpName().isEmpty()) {
@@ -2053,6 +2063,7 @@ MuseScore::MuseScore()
     autoSaveTimer = new QTimer(this);
     autoSaveTimer->setSingleShot(true);
     connect(autoSaveTimer, SIGNAL(timeout()), this, SLOT(autoSaveTimerTimeout()));
+    connect(&autosaveWatcher, &QFutureWatcher<QStringList>::finished, this, &MuseScore::autoSaveFinished);
     initOsc();
     startAutoSave();
 
@@ -3548,6 +3559,7 @@ void MuseScore::removeTab(int i)
     }
     writeSessionFile(false);
     if (!tmpName.isEmpty()) {
+        waitForAutosave();
         QFile f(tmpName);
         f.remove();
     }
@@ -3889,6 +3901,7 @@ static bool doConvert(Score* cs, const QJsonArray& outFiles, QString plugin)
                 continue;
             }
             // convert parts
+            cs->masterScore()->readDeferredExcerpts();
             QString fnbeg = fns[0].toString();
             QString fnend = fns[1].toString();
             for (Excerpt* e : cs->excerpts()) {
@@ -3917,6 +3930,32 @@ static bool doConvert(Score* cs, const QJsonArray& outFiles, QString plugin)
     return true;
 }
 
+//---------------------------------------------------------
+//   createPartsForExport
+//    read the part scores of the score, or create a part
+//    score for every instrument if it has none; parts are
+//    created in instrument order, which defines the
+//    __excerpt__NN numbering of exported files
+//---------------------------------------------------------
+
+static void createPartsForExport(Score* cs)
+{
+    if (!cs->excerpts().isEmpty()) {
+        cs->masterScore()->readDeferredExcerpts();
+        return;
+    }
+    // one command for all parts, so the master score is laid out only once
+    cs->startCmd();
+    for (Excerpt* e : Excerpt::createAllExcerpt(cs->masterScore())) {
+        Score* nscore = new Score(e->oscore());
+        e->setPartScore(nscore);
+        nscore->style().set(Sid::createMultiMeasureRests, true);
+        cs->undo(new AddExcerpt(e));
+        Excerpt::createExcerpt(e);
+    }
+    cs->endCmd();
+}
+
 static bool doConvert(Score* cs, const QString& fn)
 {
     if (fn.endsWith(".mscx")) {
@@ -3935,19 +3974,7 @@ static bool doConvert(Score* cs, const QString& fn)
         if (!exportScoreParts) {
             return mscore->savePdf(cs, fn);
         }
-        if (cs->excerpts().size() == 0) {
-            auto excerpts = Excerpt::createAllExcerpt(cs->masterScore());
-
-            for (Excerpt* e : excerpts) {
-                Score* nscore = new Score(e->oscore());
-                e->setPartScore(nscore);
-                nscore->style().set(Sid::createMultiMeasureRests, true);
-                cs->startCmd();
-                cs->undo(new AddExcerpt(e));
-                Excerpt::createExcerpt(e);
-                cs->endCmd();
-            }
-        }
+        createPartsForExport(cs);
         QList<Score*> scores;
         scores.append(cs);
         for (Excerpt* e : cs->excerpts()) {
@@ -3958,21 +3985,7 @@ static bool doConvert(Score* cs, const QString& fn)
         if (!exportScoreParts) {
             return mscore->savePng(cs, fn);
         }
-        if (cs->excerpts().size() == 0) {
-            auto excerpts = Excerpt::createAllExcerpt(cs->masterScore());
-
-            for (Excerpt* e: excerpts) {
-                Score* nscore = new Score(e->oscore());
-                e->setPartScore(nscore);
-                nscore->setExcerpt(e);
-                // nscore->setName(e->title()); // needed before AddExcerpt
-                nscore->style().set(Sid::createMultiMeasureRests, true);
-                cs->startCmd();
-                cs->undo(new AddExcerpt(e));
-                Excerpt::createExcerpt(e);
-                cs->endCmd();
-            }
-        }
+        createPartsForExport(cs);
         if (!mscore->savePng(cs, fn)) {
             return false;
         }
@@ -3992,7 +4005,7 @@ static bool doConvert(Score* cs, const QString& fn)
     }
 #ifdef HAS_AUDIOFILE
     else if (fn.endsWith(".wav") || fn.endsWith(".ogg") || fn.endsWith(".flac")) {
-        return mscore->saveAudio(cs, fn);
+        return mscore->saveAudio(cs, fn, exportScoreParts);
     }
 #endif
 #ifdef USE_LAME
@@ -4014,6 +4027,53 @@ static bool doConvert(Score* cs, const QString& fn)
     return false;
 }
 
+//---------------------------------------------------------
+//   saveLayoutProfile
+//    write the layout profile of score and its parts to
+//    <output file base name>.layout.json, next to the first
+//    output file, or next to the input file
+//---------------------------------------------------------
+
+static void saveLayoutProfile(MasterScore* score, const QString& inFile, const QJsonArray& outFiles)
+{
+    QString path = inFile;
+    for (const QJsonValue& outFile : outFiles) {
+        if (outFile.isString()) {
+            path = outFile.toString();
+            break;
+        }
+    }
+    QFileInfo fi(path);
+    QString fn = fi.absolutePath() + "/" + fi.completeBaseName() + ".layout.json";
+
+    QJsonArray scores;
+    auto addScore = [&scores](Score* s, const QString& name) {
+        if (!s->hasLayoutProfiler()) {
+            return;
+        }
+        QJsonObject o = s->layoutProfiler()->toJson();
+        o["name"] = name;
+        scores.append(o);
+    };
+    addScore(score, score->title());
+    for (Excerpt* e : score->excerpts()) {
+        if (e->partScore()) {
+            addScore(e->partScore(), e->title());
+        }
+    }
+    QJsonObject report;
+    report["in"]     = inFile;
+    report["scores"] = scores;
+
+    QFile f(fn);
+    if (!f.open(QIODevice::WriteOnly)) {
+        fprintf(stderr, "cannot write layout profile <%s>\n", qPrintable(fn));
+        return;
+    }
+    f.write(QJsonDocument(report).toJson());
+    fprintf(stderr, "\tlayout profile <%s>\n", qPrintable(fn));
+}
+
 //---------------------------------------------------------
 //   convert
 //---------------------------------------------------------
@@ -4036,6 +4096,9 @@ static bool convert(const QString& inFile, const QJsonArray& outFiles, const QSt
     }
     bool success = doConvert(score, outFiles, plugin);
     fprintf(stderr, success ? "... success!\n" : "... failed!\n");
+    if (MScore::layoutProfiling) {
+        saveLayoutProfile(score, inFile, outFiles);
+    }
     if (plugin.isEmpty()) {
         delete score;
     } else {
@@ -4054,6 +4117,122 @@ static bool convert(const QString& inFile, const QString& outFile)
     }
 }
 
+//---------------------------------------------------------
+//   processJobEntry
+//    convert one entry of a job file and report the result
+//    as a single JSON line on stdout
+//---------------------------------------------------------
+
+static QJsonObject runJobEntry(const QJsonObject& obj)
+{
+    QString inFile;
+    QJsonArray outFiles;
+    QString plugin;
+    bool parts = exportScoreParts;
+    for (const auto& key : obj.keys()) {
+        if (key == "in") {
+            inFile = obj.value(key).toString();
+        } else if (key == "out") {
+            if (obj.value(key).isArray()) {
+                outFiles = obj.value(key).toArray();
+            } else {
+                outFiles.push_back(obj.value(key));
+            }
+        } else if (key == "plugin") {
+            plugin = obj.value(key).toString();
+        } else if (key == "parts") {
+            parts = obj.value(key).toBool();
+        } else {
+            fprintf(stderr, "unknown key <%s>\n", qPrintable(key));
+            QJsonObject result;
+            result["in"]      = inFile;
+            result["success"] = false;
+            result["error"]   = QString("unknown key <%1>").arg(key);
+            return result;
+        }
+    }
+    QElapsedTimer timer;
+    timer.start();
+    const bool oldExportScoreParts = exportScoreParts;
+    exportScoreParts = parts;
+    bool success = convert(inFile, outFiles, plugin);
+    exportScoreParts = oldExportScoreParts;
+
+    QJsonObject result;
+    result["in"]      = inFile;
+    result["success"] = success;
+    result["time"]    = timer.elapsed();
+    return result;
+}
+
+static bool processJobEntry(const QJsonObject& obj)
+{
+    QJsonObject result = runJobEntry(obj);
+    printf("%s\n", QJsonDocument(result).toJson(QJsonDocument::Compact).constData());
+    fflush(stdout);
+    return result["success"].toBool();
+}
+
+//---------------------------------------------------------
+//   processJobInWorkers
+//    Distribute the job entries over several worker
+//    processes. libmscore keeps global state (score fonts,
+//    current score, synthesizer settings), so every worker
+//    is a separate mscore instance converting its share of
+//    the entries with the same command line options.
+//---------------------------------------------------------
+
+static bool processJobInWorkers(const QJsonArray& entries)
+{
+    const int nworkers = qMin(jobWorkers, entries.size());
+
+    // forward all options except the job options themselves
+    QStringList args;
+    const QStringList appArgs = QCoreApplication::arguments();
+    for (int i = 1; i < appArgs.size(); ++i) {
+        const QString& arg = appArgs[i];
+        if (arg == "-j" || arg == "--job" || arg == "--jobs") {
+            ++i;
+            continue;
+        }
+        if (arg.startsWith("--job=") || arg.startsWith("--jobs=")) {
+            continue;
+        }
+        args.append(arg);
+    }
+
+    std::vector<std::unique_ptr<QTemporaryFile> > jobFiles;
+    std::vector<std::unique_ptr<QProcess> > workers;
+    for (int w = 0; w < nworkers; ++w) {
+        QJsonArray share;
+        for (int i = w; i < entries.size(); i += nworkers) {
+            share.append(entries[i]);
+        }
+        jobFiles.emplace_back(new QTemporaryFile(QDir::tempPath() + "/mscore_jobXXXXXX.json"));
+        QTemporaryFile* f = jobFiles.back().get();
+        if (!f->open()) {
+            fprintf(stderr, "cannot create job file for worker %d\n", w);
+            return false;
+        }
+        f->write(QJsonDocument(share).toJson(QJsonDocument::Compact));
+        f->flush();
+
+        // workers write their result lines and diagnostics directly to our stdout/stderr
+        workers.emplace_back(new QProcess);
+        QProcess* p = workers.back().get();
+        p->setProcessChannelMode(QProcess::ForwardedChannels);
+        p->start(QCoreApplication::applicationFilePath(), QStringList(args) << "-j" << f->fileName());
+    }
+
+    bool success = true;
+    for (auto& p : workers) {
+        if (!p->waitForFinished(-1) || p->exitStatus() != QProcess::NormalExit || p->exitCode() != 0) {
+            success = false;
+        }
+    }
+    return success;
+}
+
 //---------------------------------------------------------
 //   doProcessJob
 //---------------------------------------------------------
@@ -4078,34 +4257,103 @@ static bool doProcessJob(QString jsonFile)
     }
     QJsonArray a = doc.array();
     for (const auto i : a) {
-        QString inFile;
-        QJsonArray outFiles;
-        QString plugin;
         if (!i.isObject()) {
             fprintf(stderr, "array value is not an object\n");
             return false;
         }
-        QJsonObject obj = i.toObject();
-        for (const auto& key : obj.keys()) {
-            if (key == "in") {
-                inFile = obj.value(key).toString();
-            } else if (key == "out") {
-                if (obj.value(key).isArray()) {
-                    outFiles = obj.value(key).toArray();
-                } else {
-                    outFiles.push_back(obj.value(key));
-                }
-            } else if (key == "plugin") {
-                plugin = obj.value(key).toString();
-            } else {
-                fprintf(stderr, "unknown key <%s>\n", qPrintable(key));
+    }
+    if (jobWorkers > 1 && a.size() > 1) {
+        return processJobInWorkers(a);
+    }
+    for (const auto i : a) {
+        if (!processJobEntry(i.toObject())) {
+            return false;
+        }
+    }
+    return true;
+}
+
+//---------------------------------------------------------
+//   serveConnection
+//    Every line received is a job entry object (or an array
+//    of them) as in a -j job file; every entry is answered
+//    with one JSON result line. {"command": "quit"} stops
+//    the server.
+//    Returns false if the server should stop.
+//---------------------------------------------------------
+
+static bool serveConnection(QLocalSocket* socket)
+{
+    auto reply = [socket](const QJsonObject& result) {
+                     socket->write(QJsonDocument(result).toJson(QJsonDocument::Compact));
+                     socket->write("\n");
+                     socket->flush();
+                 };
+
+    for (;;) {
+        while (!socket->canReadLine()) {
+            if (socket->state() != QLocalSocket::ConnectedState || !socket->waitForReadyRead(-1)) {
+                return true;
+            }
+        }
+        QByteArray line = socket->readLine().trimmed();
+        if (line.isEmpty()) {
+            continue;
+        }
+        QJsonParseError pe;
+        QJsonDocument doc = QJsonDocument::fromJson(line, &pe);
+        if (pe.error != QJsonParseError::NoError) {
+            reply(QJsonObject { { "success", false }, { "error", pe.errorString() } });
+            continue;
+        }
+        QJsonArray entries;
+        if (doc.isArray()) {
+            entries = doc.array();
+        } else {
+            QJsonObject obj = doc.object();
+            if (obj.value("command").toString() == "quit") {
+                reply(QJsonObject { { "success", true } });
                 return false;
             }
+            entries.append(obj);
         }
-        if (!convert(inFile, outFiles, plugin)) {
-            return false;
+        for (const auto i : entries) {
+            if (!i.isObject()) {
+                reply(QJsonObject { { "success", false }, { "error", "array value is not an object" } });
+                continue;
+            }
+            reply(runJobEntry(i.toObject()));
         }
     }
+}
+
+//---------------------------------------------------------
+//   runConversionServer
+//    keep this instance with its fonts, styles and
+//    templates loaded and convert scores on request
+//---------------------------------------------------------
+
+static bool runConversionServer(const QString& name)
+{
+    QLocalServer server;
+    QLocalServer::removeServer(name);
+    if (!server.listen(name)) {
+        fprintf(stderr, "cannot listen on <%s>: %s\n", qPrintable(name), qPrintable(server.errorString()));
+        return false;
+    }
+    fprintf(stderr, "conversion server listening on <%s>\n", qPrintable(server.fullServerName()));
+
+    bool running = true;
+    while (running && server.waitForNewConnection(-1)) {
+        QLocalSocket* socket = server.nextPendingConnection();
+        if (!socket) {
+            continue;
+        }
+        running = serveConnection(socket);
+        socket->disconnectFromServer();
+        delete socket;
+    }
+    server.close();
     return true;
 }
 
@@ -4156,6 +4404,9 @@ static bool processNonGui(const QStringList& argv)
     }
 
     if (converterMode) {
+        if (!serverName.isEmpty()) {
+            return runConversionServer(serverName);
+        }
         if (processJob) {
             return doProcessJob(jsonFileName);
         } else {
@@ -4267,6 +4518,7 @@ MasterSynthesizer* synthesizerFactory()
     // ms->registerEffect(1, new Freeverb);
     ms->setEffect(0, 1);
     ms->setEffect(1, 0);
+    ms->setDspThreads(preferences.getInt(PREF_IO_SYNTHESIZER_DSPTHREADS));
     return ms;
 }
 
@@ -5549,33 +5801,69 @@ void MuseScore::autoSaveTimerTimeout()
 
     ScoreLoad sl;             //disable debug message "no active command"
 
-    for (MasterScore* s : scoreList) {
-        if (s->autosaveDirty()) {
-            qDebug("<%s>", qPrintable(s->fileInfo()->completeBaseName()));
-            QString tmp = s->tmpName();
-            if (!tmp.isEmpty()) {
-                QFileInfo fi(tmp);
+    // The scores are serialized here, on the GUI thread: the
+    // score model cannot be read from another thread, and a
+    // clone would be made by serializing it as well. Only
+    // compressing and writing the files is done in the
+    // background. Scores still being written stay dirty until
+    // the next time.
+    std::vector<std::pair<QString, ScoreFileEntries> > files;
+    if (!autosaveFuture.isRunning()) {
+        for (MasterScore* s : scoreList) {
+            if (s->autosaveDirty()) {
+                QString tmp = s->tmpName();
+                if (tmp.isEmpty()) {
+                    QDir dir;
+                    dir.mkpath(dataPath);
+                    QTemporaryFile tf(dataPath + "/scXXXXXX.mscz");
+                    tf.setAutoRemove(false);         // do not remove when tf goes out of scope!
+                    if (!tf.open()) {
+                        qDebug("autoSaveTimerTimeout(): create temporary file failed");
+                        break;
+                    }
+                    tmp = tf.fileName();
+                    s->setTmpName(tmp);
+                    sessionChanged = true;
+                }
+                QElapsedTimer timer;
+                timer.start();
+                ScoreFileEntries entries;
                 // TODO: cannot catch exception here:
-                s->saveCompressedFile(fi, false, false);         // no thumbnail
-            } else {
-                QDir dir;
-                dir.mkpath(dataPath);
-                QTemporaryFile tf(dataPath + "/scXXXXXX.mscz");
-                tf.setAutoRemove(false);         // do not remove when tf goes out of scope!
-                if (!tf.open()) {
-                    qDebug("autoSaveTimerTimeout(): create temporary file failed");
-                    return;
+                if (s->compressedFileEntries(entries, QFileInfo(tmp), false, false)) {       // no thumbnail
+                    files.emplace_back(tmp, std::move(entries));
+                    s->setAutosaveDirty(false);
+                } else {
+                    qDebug("autoSaveTimerTimeout(): cannot serialize <%s>", qPrintable(tmp));
                 }
-                s->setTmpName(tf.fileName());
-                QFileInfo info(tf.fileName());
-                s->saveCompressedFile(&tf, info, false, false);          // no thumbnail
-                tf.close();
-                sessionChanged = true;
+                qDebug("<%s> serialized in %lld ms", qPrintable(s->fileInfo()->completeBaseName()), timer.elapsed());
             }
-            s->setAutosaveDirty(false);
         }
     }
-    if (sessionChanged) {
+    if (!files.empty()) {
+        autosaveSessionChanged = sessionChanged;
+        autosaveFuture = QtConcurrent::run([files]() {
+            QStringList failed;
+            for (const auto& f : files) {
+                // replace the previous file only if the new one
+                // was written completely
+                QBuffer buffer;
+                buffer.open(QIODevice::WriteOnly);
+                if (!Score::writeCompressedFile(&buffer, f.second)) {
+                    qDebug("autoSaveTimerTimeout(): cannot compress <%s>", qPrintable(f.first));
+                    failed.append(f.first);
+                    continue;
+                }
+                QSaveFile file(f.first);
+                if (!file.open(QIODevice::WriteOnly) || file.write(buffer.data()) != buffer.data().size()
+                    || !file.commit()) {
+                    qDebug("autoSaveTimerTimeout(): cannot write <%s>", qPrintable(f.first));
+                    failed.append(f.first);
+                }
+            }
+            return failed;
+        });
+        autosaveWatcher.setFuture(autosaveFuture);
+    } else if (sessionChanged) {
         writeSessionFile(false);
     }
     if (preferences.getBool(PREF_APP_AUTOSAVE_USEAUTOSAVE)) {
@@ -5584,6 +5872,27 @@ void MuseScore::autoSaveTimerTimeout()
     }
 }
 
+//---------------------------------------------------------
+//   autoSaveFinished
+//    the autosave files are written; scores whose file
+//    could not be written are saved again next time, and
+//    new files are listed in the session
+//---------------------------------------------------------
+
+void MuseScore::autoSaveFinished()
+{
+    const QStringList failed = autosaveFuture.result();
+    for (MasterScore* s : scoreList) {
+        if (failed.contains(s->tmpName())) {
+            s->setAutosaveDirty(true);
+        }
+    }
+    if (autosaveSessionChanged) {
+        autosaveSessionChanged = false;
+        writeSessionFile(false);
+    }
+}
+
 class CallOnReturn
 {
     std::function<void()> f;
@@ -7575,176 +7884,49 @@ bool MuseScore::saveMp3(Score* score, QIODevice* device, bool& wasCanceled, int
         progress.show();
     }
 
-    static const int FRAMES = 512;
+    static const int FRAMES = AudioRenderer::FRAMES;
     float bufferL[FRAMES];
     float bufferR[FRAMES];
+    progress.setRange(0, 1000);
 
-    float peak = 0.0;
-    double gain = 1.0;
-    EventMap::const_iterator endPos = events.cend();
-    --endPos;
-    const int et = (score->utick2utime(endPos->first) + 1) * MScore::sampleRate;
-    const int maxEndTime = (score->utick2utime(endPos->first) + 3) * MScore::sampleRate;
-    progress.setRange(0, et);
-
-    for (int pass = 0; pass < 2; ++pass) {
-        EventMap::const_iterator playPos;
-        playPos = events.cbegin();
-        synth->allSoundsOff(-1);
-
-        //
-        // init instruments
-        //
-        for (Part* part : score->parts()) {
-            const InstrumentList* il = part->instruments();
-            for (auto i = il->begin(); i != il->end(); i++) {
-                for (const Channel* channel : i->second->channel()) {
-                    const Channel* a = score->masterScore()->playbackChannel(channel);
-                    for (MidiCoreEvent e : a->initList()) {
-                        if (e.type() == ME_INVALID) {
-                            continue;
-                        }
-                        e.setChannel(a->channel());
-                        int syntiIdx= synth->index(score->masterScore()->midiMapping(
-                                                       a->channel())->articulation()->synti());
-                        synth->play(e, syntiIdx);
-                    }
-                }
-            }
-        }
-
-        int playTime = 0.0;
-
-        for (;;) {
-            unsigned frames = FRAMES;
-            float max = 0;
-            //
-            // collect events for one segment
-            //
-            memset(bufferL, 0, sizeof(float) * FRAMES);
-            memset(bufferR, 0, sizeof(float) * FRAMES);
-            double endTime = playTime + frames;
-
-            float* l = bufferL;
-            float* r = bufferR;
-
-            for (; playPos != events.cend(); ++playPos) {
-                double f = score->utick2utime(playPos->first) * MScore::sampleRate;
-                if (f >= endTime) {
-                    break;
-                }
-                int n = f - playTime;
-                if (n) {
-#if (!defined (_MSCVER) && !defined (_MSC_VER))
-                    float bu[n * 2];
-                    memset(bu, 0, sizeof(float) * 2 * n);
-#else
-                    // MSVC does not support VLA. Replace with std::vector. If profiling determines that the
-                    //    heap allocation is slow, an optimization might be used.
-                    std::vector<float> vBu(n * 2, 0);             // Default initialized, memset() not required.
-                    float* bu = vBu.data();
-#endif
-
-                    synth->process(n, bu);
-                    float* sp = bu;
-                    for (int i = 0; i < n; ++i) {
-                        *l++ = *sp++;
-                        *r++ = *sp++;
-                    }
-                    playTime  += n;
-                    frames    -= n;
-                }
-                const NPlayEvent& e = playPos->second;
-                if (e.isChannelEvent()) {
-                    int channelIdx = e.channel();
-                    Channel* c = score->masterScore()->midiMapping(channelIdx)->articulation();
-                    if (!c->mute()) {
-                        synth->play(e, synth->index(c->synti()));
-                    }
-                }
-            }
-            if (frames) {
-#if (!defined (_MSCVER) && !defined (_MSC_VER))
-                float bu[frames * 2];
-                memset(bu, 0, sizeof(float) * 2 * frames);
-#else
-                // MSVC does not support VLA. Replace with std::vector. If profiling determines that the
-                //    heap allocation is slow, an optimization might be used.
-                std::vector<float> vBu(frames * 2, 0);           // Default initialized, memset() not required.
-                float* bu = vBu.data();
-#endif
-                synth->process(frames, bu);
-                float* sp = bu;
-                for (unsigned i = 0; i < frames; ++i) {
-                    *l++ = *sp++;
-                    *r++ = *sp++;
-                }
-                playTime += frames;
-            }
-
-            if (pass == 1) {
-                for (int i = 0; i < FRAMES; ++i) {
-                    max = qMax(max, qAbs(bufferL[i]));
-                    max = qMax(max, qAbs(bufferR[i]));
-                    bufferL[i] *= gain;
-                    bufferR[i] *= gain;
-                }
-                long bytes;
-                if (FRAMES < inSamples) {
-                    bytes = exporter.encodeRemainder(bufferL, bufferR,  FRAMES, bufferOut);
-                } else {
-                    bytes = exporter.encodeBuffer(bufferL, bufferR, bufferOut);
-                }
-                if (bytes < 0) {
-                    if (MScore::noGui) {
-                        qDebug("exportmp3: error from encoder: %ld", bytes);
-                    } else {
-                        QMessageBox::warning(0,
-                                             tr("Encoding Error"),
-                                             tr("Error %1 returned from MP3 encoder").arg(bytes),
-                                             QString(), QString());
-                    }
-                    break;
-                } else {
-                    device->write((char*)bufferOut, bytes);
-                }
-            } else {
-                for (int i = 0; i < FRAMES; ++i) {
-                    max = qMax(max, qAbs(bufferL[i]));
-                    max = qMax(max, qAbs(bufferR[i]));
-                    peak = qMax(peak, qAbs(bufferL[i]));
-                    peak = qMax(peak, qAbs(bufferR[i]));
-                }
-            }
-            playTime = endTime;
-            if (!MScore::noGui) {
-                if (progress.wasCanceled()) {
-                    break;
-                }
-                progress.setValue((pass * et + playTime) / 2);
-                qApp->processEvents();
-            }
-            if (playTime >= et) {
-                synth->allNotesOff(-1);
-            }
-            // create sound until the sound decays
-            if (playTime >= et && max * peak < 0.000001) {
-                break;
-            }
-            // hard limit
-            if (playTime > maxEndTime) {
-                break;
-            }
+    AudioRenderer renderer(score, events, synth, state, sampleRate);
+    renderer.setNormalize(true);
+    renderer.setProgress([&progress](float v) -> bool {
+        if (MScore::noGui) {
+            return true;
         }
         if (progress.wasCanceled()) {
-            break;
+            return false;
         }
-        if (pass == 0 && peak == 0.0) {
-            qDebug("song is empty");
-            break;
+        progress.setValue(v * 1000);
+        qApp->processEvents();
+        return true;
+    });
+    renderer.render([&](const float* buffer) -> bool {
+        for (int i = 0; i < FRAMES; ++i) {
+            bufferL[i] = buffer[2 * i];
+            bufferR[i] = buffer[2 * i + 1];
+        }
+        long bytes;
+        if (FRAMES < inSamples) {
+            bytes = exporter.encodeRemainder(bufferL, bufferR,  FRAMES, bufferOut);
+        } else {
+            bytes = exporter.encodeBuffer(bufferL, bufferR, bufferOut);
         }
-        gain = 0.99 / peak;
-    }
+        if (bytes < 0) {
+            if (MScore::noGui) {
+                qDebug("exportmp3: error from encoder: %ld", bytes);
+            } else {
+                QMessageBox::warning(0,
+                                     tr("Encoding Error"),
+                                     tr("Error %1 returned from MP3 encoder").arg(bytes),
+                                     QString(), QString());
+            }
+            return false;
+        }
+        device->write((char*)bufferOut, bytes);
+        return true;
+    });
 
     long bytes = exporter.finishStream(bufferOut);
     if (bytes > 0L) {
@@ -8001,6 +8183,10 @@ MuseScoreApplication::CommandLineParseResult MuseScoreApplication::parseCommandL
                                         "Revert to factory settings, but keep default preferences"));
     parser.addOption(QCommandLineOption({ "i", "load-icons" }, "Load icons from INSTALLPATH/icons"));
     parser.addOption(QCommandLineOption({ "j", "job" }, "Process a conversion job", "file"));
+    parser.addOption(QCommandLineOption("jobs", "Use with '-j', number of conversion job entries processed in parallel", "N"));
+    parser.addOption(QCommandLineOption("server",
+                                        "Run as conversion server accepting job entries as JSON lines on a local socket",
+                                        "socket"));
     parser.addOption(QCommandLineOption({ "e", "experimental" }, "Enable experimental features"));
     parser.addOption(QCommandLineOption({ "c", "config-folder" }, "Override configuration and settings folder", "dir"));
     parser.addOption(QCommandLineOption({ "t", "test-mode" }, "Set test mode flag for all files")); // this includes --template-mode
@@ -8008,7 +8194,7 @@ MuseScoreApplication::CommandLineParseResult MuseScoreApplication::parseCommandL
     parser.addOption(QCommandLineOption({ "M", "midi-operations" }, "Specify MIDI import operations file", "file"));
     parser.addOption(QCommandLineOption({ "w", "no-webview" }, "No web view in start center"));
     parser.addOption(QCommandLineOption({ "P", "export-score-parts" },
-                                        "Use with '-o <file>.pdf', export score and parts"));
+                                        "Use with '-o <file>.pdf', export score and parts; with '-o <file>.wav/.ogg/.flac', also export every part as an audio stem, with the master effects applied to each stem"));
     parser.addOption(QCommandLineOption("no-fallback-font", "Don't use Bravura as fallback musical font"));
     parser.addOption(QCommandLineOption({ "f", "force" },
                                         "Use with '-o <file>', ignore warnings reg. score being corrupted or from wrong version"));
@@ -8029,6 +8215,9 @@ MuseScoreApplication::CommandLineParseResult MuseScoreApplication::parseCommandL
                                         "options"));
     parser.addOption(QCommandLineOption("raw-diff", "Print a raw diff for the given scores"));
     parser.addOption(QCommandLineOption("diff", "Print a diff for the given scores"));
+    parser.addOption(QCommandLineOption("parallel-layout", "Lay out the staves of a system on several threads"));
+    parser.addOption(QCommandLineOption("layout-profile",
+                                        "Time the layout phases; in converter mode write a JSON report next to the output file"));
 
     parser.addPositionalArgument("scorefiles", "The files to open", "[scorefile...]");
 
@@ -8055,6 +8244,10 @@ MuseScoreApplication::CommandLineParseResult MuseScoreApplication::parseCommandL
     midiInputTrace = parser.isSet("I");
     midiOutputTrace = parser.isSet("O");
     MScore::useFallbackFont = !parser.isSet("no-fallback-font");
+    MScore::parallelLayout = parser.isSet("parallel-layout");
+    if (parser.isSet("layout-profile")) {
+        MScore::layoutProfiling = true;           // can also be enabled by MSCORE_LAYOUT_PROFILE
+    }
 
     if ((converterMode = parser.isSet("o"))) {
         MScore::noGui = true;
@@ -8071,6 +8264,23 @@ MuseScoreApplication::CommandLineParseResult MuseScoreApplication::parseCommandL
             fprintf(stderr, "json file name missing\n");
             parser.showHelp(EXIT_FAILURE);
         }
+        if (parser.isSet("jobs")) {
+            bool ok = false;
+            jobWorkers = parser.value("jobs").toInt(&ok);
+            if (!ok || jobWorkers < 1) {
+                fprintf(stderr, "invalid number of jobs <%s>\n", qPrintable(parser.value("jobs")));
+                parser.showHelp(EXIT_FAILURE);
+            }
+        }
+    }
+    if (parser.isSet("server")) {
+        MScore::noGui = true;
+        converterMode = true;
+        serverName = parser.value("server");
+        if (serverName.isEmpty()) {
+            fprintf(stderr, "server socket name missing\n");
+            parser.showHelp(EXIT_FAILURE);
+        }
     }
     if ((pluginMode = parser.isSet("p"))) {
         MScore::noGui = true;
@@ -8505,6 +8715,7 @@ void MuseScore::init(QStringList& argv)
             synti->setSampleRate(MScore::sampleRate);
             synti->init();
         }
+        synti->setRealtime(true);
         seq->setMasterSynthesizer(synti);
     } else {
         seq         = 0;
@@ -8755,6 +8966,7 @@ bool MuseScore::exportPartsPdfsToJSON(const QString& inFilePath, const QString&
 
     //save extended score+parts and separate parts pdfs
     //if no parts, generate parts from existing instruments
+    score->readDeferredExcerpts();
     if (score->excerpts().size() == 0) {
         auto excerpts = Excerpt::createAllExcerpt(score);
         for (Excerpt* e : excerpts) {
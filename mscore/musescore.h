@@ -327,6 +327,9 @@ class MuseScore : public QMainWindow, public MuseScoreCore, public mu::framework
 #endif
 
     QTimer* autoSaveTimer;
+    QFuture<QStringList> autosaveFuture;            // writes the autosave files, returns the failed ones
+    QFutureWatcher<QStringList> autosaveWatcher;    // calls autoSaveFinished()
+    bool autosaveSessionChanged        { false };   // the running autosave writes new files
     QList<QAction*> pluginActions;
 
     PianorollEditor* pianorollEditor   { 0 };
@@ -485,6 +488,7 @@ signals:
 private slots:
     void cmd(QAction* a, const QString& cmd);
     void autoSaveTimerTimeout();
+    void autoSaveFinished();
     void helpBrowser1() const;
     void resetAndRestart();
     void about();
@@ -639,6 +643,7 @@ public:
 #endif
     MsQmlEngine* getQmlUiEngine();
     void writeSessionFile(bool);
+    void waitForAutosave() { autosaveFuture.waitForFinished(); }
     bool restoreSession(bool);
     bool splitScreen() const { return _splitScreen; }
     void setSplitScreen(bool val);
@@ -727,7 +732,8 @@ public:
     void addImage(Score*, Element*);
 
     bool saveAudio(Score*, QIODevice*, std::function<bool(float)> updateProgress = nullptr);
-    bool saveAudio(Score*, const QString& name);
+    bool saveAudio(Score*, QIODevice*, const std::vector<QIODevice*>& parts, std::function<bool(float)> updateProgress);
+    bool saveAudio(Score*, const QString& name, bool parts = false);
     bool canSaveMp3();
     bool saveMp3(Score*, const QString& name, int preferedMp3Bitrate = -1);
     bool saveMp3(Score*, QIODevice*, bool& wasCanceled, int preferedMp3Bitrate = -1);
@@ -22,6 +22,7 @@ namespace PluginAPI {
 
 Score* Excerpt::partScore()
 {
+    e->oscore()->readDeferredExcerpts();
     return wrap<Score>(e->partScore(), Ownership::SCORE);
 }
 
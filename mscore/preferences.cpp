@@ -197,6 +197,7 @@ void Preferences::init(bool storeInMemoryOnly)
             { PREF_IO_PORTMIDI_OUTPUTDEVICE,                        new StringPreference("") },
             { PREF_IO_PORTMIDI_OUTPUTLATENCYMILLISECONDS,           new IntPreference(0) },
             { PREF_IO_PULSEAUDIO_USEPULSEAUDIO,                     new BoolPreference(defaultUsePulseAudio, false) },
+            { PREF_IO_SYNTHESIZER_DSPTHREADS,                       new IntPreference(1, false) },
             { PREF_SCORE_CHORD_PLAYONADDNOTE,                       new BoolPreference(true, false) },
             { PREF_SCORE_HARMONY_PLAY_ONEDIT,                       new BoolPreference(true, false) },
             { PREF_SCORE_MAGNIFICATION,                             new DoublePreference(1.0, false) },
@@ -419,6 +419,8 @@ void ScoreTab::setExcerpt(int n)
     ScoreView* v;
     Score* score = tsv->score;
     if (n) {
+        // opening a part tab reads all deferred part scores
+        tsv->score->readDeferredExcerpts();
         QList<Excerpt*>& excerpts = score->excerpts();
         if (!excerpts.isEmpty()) {
             score = excerpts.at(n - 1)->partScore();
@@ -509,7 +511,13 @@ bool ScoreTab::setCurrentScore(Score* s)
     if (idx == -1) {
         return false;
     }
-    const int exIdx = (ms == s) ? 0 : ms->scoreList().indexOf(s);
+    int exIdx = (ms == s) ? 0 : -1;
+    const QList<Excerpt*>& excerpts = ms->excerpts();
+    for (int i = 0; exIdx == -1 && i < excerpts.size(); ++i) {
+        if (excerpts[i]->partScore() == s) {
+            exIdx = i + 1;
+        }
+    }
     if (exIdx == -1) {
         return false;
     }
@@ -1229,16 +1229,27 @@ static void drawDebugInfo(QPainter& p, const Element* _e)
 
 #endif
 
+//---------------------------------------------------------
+//   pageItems
+//    elements of page intersecting r (page coordinates);
+//    the returned list is reused by the next call
+//---------------------------------------------------------
+
+std::vector<Element*>& ScoreView::pageItems(Page* page, const QRectF& r)
+{
+    _pageItems.clear();
+    page->visitItems(r, [this](Element* e) { _pageItems.push_back(e); });
+    return _pageItems;
+}
+
 //---------------------------------------------------------
 //   drawElements
 //---------------------------------------------------------
 
-void ScoreView::drawElements(QPainter& painter, QList<Element*>& el, Element* editElement)
+void ScoreView::drawElements(QPainter& painter, std::vector<Element*>& el, Element* editElement)
 {
     std::stable_sort(el.begin(), el.end(), elementLessThan);
     for (const Element* e : el) {
-        e->itemDiscovered = 0;
-
         // harmony element representation is different in edit mode, so don't
         // all normal draw(). Complete drawing is done in drawEditMode()
         if (e == editElement) {
@@ -1339,7 +1350,7 @@ void ScoreView::paint(const QRect& r, QPainter& p)
     if ((_score->layoutMode() == LayoutMode::LINE) || (_score->layoutMode() == LayoutMode::SYSTEM)) {
         if (_score->pages().size() > 0) {
             Page* page = _score->pages().front();
-            QList<Element*> ell = page->items(fr);
+            std::vector<Element*>& ell = pageItems(page, fr);
 
             // AvsOmr -----
 #ifdef AVSOMR
@@ -1365,7 +1376,7 @@ void ScoreView::paint(const QRect& r, QPainter& p)
             if (!score()->printing()) {
                 paintPageBorder(p, page);
             }
-            QList<Element*> ell = page->items(fr.translated(-page->pos()));
+            std::vector<Element*>& ell = pageItems(page, fr.translated(-page->pos()));
             QPointF pos(page->pos());
             p.translate(pos);
 
@@ -3063,7 +3074,7 @@ void ScoreView::startNoteEntry()
             QRectF pageRect  = p->bbox().translated(p->x(), p->y());
             QRectF intersect = viewRect & pageRect;
             intersect.translate(-p->x(), -p->y());
-            QList<Element*> el = p->items(intersect);
+            const std::vector<Element*>& el = pageItems(p, intersect);
             ChordRest* lastSelected = score()->selection().currentCR();
             if (lastSelected && lastSelected->voice()) {
                 // if last selected CR was not in voice 1,
@@ -5198,7 +5209,7 @@ QList<Element*> ScoreView::elementsNear(QPointF p)
     double w = (preferences.getInt(PREF_UI_CANVAS_MISC_SELECTIONPROXIMITY) * .5) / matrix().m11();
     QRectF r(p.x() - w, p.y() - w, 3.0 * w, 3.0 * w);
 
-    QList<Element*> el = page->items(r);
+    std::vector<Element*>& el = pageItems(page, r);
     for (int i = 0; i < MAX_HEADERS; i++) {
         if (score()->headerText(i) != nullptr) {        // gives the ability to select the header
             el.push_back(score()->headerText(i));
@@ -5210,7 +5221,6 @@ QList<Element*> ScoreView::elementsNear(QPointF p)
         }
     }
     for (Element* e : el) {
-        e->itemDiscovered = 0;
         if (!e->selectable() || e->isPage()) {
             continue;
         }
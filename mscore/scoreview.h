@@ -159,6 +159,7 @@ class ScoreView : public QWidget, public MuseScoreView
 
     EditData editData;
     std::vector<std::unique_ptr<ElementGroup> > dragGroups;
+    std::vector<Element*> _pageItems;         ///< reused by pageItems()
 
     //--input state:
     PositionCursor* _cursor;
@@ -245,7 +246,8 @@ class ScoreView : public QWidget, public MuseScoreView
     void constraintCanvas(int* dxx, int* dyy);
 
     void setShadowNote(const QPointF&);
-    void drawElements(QPainter& p,QList<Element*>& el, Element* editElement);
+    std::vector<Element*>& pageItems(Page* page, const QRectF& r);
+    void drawElements(QPainter& p, std::vector<Element*>& el, Element* editElement);
     bool dragTimeAnchorElement(const QPointF& pos);
     bool dragMeasureAnchorElement(const QPointF& pos);
     virtual void lyricsTab(bool back, bool end, bool moveOnly) override;
@@ -22,6 +22,7 @@
 
 #include "libmscore/clef.h"
 #include "libmscore/element.h"
+#include "libmscore/excerpt.h"
 #include "libmscore/icon.h"
 #include "libmscore/keysig.h"
 #include "libmscore/property.h"
@@ -442,8 +443,13 @@ std::unique_ptr<ScriptEntry> ExcerptChangeScriptEntry::fromContext(const ScriptC
     const Score* s = ctx.mscore()->currentScore();
     int index = 0;
     if (!s->isMaster()) {
-        const auto& scores = s->masterScore()->scoreList();
-        index = std::find(scores.begin(), scores.end(), s) - scores.begin();
+        const auto& excerpts = s->masterScore()->excerpts();
+        for (int i = 0; i < excerpts.size(); ++i) {
+            if (excerpts[i]->partScore() == s) {
+                index = i + 1;
+                break;
+            }
+        }
     }
     return std::unique_ptr<ScriptEntry>(new ExcerptChangeScriptEntry(index));
 }
@@ -17,6 +17,12 @@
 //  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
 //=============================================================================
 
+#include <algorithm>
+#include <climits>
+#include <iterator>
+#include <set>
+#include <tuple>
+
 #include "config.h"
 #include "seq.h"
 #include "musescore.h"
@@ -159,7 +165,14 @@ Seq::Seq()
     state    = Transport::STOP;
     oggInit  = false;
     _driver  = 0;
-    playPos  = events.cbegin();
+    playlist = new Playlist;
+    publishedPlaylist = playlist;
+    rtPlaylist = playlist;
+    rtEpoch  = 0;
+    playPos  = rtPlaylist->events.cbegin();
+    guiPos   = playlist->events.cbegin();
+    playUTick   = INT_MAX;
+    playedUTick = 0;
     playFrame  = 0;
     metronomeVolume = 0.3;
     useJackTransportSavedFlag = false;
@@ -200,6 +213,8 @@ Seq::Seq()
 Seq::~Seq()
 {
     delete _driver;
+    qDeleteAll(retiredPlaylists);
+    delete playlist;
 }
 
 //---------------------------------------------------------
@@ -333,7 +348,7 @@ bool Seq::canStart()
         return false;
     }
     collectEvents(getPlayStartUtick());
-    return !events.empty() && endUTick != 0;
+    return !playlist->events.empty() && endUTick != 0;
 }
 
 //---------------------------------------------------------
@@ -617,12 +632,19 @@ void Seq::processMessages()
         switch (msg.id) {
         case SeqMsgId::TEMPO_CHANGE:
         {
-            if (!cs) {
+            // the time index for the new tempo was built by the gui
+            // thread (setRelTempo()); only publish it here, the old one
+            // is retired and deleted by the gui thread once unused
+            TimeIndex* index = msg.timeIndex;
+            if (!cs || index->score() != cs) {
+                // never published, nobody can be using it
+                fromSeq.enqueue(SeqMsg(SeqMsgId::FREE_TIME_INDEX, index));
                 continue;
             }
             if (playFrame != 0) {
                 int utick = cs->utime2utick(qreal(playFrame) / qreal(MScore::sampleRate));
-                cs->tempomap()->setRelTempo(msg.realVal);
+                cs->tempomap()->setRelTempo(index->relTempo());
+                cs->publishRepeatListTimeIndex(index);
                 playFrame = cs->utick2utime(utick) * MScore::sampleRate;
                 if (cachedPrefs.jackTimeBaseMaster && cachedPrefs.useJackTransport) {
                     _driver->seekTransport(utick + 2
@@ -630,9 +652,10 @@ void Seq::processMessages()
                                                              / qreal(MScore::sampleRate)));
                 }
             } else {
-                cs->tempomap()->setRelTempo(msg.realVal);
+                cs->tempomap()->setRelTempo(index->relTempo());
+                cs->publishRepeatListTimeIndex(index);
             }
-            cs->masterScore()->updateRepeatListTempo();
+            fromSeq.enqueue(SeqMsg(SeqMsgId::FREE_TIME_INDEX, nullptr));
             prevTempo = curTempo();
             emit tempoChanged();
         }
@@ -736,6 +759,8 @@ void Seq::addCountInClicks()
 
 void Seq::process(unsigned framesPerPeriod, float* buffer)
 {
+    adoptPlaylist();
+
     unsigned framesRemain = framesPerPeriod;   // the number of frames remaining to be processed by this call to Seq::process
     Transport driverState = _driver->getState();
     // Checking for the reposition from JACK Transport
@@ -787,9 +812,9 @@ void Seq::process(unsigned framesPerPeriod, float* buffer)
             // Muting all notes
             stopNotes(-1, true);
             initInstruments(true);
-            if (playPos == eventsEnd) {
+            if (playPos == rtPlaylist->events.cend()) {
                 if (mscore->loop()) {
-                    qDebug("Seq.cpp - Process - Loop whole score. playPos = %d, cs->pos() = %d", playPos->first,
+                    qDebug("Seq.cpp - Process - Loop whole score. endUTick = %d, cs->pos() = %d", endUTick,
                            cs->pos().ticks());
                     emit toGui('4');
                     return;
@@ -817,7 +842,7 @@ void Seq::process(unsigned framesPerPeriod, float* buffer)
 
         // if currently in count-in, these pointers will reference data in the count-in
         EventMap::const_iterator* pPlayPos   = &playPos;
-        EventMap::const_iterator pEventsEnd = eventsEnd;
+        EventMap::const_iterator pEventsEnd = rtPlaylist->events.cend();
         int* pPlayFrame = &playFrame;
         if (inCountIn) {
             if (countInEvents.size() == 0) {
@@ -927,10 +952,9 @@ void Seq::process(unsigned framesPerPeriod, float* buffer)
                 tackRemain = tackLength;
                 tackVolume = event.velo() ? qreal(event.value()) / 127.0 : 1.0;
             }
-            mutex.lock();
             ++(*pPlayPos);
-            mutex.unlock();
         }
+        updatePlayUTick();
         if (framesRemain) {
             if (cs->playMode() == PlayMode::SYNTHESIZER) {
                 metronome(framesRemain, p, inCountIn);
@@ -1081,14 +1105,410 @@ void Seq::renderChunk(const MidiRenderer::Chunk& ch, EventMap* eventMap)
 }
 
 //---------------------------------------------------------
-//   updateEventsEnd
+//   setPlaylistChanged
+//    called when the score changed the playlist; if only
+//    some measures changed, only their chunks are rendered
+//    again
 //---------------------------------------------------------
 
-void Seq::updateEventsEnd()
+void Seq::setPlaylistChanged()
 {
-    auto end = events.cend();
-    eventsEnd = end;
-    endUTick = events.empty() ? 0 : (--end)->first;
+    const Fraction tick1 = cs->playlistTick1();
+    if (tick1 < Fraction(0, 1)) {
+        playlistChanged = true;
+        return;
+    }
+    const int tick2 = cs->playlistTick2().ticks();
+    if (changedTick1 < 0) {
+        changedTick1 = tick1.ticks();
+        changedTick2 = tick2;
+    } else {
+        changedTick1 = qMin(changedTick1, tick1.ticks());
+        changedTick2 = qMax(changedTick2, tick2);
+    }
+}
+
+//---------------------------------------------------------
+//   takeRenderEvents
+//    add the chunk rendered in background to the rendered
+//    chunks; returns true if there was one
+//---------------------------------------------------------
+
+bool Seq::takeRenderEvents()
+{
+    if (renderEventsRange.first >= renderEventsRange.second) {
+        return false;
+    }
+    renderedChunks[renderEventsRange.first] = { renderEventsRange.second, std::move(renderEvents) };
+    renderEvents.clear();
+    renderEventsRange = { 0, 0 };
+    return true;
+}
+
+//---------------------------------------------------------
+//   keepNoteOffs
+//    notes of a replaced chunk may be sounding at the play
+//    position utick; keep their note off events unless the
+//    new events of the chunk stop them at the same time
+//---------------------------------------------------------
+
+static void keepNoteOffs(const EventMap& old, EventMap& events, int utick)
+{
+    if (utick == INT_MAX) {
+        return;
+    }
+    // the audio thread may be ahead of the gui by some frames
+    const int started = utick + MScore::division;
+    typedef std::tuple<const Note*, int, int> NoteKey;    // note, channel, pitch
+    std::multiset<NoteKey> sounding;
+    std::vector<EventMap::value_type> noteOffs;
+    for (const auto& e : old) {
+        const NPlayEvent& ev = e.second;
+        if (ev.type() != ME_NOTEON) {
+            continue;
+        }
+        const NoteKey key(ev.note(), ev.channel(), ev.pitch());
+        if (ev.velo()) {
+            if (e.first < started) {
+                sounding.insert(key);
+            }
+            continue;
+        }
+        auto i = sounding.find(key);
+        if (i == sounding.end()) {
+            continue;
+        }
+        sounding.erase(i);
+        if (e.first >= utick) {
+            noteOffs.push_back(e);
+        }
+    }
+    for (const auto& off : noteOffs) {
+        bool found = false;
+        for (auto i = events.lower_bound(off.first); i != events.cend() && i->first == off.first; ++i) {
+            const NPlayEvent& ev = i->second;
+            if (ev.type() == ME_NOTEON && !ev.velo() && ev.channel() == off.second.channel()
+                && ev.pitch() == off.second.pitch()) {
+                found = true;
+                break;
+            }
+        }
+        if (!found) {
+            events.insert(off);
+        }
+    }
+}
+
+//---------------------------------------------------------
+//   renderChanges
+//    render the rendered chunks containing edited measures
+//    again; returns true if a chunk was replaced
+//---------------------------------------------------------
+
+bool Seq::renderChanges()
+{
+    if (changedTick1 < 0) {
+        return false;
+    }
+    const int tick1 = changedTick1;
+    const int tick2 = qMax(changedTick2, changedTick1 + 1);
+    changedTick1 = -1;
+    changedTick2 = -1;
+    midi.setScoreChanged();
+
+    // the edited ticks in every repeat
+    std::vector<std::pair<int, int> > todo;
+    for (const RepeatSegment* rs : cs->repeatList()) {
+        const int t1 = qMax(tick1, rs->tick);
+        const int t2 = qMin(tick2, rs->tick + rs->len());
+        if (t1 < t2) {
+            const int offset = rs->utick - rs->tick;
+            todo.emplace_back(t1 + offset, t2 + offset);
+        }
+    }
+
+    const int playTick = playUTick;
+    std::set<int> done;
+    bool changed = false;
+    while (!todo.empty()) {
+        const std::pair<int, int> range = todo.back();
+        todo.pop_back();
+        for (int u = range.first; u < range.second;) {
+            const MidiRenderer::Chunk chunk = midi.getChunkAt(u);
+            if (!chunk) {
+                break;
+            }
+            u = chunk.utick2();
+            if (done.count(chunk.utick1())) {
+                continue;
+            }
+            // remove the rendered chunks overlapping the chunk; the
+            // chunk partition may have changed, so parts of them
+            // outside the chunk have to be rendered again, too
+            EventMap old;
+            bool rendered = false;
+            auto i = renderedChunks.upper_bound(chunk.utick1());
+            if (i != renderedChunks.begin() && std::prev(i)->second.utick2 > chunk.utick1()) {
+                --i;
+            }
+            while (i != renderedChunks.end() && i->first < chunk.utick2()) {
+                if (i->first < chunk.utick1()) {
+                    todo.emplace_back(i->first, chunk.utick1());
+                }
+                if (i->second.utick2 > chunk.utick2()) {
+                    todo.emplace_back(chunk.utick2(), i->second.utick2);
+                }
+                old.insert(i->second.events.cbegin(), i->second.events.cend());
+                i = renderedChunks.erase(i);
+                rendered = true;
+            }
+            if (!rendered) {
+                continue;           // rendered when playback gets there
+            }
+            EventMap events;
+            renderChunk(chunk, &events);
+            keepNoteOffs(old, events, playTick);
+            renderedChunks[chunk.utick1()] = { chunk.utick2(), std::move(events) };
+            done.insert(chunk.utick1());
+            changed = true;
+        }
+    }
+
+    renderEventsStatus.clear();
+    for (const auto& c : renderedChunks) {
+        renderEventsStatus.setOccupied(c.first, c.second.utick2);
+    }
+    return changed;
+}
+
+//---------------------------------------------------------
+//   PlaylistEvents
+//---------------------------------------------------------
+
+EventMap::const_iterator PlaylistEvents::lower_bound(int tick) const
+{
+    return std::lower_bound(_begin, _end, tick, [](const EventMap::value_type& e, int t) { return e.first < t; });
+}
+
+EventMap::const_iterator PlaylistEvents::upper_bound(int tick) const
+{
+    return std::upper_bound(_begin, _end, tick, [](int t, const EventMap::value_type& e) { return t < e.first; });
+}
+
+size_t PlaylistEvents::count(int tick) const
+{
+    return upper_bound(tick) - lower_bound(tick);
+}
+
+static bool tickLess(const EventMap::value_type& a, const EventMap::value_type& b)
+{
+    return a.first < b.first;
+}
+
+//---------------------------------------------------------
+//   publishChunks
+//    publish the playlist of all rendered chunks. Events
+//    at or after the end of the last chunk are kept back
+//    until the next chunk is rendered, so that chunk can
+//    be appended by appendChunk(); at the end of the score
+//    all events are published.
+//    gui thread
+//---------------------------------------------------------
+
+void Seq::publishChunks(bool restart, int restartUTick)
+{
+    size_t n = 0;
+    for (const auto& c : renderedChunks) {
+        n += c.second.events.size();
+    }
+    PlaylistEvents::Buffer events;
+    events.reserve(n);
+    for (const auto& c : renderedChunks) {
+        events.insert(events.end(), c.second.events.cbegin(), c.second.events.cend());
+    }
+    // the order of EventMap: equal ticks in insertion order
+    std::stable_sort(events.begin(), events.end(), tickLess);
+
+    pendingUTick = renderedChunks.empty() ? 0 : renderedChunks.crbegin()->second.utick2;
+    const bool complete = !cs || pendingUTick >= cs->repeatList().ticks();
+    auto split = complete ? events.end() : std::lower_bound(events.begin(), events.end(),
+                                                            EventMap::value_type(pendingUTick, NPlayEvent()), tickLess);
+    auto loopEnd = complete ? loopEvents.cend() : loopEvents.lower_bound(pendingUTick);
+
+    // leave room for the next chunks
+    std::shared_ptr<PlaylistEvents::Buffer> buffer = std::make_shared<PlaylistEvents::Buffer>();
+    buffer->reserve(2 * n + loopEvents.size());
+    std::merge(events.begin(), split, loopEvents.cbegin(), loopEnd, std::back_inserter(*buffer), tickLess);
+    pendingEvents.assign(split, events.end());
+    publish(PlaylistEvents(buffer), restart, restartUTick);
+}
+
+//---------------------------------------------------------
+//   appendChunk
+//    publish the rendered chunk at utick1 by appending its
+//    events to the buffer of the current playlist; returns
+//    false if it is not the chunk after the published ones
+//    gui thread
+//---------------------------------------------------------
+
+bool Seq::appendChunk(int utick1)
+{
+    auto c = renderedChunks.find(utick1);
+    if (c == renderedChunks.end() || utick1 != pendingUTick || std::next(c) != renderedChunks.end()
+        || !playlist->events.atBufferEnd()) {
+        return false;
+    }
+    const EventMap& chunkEvents = c->second.events;
+    if (!chunkEvents.empty() && chunkEvents.cbegin()->first < pendingUTick) {
+        return false;
+    }
+
+    // the kept back events of the chunks before come first, as
+    // in publishChunks()
+    PlaylistEvents::Buffer events;
+    events.reserve(pendingEvents.size() + chunkEvents.size());
+    std::merge(pendingEvents.begin(), pendingEvents.end(), chunkEvents.cbegin(), chunkEvents.cend(),
+               std::back_inserter(events), tickLess);
+
+    const int utick2    = c->second.utick2;
+    const bool complete = !cs || utick2 >= cs->repeatList().ticks();
+    auto split = complete ? events.end() : std::lower_bound(events.begin(), events.end(),
+                                                            EventMap::value_type(utick2, NPlayEvent()), tickLess);
+    auto loopBegin = loopEvents.lower_bound(pendingUTick);
+    auto loopEnd   = complete ? loopEvents.cend() : loopEvents.lower_bound(utick2);
+    const size_t n = (split - events.begin()) + (loopEnd - loopBegin);
+
+    // the buffer must not be reallocated while it is in use,
+    // a full buffer is replaced by a larger copy
+    std::shared_ptr<PlaylistEvents::Buffer> buffer = playlist->events.buffer();
+    if (buffer->capacity() - buffer->size() < n) {
+        std::shared_ptr<PlaylistEvents::Buffer> b = std::make_shared<PlaylistEvents::Buffer>();
+        b->reserve(2 * (buffer->size() + n));
+        b->assign(buffer->cbegin(), buffer->cend());
+        buffer = b;
+    }
+    std::merge(events.begin(), split, loopBegin, loopEnd, std::back_inserter(*buffer), tickLess);
+
+    pendingUTick = utick2;
+    pendingEvents.assign(split, events.end());
+    publish(PlaylistEvents(buffer));
+    return true;
+}
+
+//---------------------------------------------------------
+//   relocate
+//    return the position in to which corresponds to pos
+//    in from: the same tick and the same number of events
+//    with this tick before it
+//---------------------------------------------------------
+
+static EventMap::const_iterator relocate(const PlaylistEvents& from, EventMap::const_iterator pos,
+                                         const PlaylistEvents& to)
+{
+    if (pos == from.cend()) {
+        return to.cend();
+    }
+    const int utick = pos->first;
+    EventMap::const_iterator i = to.lower_bound(utick);
+    for (auto k = from.lower_bound(utick); k != pos && i != to.cend() && i->first == utick; ++k) {
+        ++i;
+    }
+    return i;
+}
+
+//---------------------------------------------------------
+//   publish
+//    make events the playlist of the audio thread; with
+//    restart playback continues at restartUTick, otherwise
+//    at the same event as before
+//    gui thread
+//---------------------------------------------------------
+
+void Seq::publish(PlaylistEvents&& events, bool restart, int restartUTick)
+{
+    Playlist* p = new Playlist;
+    p->events = std::move(events);
+    p->epoch  = playlist->epoch + 1;
+    if (restart) {
+        p->restartSerial = playlist->restartSerial + 1;
+        p->restartUTick  = restartUTick;
+    } else {
+        p->restartSerial = playlist->restartSerial;
+        p->restartUTick  = playlist->restartUTick;
+    }
+    guiPos = relocate(playlist->events, guiPos, p->events);
+    retiredPlaylists.push_back(playlist);
+    playlist = p;
+    publishedPlaylist.store(p, std::memory_order_release);
+
+    if (!pendingEvents.empty()) {
+        endUTick = pendingEvents.back().first;
+    } else {
+        endUTick = p->events.empty() ? 0 : std::prev(p->events.cend())->first;
+    }
+
+    if (!running) {
+        // no audio thread to pick it up
+        adoptPlaylist();
+    }
+    // free the playlists the audio thread has left
+    const quint64 epoch = rtEpoch.load(std::memory_order_acquire);
+    auto i = std::remove_if(retiredPlaylists.begin(), retiredPlaylists.end(), [epoch](Playlist* r) {
+        if (r->epoch < epoch) {
+            delete r;
+            return true;
+        }
+        return false;
+    });
+    retiredPlaylists.erase(i, retiredPlaylists.end());
+}
+
+//---------------------------------------------------------
+//   adoptPlaylist
+//    switch to the latest published playlist
+//    realtime thread
+//---------------------------------------------------------
+
+void Seq::adoptPlaylist()
+{
+    const Playlist* p = publishedPlaylist.load(std::memory_order_acquire);
+    if (p != rtPlaylist) {
+        if (p->restartSerial != rtPlaylist->restartSerial) {
+            playPos = p->events.lower_bound(p->restartUTick);
+        } else {
+            playPos = relocate(rtPlaylist->events, playPos, p->events);
+        }
+        rtPlaylist = p;
+        updatePlayUTick();
+    }
+    rtEpoch.store(p->epoch, std::memory_order_release);
+}
+
+//---------------------------------------------------------
+//   updatePlayUTick
+//    make the play position visible to the gui thread
+//    realtime thread
+//---------------------------------------------------------
+
+void Seq::updatePlayUTick()
+{
+    const PlaylistEvents& events = rtPlaylist->events;
+    playUTick = playPos != events.cend() ? playPos->first : INT_MAX;
+    if (playPos != events.cbegin()) {
+        playedUTick = std::prev(playPos)->first;
+    } else {
+        playedUTick = events.empty() ? 0 : playPos->first;
+    }
+}
+
+//---------------------------------------------------------
+//   guiPlayPos
+//    the play position in the playlist of the gui thread
+//---------------------------------------------------------
+
+EventMap::const_iterator Seq::guiPlayPos() const
+{
+    return playlist->events.lower_bound(playUTick);
 }
 
 //---------------------------------------------------------
@@ -1110,12 +1530,16 @@ void Seq::collectEvents(int utick)
 
     if (playlistChanged) {
         midi.setScoreChanged();
-        events.clear();
+        renderedChunks.clear();
+        loopEvents.clear();
         renderEvents.clear();
+        renderEventsRange = { 0, 0 };
         renderEventsStatus.clear();
-    } else if (!renderEvents.empty()) {
-        events.insert(renderEvents.begin(), renderEvents.end());
-        renderEvents.clear();
+        changedTick1 = -1;
+        changedTick2 = -1;
+    } else {
+        takeRenderEvents();
+        renderChanges();
     }
 
     int unrenderedUtick = renderEventsStatus.occupiedRangeEnd(utick);
@@ -1124,18 +1548,33 @@ void Seq::collectEvents(int utick)
         if (!chunk) {
             break;
         }
-        renderChunk(chunk, &events);
+        EventMap chunkEvents;
+        renderChunk(chunk, &chunkEvents);
+        renderedChunks[chunk.utick1()] = { chunk.utick2(), std::move(chunkEvents) };
         unrenderedUtick = renderEventsStatus.occupiedRangeEnd(utick);
     }
 
-    updateEventsEnd();
-    playPos = mscore->loop() ? events.find(cs->loopInTick().ticks()) : events.cbegin();
+    int restartUTick = INT_MIN;
+    if (mscore->loop()) {
+        const int loopIn = cs->loopInTick().ticks();
+        bool found = loopEvents.count(loopIn);
+        for (const auto& c : renderedChunks) {
+            found = found || c.second.events.count(loopIn);
+        }
+        restartUTick = found ? loopIn : INT_MAX;
+    }
+    publishChunks(true, restartUTick);
     playlistChanged = false;
     mutex.unlock();
 }
 
 //---------------------------------------------------------
 //   ensureBufferAsync
+//    called by the heart beat; while a chunk is rendered in
+//    background, edits stay marked in changedTick1/2 and are
+//    rendered by the first call after it is finished. The
+//    background chunk is then one of the rendered chunks, so
+//    it is rendered again if it contains edited measures.
 //---------------------------------------------------------
 
 void Seq::ensureBufferAsync(int utick)
@@ -1145,18 +1584,20 @@ void Seq::ensureBufferAsync(int utick)
             mutex.unlock();
             return;
         }
-
-        if (!renderEvents.empty()) {
-            // TODO: use C++17 map::merge()?
-            events.insert(renderEvents.begin(), renderEvents.end());
-            updateEventsEnd();
-            renderEvents.clear();
+        const bool edited = changedTick1 >= 0;
+        const int utick1 = renderEventsRange.first;
+        const bool taken = takeRenderEvents();
+        // edits replace chunks anywhere, a new chunk at the end
+        // is appended to the playlist
+        if ((edited && renderChanges()) || (taken && !appendChunk(utick1))) {
+            publishChunks();
         }
 
         const int unrenderedUtick = renderEventsStatus.occupiedRangeEnd(utick);
         if (unrenderedUtick - utick < minUtickBufferSize) {
             const MidiRenderer::Chunk chunk = midi.getChunkAt(unrenderedUtick);
             if (chunk) {
+                renderEventsRange = { chunk.utick1(), chunk.utick2() };
                 midiRenderFuture = QtConcurrent::run([this, chunk]() {
                         renderChunk(chunk, &renderEvents);
                     });
@@ -1182,7 +1623,14 @@ int Seq::getCurTick()
 
 void Seq::setRelTempo(double relTempo)
 {
-    guiToSeq(SeqMsg(SeqMsgId::TEMPO_CHANGE, relTempo));
+    if (!cs || !_driver || !running) {
+        return;
+    }
+    // build the time index for the new tempo here, the sequencer
+    // thread only swaps it in
+    TempoMap tempomap(*cs->tempomap());
+    tempomap.setRelTempo(relTempo);
+    guiToSeq(SeqMsg(SeqMsgId::TEMPO_CHANGE, new TimeIndex(&cs->repeatList(), &tempomap)));
 }
 
 //---------------------------------------------------------
@@ -1198,9 +1646,10 @@ void Seq::setPos(int utick)
     }
     stopNotes(-1, true);
 
+    adoptPlaylist();
+    const PlaylistEvents& events = rtPlaylist->events;
     int ucur;
-    mutex.lock();
-    if (playPos != events.end()) {
+    if (playPos != events.cend()) {
         ucur = cs->repeatList().utick2tick(playPos->first);
     } else {
         ucur = utick - 1;
@@ -1211,7 +1660,7 @@ void Seq::setPos(int utick)
 
     playFrame = cs->utick2utime(utick) * MScore::sampleRate;
     playPos   = events.lower_bound(utick);
-    mutex.unlock();
+    updatePlayUTick();
 }
 
 //---------------------------------------------------------
@@ -1249,7 +1698,7 @@ void Seq::seekCommon(int utick)
         ov_pcm_seek(&vf, sp);
     }
 
-    guiPos = events.lower_bound(utick);
+    guiPos = playlist->events.lower_bound(utick);
     mscore->setPos(Fraction::fromTicks(cs->repeatList().utick2tick(utick)));
     unmarkNotes();
 }
@@ -1442,7 +1891,7 @@ void Seq::nextMeasure()
 void Seq::nextChord()
 {
     int t = guiPos->first;
-    for (auto i = guiPos; i != eventsEnd; ++i) {
+    for (auto i = guiPos; i != playlist->events.cend(); ++i) {
         if (i->second.type() == ME_NOTEON && i->first > t && i->second.velo()) {
             seek(i->first);
             break;
@@ -1457,7 +1906,7 @@ void Seq::nextChord()
 void Seq::prevMeasure()
 {
     auto i = guiPos;
-    if (i == events.begin()) {
+    if (i == playlist->events.cbegin()) {
         return;
     }
     --i;
@@ -1476,7 +1925,15 @@ void Seq::prevMeasure()
 
 void Seq::prevChord()
 {
-    int t  = playPos->first;
+    const PlaylistEvents& events = playlist->events;
+    if (events.empty()) {
+        return;
+    }
+    EventMap::const_iterator pos = guiPlayPos();
+    if (pos == events.cend()) {
+        --pos;
+    }
+    int t  = pos->first;
     //find the chord just before playpos
     EventMap::const_iterator i = events.upper_bound(cs->repeatList().tick2utick(t));
     for (;;) {
@@ -1494,7 +1951,7 @@ void Seq::prevChord()
     }
     //go the previous chord
     if (i != events.cbegin()) {
-        i = playPos;
+        i = pos;
         for (;;) {
             if (i->second.type() == ME_NOTEON) {
                 const NPlayEvent& n = i->second;
@@ -1645,7 +2102,16 @@ void Seq::heartBeatTimeout()
 
     while (!fromSeq.empty()) {
         SeqMsg msg = fromSeq.dequeue();
-        if (msg.id == SeqMsgId::MIDI_INPUT_EVENT) {
+        if (msg.id == SeqMsgId::FREE_TIME_INDEX) {
+            // an index the sequencer did not publish, or none if it
+            // published one: then bring the repeat segment times up
+            // to date with the new tempo
+            if (msg.timeIndex) {
+                delete msg.timeIndex;
+            } else if (cs) {
+                cs->updateRepeatListSegmentTimes();
+            }
+        } else if (msg.id == SeqMsgId::MIDI_INPUT_EVENT) {
             int type = msg.event.type();
             if (type == ME_NOTEON) {
                 mscore->midiNoteReceived(msg.event.channel(), msg.event.pitch(), msg.event.velo());
@@ -1656,21 +2122,20 @@ void Seq::heartBeatTimeout()
             }
         }
     }
+    // delete the time indices replaced by tempo changes once
+    // the sequencer has moved off them
+    if (cs) {
+        cs->collectRepeatListTimeIndices();
+    }
 
     if (state != Transport::PLAY || inCountIn) {
         return;
     }
 
     int endFrame = playFrame;
+    const int playedTick = playedUTick;   // tick of the event played last
 
-    mutex.lock();
-    auto ppos = playPos;
-    if (ppos != events.cbegin()) {
-        --ppos;
-    }
-    mutex.unlock();
-
-    ensureBufferAsync(ppos->first);
+    ensureBufferAsync(playedTick);
 
     if (cs && cs->sigmap()->timesig(getCurTick()).nominal() != prevTimeSig) {
         prevTimeSig = cs->sigmap()->timesig(getCurTick()).nominal();
@@ -1682,8 +2147,8 @@ void Seq::heartBeatTimeout()
     }
 
     QRectF r;
-    for (; guiPos != eventsEnd; ++guiPos) {
-        if (guiPos->first > ppos->first) {
+    for (; guiPos != playlist->events.cend(); ++guiPos) {
+        if (guiPos->first > playedTick) {
             break;
         }
         if (mscore->loop()) {
@@ -1723,7 +2188,7 @@ void Seq::heartBeatTimeout()
             }
         }
     }
-    int utick = ppos->first;
+    int utick = playedTick;
     int t = cs->repeatList().utick2tick(utick);
     mscore->currentScoreView()->moveCursor(Fraction::fromTicks(t));
     mscore->setPos(Fraction::fromTicks(t));
@@ -1755,9 +2220,8 @@ void Seq::updateSynthesizerState(int tick1, int tick2)
     if (tick1 > tick2) {
         tick1 = 0;
     }
-    // Making a local copy of events to avoid touching it
-    // from different threads at the same time
-    EventMap ev = events;
+    // the playlist does not change while the audio thread uses it
+    const PlaylistEvents& ev = rtPlaylist->events;
     EventMap::const_iterator i1 = ev.lower_bound(tick1);
     EventMap::const_iterator i2 = ev.upper_bound(tick2);
 
@@ -1774,8 +2238,9 @@ void Seq::updateSynthesizerState(int tick1, int tick2)
 
 double Seq::curTempo() const
 {
-    if (playPos != events.end()) {
-        return cs ? cs->tempomap()->tempo(playPos->first) : 0.0;
+    const int utick = playUTick;
+    if (utick != INT_MAX) {
+        return cs ? cs->tempomap()->tempo(utick) : 0.0;
     }
 
     return 0.0;
@@ -1789,11 +2254,8 @@ void Seq::setLoopIn()
 {
     Fraction t;
     if (state == Transport::PLAY) {       // If in playback mode, set the In position where note is being played
-        auto ppos = playPos;
-        if (ppos != events.cbegin()) {
-            --ppos;                       // We have to go back one pos to get the correct note that has just been played
-        }
-        t = Fraction::fromTicks(cs->repeatList().utick2tick(ppos->first));
+        // We have to go back one pos to get the correct note that has just been played
+        t = Fraction::fromTicks(cs->repeatList().utick2tick(playedUTick));
     } else {
         t = cs->pos();            // Otherwise, use the selected note.
     }
@@ -1811,7 +2273,8 @@ void Seq::setLoopOut()
 {
     Fraction t;
     if (state == Transport::PLAY) {      // If in playback mode, set the Out position where note is being played
-        t = Fraction::fromTicks(cs->repeatList().utick2tick(playPos->first));
+        const int utick = playUTick;
+        t = Fraction::fromTicks(cs->repeatList().utick2tick(utick != INT_MAX ? utick : endUTick));
     } else {
         t = cs->pos() + cs->inputState().ticks();       // Otherwise, use the selected note.
     }
@@ -1847,10 +2310,13 @@ void Seq::setLoopSelection()
 
     // add a dummy event to loop end if it is not already there
     // this is to let the playback reach the end completely before starting again
-    if (!events.count(cs->loopOutTick().ticks())) {
+    const EventMap::value_type loopOut(cs->loopOutTick().ticks(), NPlayEvent());
+    if (!playlist->events.count(loopOut.first)
+        && !std::binary_search(pendingEvents.cbegin(), pendingEvents.cend(), loopOut, tickLess)) {
         NPlayEvent ev;
         ev.setValue(ME_INVALID);
-        events.insert(std::pair<int, Ms::NPlayEvent>(cs->loopOutTick().ticks(), ev));
+        loopEvents.insert(std::pair<int, Ms::NPlayEvent>(cs->loopOutTick().ticks(), ev));
+        publishChunks();
     }
 }
 
@@ -20,6 +20,10 @@
 #ifndef __SEQ_H__
 #define __SEQ_H__
 
+#include <atomic>
+#include <memory>
+#include <vector>
+
 #include "libmscore/rendermidi.h"
 #include "libmscore/sequencer.h"
 #include "libmscore/fraction.h"
@@ -44,6 +48,7 @@ class Channel;
 class ScoreView;
 class MasterSynthesizer;
 class Segment;
+class TimeIndex;
 enum class POS : char;
 
 //---------------------------------------------------------
@@ -56,7 +61,8 @@ enum class SeqMsgId : char {
     TEMPO_CHANGE,
     PLAY, SEEK,
     ALL_NOTE_OFF,
-    MIDI_INPUT_EVENT
+    MIDI_INPUT_EVENT,
+    FREE_TIME_INDEX
 };
 
 struct SeqMsg {
@@ -64,6 +70,7 @@ struct SeqMsg {
     union {
         int intVal;
         qreal realVal;
+        TimeIndex* timeIndex;
     };
     NPlayEvent event;
 
@@ -72,6 +79,8 @@ struct SeqMsg {
         : id(_id), intVal(val) {}
     SeqMsg(SeqMsgId _id, qreal val)
         : id(_id), realVal(val) {}
+    SeqMsg(SeqMsgId _id, TimeIndex* index)
+        : id(_id), timeIndex(index) {}
     SeqMsg(SeqMsgId _id, const NPlayEvent& e)
         : id(_id), event(e) {}
 };
@@ -101,6 +110,43 @@ enum class Transport : char {
     NET_STARTING=4
 };
 
+//---------------------------------------------------------
+//   PlaylistEvents
+//    the events of a playlist: a sorted range at the start
+//    of a buffer shared with the playlists published
+//    before. The gui thread appends to the buffer behind
+//    the range of the latest playlist only, so published
+//    events are neither copied nor moved.
+//---------------------------------------------------------
+
+class PlaylistEvents
+{
+public:
+    typedef std::vector<EventMap::value_type> Buffer;
+
+private:
+    std::shared_ptr<Buffer> _buffer;
+    EventMap::const_iterator _begin;
+    EventMap::const_iterator _end;
+
+public:
+    PlaylistEvents()
+        : PlaylistEvents(std::make_shared<Buffer>()) {}
+    PlaylistEvents(const std::shared_ptr<Buffer>& buffer)
+        : _buffer(buffer), _begin(buffer->cbegin()), _end(buffer->cend()) {}
+
+    const std::shared_ptr<Buffer>& buffer() const { return _buffer; }
+    bool atBufferEnd() const { return _end == _buffer->cend(); }
+
+    bool empty() const { return _begin == _end; }
+    size_t size() const { return _end - _begin; }
+    EventMap::const_iterator cbegin() const { return _begin; }
+    EventMap::const_iterator cend() const { return _end; }
+    EventMap::const_iterator lower_bound(int tick) const;
+    EventMap::const_iterator upper_bound(int tick) const;
+    size_t count(int tick) const;
+};
+
 //---------------------------------------------------------
 //   Seq
 //    sequencer
@@ -139,9 +185,48 @@ class Seq : public QObject, public Sequencer
     double meterPeakValue[2];
     int peakTimer[2];
 
-    EventMap events;                      // playlist for playback mode
-    EventMap::const_iterator eventsEnd;
+    //---------------------------------------------------------
+    //   Playlist
+    //    sorted events for playback mode; never changed once
+    //    published, but later playlists may share and extend
+    //    their buffer. The audio thread switches to the published
+    //    playlist at the start of a period and reports the
+    //    epoch it uses in rtEpoch; older playlists are freed by
+    //    the gui thread.
+    //---------------------------------------------------------
+
+    struct Playlist {
+        PlaylistEvents events;
+        quint64 epoch         { 0 };
+        quint64 restartSerial { 0 };      // changed when playback has to restart
+        int restartUTick      { 0 };      // at the first event at or after this tick
+    };
+    Playlist* playlist;                   // latest playlist, gui thread
+    std::vector<Playlist*> retiredPlaylists;
+    std::atomic<Playlist*> publishedPlaylist;
+    std::atomic<quint64> rtEpoch;
+    const Playlist* rtPlaylist;           // playlist used by the audio thread
+
+    //---------------------------------------------------------
+    //   RenderedChunk
+    //    events of one MidiRenderer::Chunk; the playlist is
+    //    merged from the rendered chunks, so the chunks with
+    //    edited measures can be replaced
+    //---------------------------------------------------------
+
+    struct RenderedChunk {
+        int utick2;
+        EventMap events;
+    };
+    std::map<int, RenderedChunk> renderedChunks;   // by start tick
+    EventMap loopEvents;                  // marks the end of the loop
+    int pendingUTick { 0 };               // end of the last rendered chunk
+    PlaylistEvents::Buffer pendingEvents; // rendered events at or after pendingUTick, not published yet
+    int changedTick1 { -1 };              // edited score ticks not rendered again
+    int changedTick2 { -1 };
+
     EventMap renderEvents;                // event list that is rendered in background
+    std::pair<int, int> renderEventsRange { 0, 0 };   // ticks of the chunk in renderEvents
     RangeMap renderEventsStatus;
     MidiRenderer midi;
     QFuture<void> midiRenderFuture;
@@ -154,9 +239,11 @@ class Seq : public QObject, public Sequencer
     int countInPlayFrame;                 // current play position in samples, relative to the first frame of countin
     int endUTick;                         // the final tick of midi events collected by collectEvents()
 
-    EventMap::const_iterator playPos;     // moved in real time thread
+    EventMap::const_iterator playPos;     // moved in real time thread, points into rtPlaylist
+    std::atomic<int> playUTick;           // tick of playPos, INT_MAX at the end of the playlist
+    std::atomic<int> playedUTick;         // tick of the event before playPos
     EventMap::const_iterator countInPlayPos;
-    EventMap::const_iterator guiPos;      // moved in gui thread
+    EventMap::const_iterator guiPos;      // moved in gui thread, points into playlist
 
     QList<const Note*> markedNotes;       // notes marked as sounding
 
@@ -194,7 +281,14 @@ class Seq : public QObject, public Sequencer
     void stopTransport();
 
     void renderChunk(const MidiRenderer::Chunk&, EventMap*);
-    void updateEventsEnd();
+    bool takeRenderEvents();
+    bool renderChanges();
+    void publishChunks(bool restart = false, int restartUTick = 0);
+    bool appendChunk(int utick1);
+    void publish(PlaylistEvents&& events, bool restart = false, int restartUTick = 0);
+    void adoptPlaylist();
+    void updatePlayUTick();
+    EventMap::const_iterator guiPlayPos() const;
 
     void setPos(int);
     void playEvent(const NPlayEvent&, unsigned framePos);
@@ -213,7 +307,7 @@ private slots:
     void seqMessage(int msg, int arg = 0);
     void heartBeatTimeout();
     void midiInputReady();
-    void setPlaylistChanged() { playlistChanged = true; }
+    void setPlaylistChanged();
     void handleTimeSigTempoChanged();
 
 public slots:
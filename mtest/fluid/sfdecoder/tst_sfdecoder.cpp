@@ -0,0 +1,284 @@
+//=============================================================================
+//  MuseScore
+//  Music Composition & Notation
+//
+//  Copyright (C) 2020 Werner Schweer
+//
+//  This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License version 2
+//  as published by the Free Software Foundation and appearing in
+//  the file LICENCE.GPL
+//=============================================================================
+
+#include <QtTest/QtTest>
+
+#include "mtest/testutils.h"
+
+#include "audio/midi/event.h"
+#include "audio/midi/fluid/fluid.h"
+#include "audio/midi/fluid/sfdecoder.h"
+#include "audio/midi/fluid/sfont.h"
+
+using namespace Ms;
+using namespace FluidS;
+
+//---------------------------------------------------------
+//   TestSfDecoder
+//    a realtime synthesizer must not lose the notes played
+//    before the decoder has loaded their samples, and the
+//    decoded sample cache must stay within its budget
+//---------------------------------------------------------
+
+class TestSfDecoder : public QObject, public MTest
+{
+    Q_OBJECT
+
+    QTemporaryDir dir;
+    QString sfPath;
+
+    bool sounds(Fluid& fluid, int periods);
+
+private slots:
+    void initTestCase();
+    void offlineNoteOn();
+    void decodeOnDemand();
+    void noteOffWhileLoading();
+    void cacheBudget();
+};
+
+//---------------------------------------------------------
+//   writeSoundFont
+//    a SoundFont 2 file with one preset playing one looped
+//    square wave sample
+//---------------------------------------------------------
+
+static const int FRAMES = 1000;
+
+static QByteArray record(std::function<void(QDataStream&)> f)
+{
+    QByteArray b;
+    QDataStream s(&b, QIODevice::WriteOnly);
+    s.setByteOrder(QDataStream::LittleEndian);
+    f(s);
+    return b;
+}
+
+static void chunk(QDataStream& s, const char* id, const QByteArray& data)
+{
+    s.writeRawData(id, 4);
+    s << quint32(data.size());
+    s.writeRawData(data.constData(), data.size());
+}
+
+static QByteArray list(const char* type, const QByteArray& data)
+{
+    QByteArray b(type, 4);
+    return b + data;
+}
+
+static void name(QDataStream& s, const char* n)
+{
+    char buf[20] = {};
+    qstrncpy(buf, n, sizeof(buf));
+    s.writeRawData(buf, sizeof(buf));
+}
+
+static bool writeSoundFont(const QString& path)
+{
+    QByteArray info = record([](QDataStream& s) {
+        chunk(s, "ifil", record([](QDataStream& v) { v << quint16(2) << quint16(1); }));
+    });
+    QByteArray sdta = record([](QDataStream& s) {
+        chunk(s, "smpl", record([](QDataStream& v) {
+            for (int i = 0; i < FRAMES + 46; ++i) {
+                v << qint16(i < FRAMES ? ((i / 50) % 2 ? 16000 : -16000) : 0);
+            }
+        }));
+    });
+    QByteArray pdta = record([](QDataStream& s) {
+        chunk(s, "phdr", record([](QDataStream& v) {
+            name(v, "square");
+            v << quint16(0) << quint16(0) << quint16(0) << quint32(0) << quint32(0) << quint32(0);
+            name(v, "EOP");
+            v << quint16(0) << quint16(0) << quint16(1) << quint32(0) << quint32(0) << quint32(0);
+        }));
+        chunk(s, "pbag", record([](QDataStream& v) { v << quint16(0) << quint16(0) << quint16(1) << quint16(0); }));
+        chunk(s, "pmod", QByteArray(10, 0));
+        chunk(s, "pgen", record([](QDataStream& v) {
+            v << quint16(Gen_Instrument) << quint16(0) << quint16(0) << quint16(0);
+        }));
+        chunk(s, "inst", record([](QDataStream& v) {
+            name(v, "square");
+            v << quint16(0);
+            name(v, "EOI");
+            v << quint16(1);
+        }));
+        chunk(s, "ibag", record([](QDataStream& v) { v << quint16(0) << quint16(0) << quint16(2) << quint16(0); }));
+        chunk(s, "imod", QByteArray(10, 0));
+        chunk(s, "igen", record([](QDataStream& v) {
+            v << quint16(Gen_SampleModes) << quint16(1) << quint16(Gen_SampleId) << quint16(0);
+            v << quint16(0) << quint16(0);
+        }));
+        chunk(s, "shdr", record([](QDataStream& v) {
+            name(v, "square");
+            v << quint32(0) << quint32(FRAMES) << quint32(100) << quint32(900) << quint32(44100);
+            v << quint8(60) << qint8(0) << quint16(0) << quint16(1);
+            name(v, "EOS");
+            v << quint32(0) << quint32(0) << quint32(0) << quint32(0) << quint32(0);
+            v << quint8(0) << qint8(0) << quint16(0) << quint16(0);
+        }));
+    });
+
+    QByteArray sfbk = record([&](QDataStream& s) {
+        chunk(s, "LIST", list("INFO", info));
+        chunk(s, "LIST", list("sdta", sdta));
+        chunk(s, "LIST", list("pdta", pdta));
+    });
+    QFile f(path);
+    if (!f.open(QIODevice::WriteOnly)) {
+        return false;
+    }
+    QDataStream s(&f);
+    s.setByteOrder(QDataStream::LittleEndian);
+    chunk(s, "RIFF", list("sfbk", sfbk));
+    return f.error() == QFile::NoError;
+}
+
+//---------------------------------------------------------
+//   initTestCase
+//---------------------------------------------------------
+
+void TestSfDecoder::initTestCase()
+{
+    initMTest();
+    QVERIFY(dir.isValid());
+    sfPath = dir.filePath("square.sf2");
+    QVERIFY(writeSoundFont(sfPath));
+}
+
+//---------------------------------------------------------
+//   sounds
+//    render up to periods periods, waiting a little for the
+//    decoder in between; true once the output is not silent
+//---------------------------------------------------------
+
+bool TestSfDecoder::sounds(Fluid& fluid, int periods)
+{
+    for (int i = 0; i < periods; ++i) {
+        float out[2 * 64] = {};
+        float reverb[2 * 64] = {};
+        float chorus[2 * 64] = {};
+        fluid.process(64, out, reverb, chorus);
+        for (float v : out) {
+            if (v != 0.0f) {
+                return true;
+            }
+        }
+        QThread::msleep(1);
+    }
+    return false;
+}
+
+//---------------------------------------------------------
+//   offlineNoteOn
+//    an offline synthesizer loads the sample on note on and
+//    plays it in the first period
+//---------------------------------------------------------
+
+void TestSfDecoder::offlineNoteOn()
+{
+    Fluid fluid;
+    fluid.init(44100);
+    QVERIFY(fluid.addSoundFont(sfPath));
+    fluid.play(PlayEvent(ME_CONTROLLER, 0, CTRL_PROGRAM, 0));
+    fluid.play(PlayEvent(ME_NOTEON, 0, 60, 100));
+    QVERIFY(sounds(fluid, 1));
+}
+
+//---------------------------------------------------------
+//   decodeOnDemand
+//    a realtime synthesizer leaves loading to the decoder;
+//    the note played right after the program change is held
+//    back until the sample is there, not dropped
+//---------------------------------------------------------
+
+void TestSfDecoder::decodeOnDemand()
+{
+    Fluid fluid;
+    fluid.init(44100);
+    fluid.setRealtime(true);
+    QVERIFY(fluid.addSoundFont(sfPath));
+    fluid.play(PlayEvent(ME_CONTROLLER, 0, CTRL_PROGRAM, 0));
+    fluid.play(PlayEvent(ME_NOTEON, 0, 60, 100));
+    QVERIFY(sounds(fluid, 2000));
+}
+
+//---------------------------------------------------------
+//   noteOffWhileLoading
+//    a note released before its sample is loaded still
+//    sounds, with its release
+//---------------------------------------------------------
+
+void TestSfDecoder::noteOffWhileLoading()
+{
+    Fluid fluid;
+    fluid.init(44100);
+    fluid.setRealtime(true);
+    QVERIFY(fluid.addSoundFont(sfPath));
+    fluid.play(PlayEvent(ME_CONTROLLER, 0, CTRL_PROGRAM, 0));
+    fluid.play(PlayEvent(ME_NOTEON, 0, 62, 100));
+    fluid.play(PlayEvent(ME_NOTEON, 0, 62, 0));
+    QVERIFY(sounds(fluid, 2000));
+}
+
+//---------------------------------------------------------
+//   cacheBudget
+//    decoded samples nobody plays are dropped least recently
+//    used first once the cache exceeds its budget
+//---------------------------------------------------------
+
+void TestSfDecoder::cacheBudget()
+{
+    SampleDecoder& decoder = SampleDecoder::instance();
+    const qint64 budget = SampleDecoder::cacheBudget;
+    const qint64 base   = decoder.cachedBytes();
+    const qint64 size   = 1000 * sizeof(short);
+    SampleDecoder::cacheBudget = base + 3 * size;
+
+    auto decoded = []() {
+        auto d = std::make_shared<DecodedSample>();
+        d->data.resize(1000);
+        d->valid = true;
+        return d;
+    };
+    decoder.insert("test:1", decoded(), nullptr);
+    decoder.insert("test:2", decoded(), nullptr);
+    decoder.insert("test:3", decoded(), nullptr);
+    QCOMPARE(decoder.cachedBytes(), base + 3 * size);
+
+    // use the first one, the second is then the least recently used
+    QVERIFY(decoder.find("test:1", nullptr));
+    decoder.insert("test:4", decoded(), nullptr);
+    QVERIFY(decoder.cachedBytes() <= SampleDecoder::cacheBudget);
+    QVERIFY(!decoder.find("test:2", nullptr));
+    QVERIFY(decoder.find("test:1", nullptr));
+    QVERIFY(decoder.find("test:3", nullptr));
+    QVERIFY(decoder.find("test:4", nullptr));
+
+    // the same key decoded twice is cached once
+    std::shared_ptr<DecodedSample> d = decoder.find("test:4", nullptr);
+    QVERIFY(decoder.insert("test:4", decoded(), nullptr) == d);
+    QVERIFY(decoder.cachedBytes() <= SampleDecoder::cacheBudget);
+
+    // a smaller budget drops all of them
+    SampleDecoder::cacheBudget = base;
+    decoder.insert("test:5", decoded(), nullptr);
+    QVERIFY(decoder.cachedBytes() <= base);
+    QVERIFY(!decoder.find("test:5", nullptr));
+
+    SampleDecoder::cacheBudget = budget;
+}
+
+QTEST_MAIN(TestSfDecoder)
+
+#include "tst_sfdecoder.moc"
@@ -0,0 +1,287 @@
+//=============================================================================
+//  MuseScore
+//  Music Composition & Notation
+//
+//  Copyright (C) 2020 Werner Schweer
+//
+//  This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License version 2
+//  as published by the Free Software Foundation and appearing in
+//  the file LICENCE.GPL
+//=============================================================================
+
+#include <QtTest/QtTest>
+#include <QSvgGenerator>
+#include "mtest/testutils.h"
+#include "libmscore/score.h"
+#include "libmscore/chord.h"
+#include "libmscore/measure.h"
+#include "libmscore/note.h"
+#include "libmscore/page.h"
+#include "libmscore/segment.h"
+#include "libmscore/synthesizerstate.h"
+#include "audio/midi/event.h"
+
+using namespace Ms;
+
+//---------------------------------------------------------
+//   TestBenchmarkCorpus
+//    times load, layout, incremental layout, MIDI rendering
+//    and PDF/SVG export for a corpus of representative
+//    scores; see README for the environment variables
+//---------------------------------------------------------
+
+class TestBenchmarkCorpus : public QObject, public MTest
+{
+    Q_OBJECT
+
+    int runs { 1 };
+    double tolerance { 0.2 };
+    double minTime { 5.0 };            // ms; faster measurements are too noisy to compare
+    QString outputFile;
+    QJsonObject baseline;
+    QJsonObject results;
+
+    template<typename F> double measure(F f) const;
+    double relayout(MasterScore* score, Note* note) const;
+    QStringList regressions(const QString& name, const QJsonObject& result) const;
+
+private slots:
+    void initTestCase();
+    void corpus_data();
+    void corpus();
+    void cleanupTestCase();
+};
+
+//---------------------------------------------------------
+//   initTestCase
+//---------------------------------------------------------
+
+void TestBenchmarkCorpus::initTestCase()
+{
+    initMTest();
+    MScore::testMode = true;
+
+    runs = qMax(1, qEnvironmentVariableIntValue("MSCORE_BENCHMARK_RUNS"));
+    if (qEnvironmentVariableIsSet("MSCORE_BENCHMARK_TOLERANCE")) {
+        tolerance = qgetenv("MSCORE_BENCHMARK_TOLERANCE").toDouble();
+    }
+    outputFile = qEnvironmentVariableIsSet("MSCORE_BENCHMARK_OUTPUT")
+                 ? QString::fromLocal8Bit(qgetenv("MSCORE_BENCHMARK_OUTPUT"))
+                 : QString("benchmark.json");
+
+    if (qEnvironmentVariableIsSet("MSCORE_BENCHMARK_BASELINE")) {
+        QFile f(QString::fromLocal8Bit(qgetenv("MSCORE_BENCHMARK_BASELINE")));
+        QVERIFY2(f.open(QIODevice::ReadOnly), qPrintable(QString("cannot read baseline <%1>").arg(f.fileName())));
+        QJsonParseError pe;
+        QJsonDocument doc = QJsonDocument::fromJson(f.readAll(), &pe);
+        QVERIFY2(pe.error == QJsonParseError::NoError, qPrintable(pe.errorString()));
+        baseline = doc.object().value("results").toObject();
+    }
+}
+
+//---------------------------------------------------------
+//   corpus_data
+//---------------------------------------------------------
+
+void TestBenchmarkCorpus::corpus_data()
+{
+    QTest::addColumn<QString>("file");
+
+    QTest::newRow("orchestral")  << "libmscore/concertpitch/concertpitchbenchmark.mscx";
+    QTest::newRow("strings")     << "../demos/Dynamic_Strings.mscx";
+    QTest::newRow("piano")       << "../demos/Fugue_1.mscx";
+    QTest::newRow("choral")      << "../demos/adeste.mscx";
+    QTest::newRow("tablature")   << "guitarpro/keysig.gpx-ref.mscx";
+    QTest::newRow("spanners")    << "libmscore/all_elements/moonlight.mscx";
+    QTest::newRow("band")        << "../demos/Brassed_Up.mscx";
+}
+
+//---------------------------------------------------------
+//   measure
+//    median time of f() in milliseconds
+//---------------------------------------------------------
+
+template<typename F>
+double TestBenchmarkCorpus::measure(F f) const
+{
+    std::vector<double> t;
+    for (int i = 0; i < runs; ++i) {
+        QElapsedTimer timer;
+        timer.start();
+        f();
+        t.push_back(timer.nsecsElapsed() / 1e6);
+    }
+    std::sort(t.begin(), t.end());
+    return t[t.size() / 2];
+}
+
+//---------------------------------------------------------
+//   firstNote
+//    the first note of measure m, or of the nearest measure
+//    after or before it that has one
+//---------------------------------------------------------
+
+static Note* firstNote(Measure* m)
+{
+    auto find = [](Measure* mm) -> Note* {
+        for (Segment* s = mm->first(SegmentType::ChordRest); s; s = s->next(SegmentType::ChordRest)) {
+            for (Element* e : s->elist()) {
+                if (e && e->isChord()) {
+                    return toChord(e)->upNote();
+                }
+            }
+        }
+        return nullptr;
+    };
+    for (Measure* mm = m; mm; mm = mm->nextMeasure()) {
+        if (Note* n = find(mm)) {
+            return n;
+        }
+    }
+    for (Measure* mm = m->prevMeasure(); mm; mm = mm->prevMeasure()) {
+        if (Note* n = find(mm)) {
+            return n;
+        }
+    }
+    return nullptr;
+}
+
+//---------------------------------------------------------
+//   relayout
+//    incremental layout after an edit: raise the pitch of
+//    note by a semitone and undo it, so every run starts
+//    from the same score; this times two incremental
+//    layouts of the measure
+//---------------------------------------------------------
+
+double TestBenchmarkCorpus::relayout(MasterScore* score, Note* note) const
+{
+    return measure([score, note]() {
+        const int pitch = note->pitch() < 127 ? note->pitch() + 1 : note->pitch() - 1;
+        score->startCmd();
+        score->undoChangePitch(note, pitch, note->tpc1default(pitch), note->tpc2default(pitch));
+        score->endCmd();
+        score->undoRedo(true, 0);
+    });
+}
+
+//---------------------------------------------------------
+//   regressions
+//---------------------------------------------------------
+
+QStringList TestBenchmarkCorpus::regressions(const QString& name, const QJsonObject& result) const
+{
+    QStringList sl;
+    const QJsonObject base = baseline.value(name).toObject();
+    for (auto i = result.constBegin(); i != result.constEnd(); ++i) {
+        if (!base.contains(i.key())) {
+            continue;
+        }
+        const double t = i.value().toDouble();
+        const double b = base.value(i.key()).toDouble();
+        if (t > minTime && t > b * (1.0 + tolerance)) {
+            sl.append(QString("%1: %2 ms, baseline %3 ms (%4%)")
+                      .arg(i.key()).arg(t, 0, 'f', 2).arg(b, 0, 'f', 2)
+                      .arg(b > 0.0 ? qRound((t / b - 1.0) * 100.0) : 100));
+        }
+    }
+    return sl;
+}
+
+//---------------------------------------------------------
+//   corpus
+//---------------------------------------------------------
+
+void TestBenchmarkCorpus::corpus()
+{
+    QFETCH(QString, file);
+    const QString name = QTest::currentDataTag();
+    const QString path = root + "/" + file;
+
+    QJsonObject result;
+    MasterScore* score = nullptr;
+
+    // QVERIFY only returns from the lambda, check the results afterwards
+    bool loaded = true;
+    result["load"] = measure([&]() {
+        delete score;
+        score = new MasterScore(mscore->baseStyle());
+        score->setName(QFileInfo(path).completeBaseName());
+        if (score->loadMsc(path, false) != Score::FileError::FILE_NO_ERROR) {
+            loaded = false;
+        }
+    });
+    QVERIFY2(loaded, qPrintable(QString("cannot load <%1>").arg(path)));
+
+    result["layout"] = measure([score]() { score->doLayout(); });
+
+    std::vector<Measure*> ml;
+    for (Measure* m = score->firstMeasure(); m; m = m->nextMeasure()) {
+        ml.push_back(m);
+    }
+    QVERIFY(!ml.empty());
+    Note* start  = firstNote(ml.front());
+    Note* middle = firstNote(ml[ml.size() / 2]);
+    Note* end    = firstNote(ml.back());
+    QVERIFY2(start && middle && end, qPrintable(QString("no notes in <%1>").arg(path)));
+    const int pitch = start->pitch();
+    result["relayoutStart"]  = relayout(score, start);
+    result["relayoutMiddle"] = relayout(score, middle);
+    result["relayoutEnd"]    = relayout(score, end);
+    QCOMPARE(start->pitch(), pitch);        // undone
+
+    result["renderMidi"] = measure([score]() {
+        EventMap events;
+        score->renderMidi(&events, SynthesizerState());
+    });
+
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    bool saved = true;
+    result["pdf"] = measure([&]() {
+        if (!savePdf(score, dir.filePath(name + ".pdf"))) {
+            saved = false;
+        }
+    });
+    QVERIFY(saved);
+
+    result["svg"] = measure([score]() {
+        MScore::svgPrinting = true;
+        for (int i = 0; i < score->npages(); ++i) {
+            QBuffer buffer;
+            QSvgGenerator printer;
+            printer.setOutputDevice(&buffer);
+            QRectF r = score->pages().at(i)->abbox();
+            printer.setSize(QSize(r.width(), r.height()));
+            printer.setViewBox(QRectF(0, 0, r.width(), r.height()));
+            QPainter p(&printer);
+            score->print(&p, i);
+        }
+        MScore::svgPrinting = false;
+    });
+
+    delete score;
+    results[name] = result;
+
+    QStringList sl = regressions(name, result);
+    QVERIFY2(sl.isEmpty(), qPrintable(sl.join("; ")));
+}
+
+//---------------------------------------------------------
+//   cleanupTestCase
+//    write results in the baseline format
+//---------------------------------------------------------
+
+void TestBenchmarkCorpus::cleanupTestCase()
+{
+    QJsonObject o;
+    o["runs"]    = runs;
+    o["results"] = results;
+    QFile f(outputFile);
+    QVERIFY2(f.open(QIODevice::WriteOnly), qPrintable(QString("cannot write <%1>").arg(outputFile)));
+    f.write(QJsonDocument(o).toJson());
+}
+
+QTEST_MAIN(TestBenchmarkCorpus)
+#include "tst_benchmarkcorpus.moc"
@@ -39,6 +39,7 @@ private slots:
     void benchmark1();
     void benchmark2();
     void benchmark4();              // incremental layout (one page)
+    void benchmark5();              // full layout, staves in parallel
 };
 
 //---------------------------------------------------------
@@ -90,5 +91,15 @@ void TestBenchmark::benchmark4()
     }
 }
 
+void TestBenchmark::benchmark5()
+{
+    MScore::parallelLayout = true;
+    score->doLayout();
+    QBENCHMARK {
+        score->doLayout();
+    }
+    MScore::parallelLayout = false;
+}
+
 QTEST_MAIN(TestBenchmark)
 #include "tst_benchmark.moc"
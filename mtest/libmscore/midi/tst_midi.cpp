@@ -23,8 +23,12 @@
 #include "libmscore/chord.h"
 #include "libmscore/note.h"
 #include "libmscore/keysig.h"
+#include "libmscore/tie.h"
+#include "libmscore/rendermidi.h"
 #include "audio/exports/exportmidi.h"
 #include <QIODevice>
+#include <algorithm>
+#include <map>
 
 #include "libmscore/mcursor.h"
 #include "mtest/testutils.h"
@@ -56,6 +60,8 @@ private slots:
     void midi03();
     void events_data();
     void events();
+    void eventMap();
+    void playlistRange();
     void midiBendsExport1() { midiExportTestRef("testBends1"); }
     void midiBendsExport2() { midiExportTestRef("testBends2"); }        // Play property test
     void midiPortExport() { midiExportTestRef("testMidiPort"); }
@@ -575,6 +581,228 @@ void TestMidi::events()
     delete score;
 }
 
+//---------------------------------------------------------
+//   eventMap
+//    EventMap must behave like the std::multimap it
+//    replaced: sorted by tick, equal ticks in insertion
+//    order, also for events inserted after a read
+//---------------------------------------------------------
+
+static bool sameEvents(const EventMap& events, const std::multimap<int, NPlayEvent>& reference)
+{
+    if (events.size() != reference.size()) {
+        return false;
+    }
+    auto r = reference.cbegin();
+    for (auto i = events.cbegin(); i != events.cend(); ++i, ++r) {
+        if (i->first != r->first || i->second.dataA() != r->second.dataA() || i->second.dataB() != r->second.dataB()) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void TestMidi::eventMap()
+{
+    EventMap events;
+    std::multimap<int, NPlayEvent> reference;
+
+    unsigned seed = 1;
+    for (int round = 0; round < 4; ++round) {
+        for (int i = 0; i < 200; ++i) {
+            seed = seed * 1103515245 + 12345;
+            const int tick = (seed >> 16) % 50 * 120;
+            // pitch and velocity identify the event
+            NPlayEvent e(ME_NOTEON, 0, i % 128, round * 2 + i / 128 + 1);
+            events.insert(std::make_pair(tick, e));
+            reference.insert(std::make_pair(tick, e));
+        }
+        QVERIFY(sameEvents(events, reference));
+    }
+
+    // range queries
+    for (int tick = -120; tick <= 50 * 120; tick += 60) {
+        QCOMPARE(events.count(tick), reference.count(tick));
+        QCOMPARE(int(events.lower_bound(tick) - events.cbegin()),
+                 int(std::distance(reference.cbegin(), reference.lower_bound(tick))));
+        QCOMPARE(int(events.upper_bound(tick) - events.cbegin()),
+                 int(std::distance(reference.cbegin(), reference.upper_bound(tick))));
+        // find() returns the first event of the tick
+        auto f = events.find(tick);
+        QCOMPARE(f == events.cend(), reference.find(tick) == reference.cend());
+        if (f != events.cend()) {
+            QVERIFY(f == events.lower_bound(tick));
+        }
+    }
+
+    // erase a range and insert into it again
+    events.erase(events.lower_bound(1200), events.upper_bound(2400));
+    reference.erase(reference.lower_bound(1200), reference.upper_bound(2400));
+    QVERIFY(sameEvents(events, reference));
+    for (int i = 0; i < 10; ++i) {
+        NPlayEvent e(ME_CONTROLLER, 0, i, 0);
+        events.insert(std::make_pair(1800, e));
+        reference.insert(std::make_pair(1800, e));
+    }
+    QVERIFY(sameEvents(events, reference));
+
+    EventMap copy;
+    copy.insert(events.cbegin(), events.cend());
+    QVERIFY(sameEvents(copy, reference));
+    events.clear();
+    QVERIFY(events.empty());
+    QVERIFY(events.cbegin() == events.cend());
+}
+
+//---------------------------------------------------------
+//   playlistRange
+//    an edit marks only the ticks whose playback it changes
+//    dirty; rendering the chunks of these ticks again must
+//    give the events of a full render. The score has two
+//    chunks of two measures and a tie across the chunks.
+//---------------------------------------------------------
+
+static bool sameEvents(const EventMap& a, const EventMap& b)
+{
+    if (a.size() != b.size()) {
+        return false;
+    }
+    return std::equal(a.cbegin(), a.cend(), b.cbegin(), [](const EventMap::value_type& x, const EventMap::value_type& y) {
+        return x.first == y.first && x.second.type() == y.second.type() && x.second.channel() == y.second.channel()
+               && x.second.dataA() == y.second.dataA() && x.second.dataB() == y.second.dataB();
+    });
+}
+
+static bool rerenderEquals(MasterScore* score, MidiRenderer& midi, std::map<int, EventMap>& chunks)
+{
+    SynthesizerState ss;
+    MidiRenderer::Context ctx(ss);
+    midi.setScoreChanged();
+    const int tick1 = score->playlistTick1().ticks();
+    const int tick2 = score->playlistTick2().ticks();
+    for (int u = tick1; u < tick2;) {
+        const MidiRenderer::Chunk chunk = midi.getChunkAt(u);
+        if (!chunk) {
+            return false;
+        }
+        EventMap& events = chunks[chunk.utick1()];
+        events.clear();
+        midi.renderChunk(chunk, &events, ctx);
+        u = chunk.utick2();
+    }
+    EventMap merged;
+    for (const auto& c : chunks) {
+        merged.insert(c.second.cbegin(), c.second.cend());
+    }
+    MidiRenderer full(score);
+    full.setMinChunkSize(2);
+    EventMap events;
+    full.renderScore(&events, ctx);
+    return sameEvents(merged, events);
+}
+
+void TestMidi::playlistRange()
+{
+    MasterScore* score = readScore(DIR + "testPlaylistRange.mscx");
+    QVERIFY(score);
+    score->doLayout();
+
+    SynthesizerState ss;
+    MidiRenderer::Context ctx(ss);
+    MidiRenderer midi(score);
+    midi.setMinChunkSize(2);
+    std::map<int, EventMap> chunks;
+    for (MidiRenderer::Chunk c = midi.getChunkAt(0); c; c = midi.getChunkAt(c.utick2())) {
+        midi.renderChunk(c, &chunks[c.utick1()], ctx);
+    }
+    QCOMPARE(int(chunks.size()), 2);
+
+    Measure* m1 = score->firstMeasure();
+    Measure* m2 = m1->nextMeasure();
+    Measure* m3 = m2->nextMeasure();
+    auto noteAt = [](Measure* m, const Fraction& beat) {
+        Segment* s = m->findSegment(SegmentType::ChordRest, m->tick() + beat);
+        return s ? toChord(s->element(0))->upNote() : nullptr;
+    };
+
+    // mid-chunk: the range is the measure up to the end of the chord
+    Note* n = noteAt(m1, Fraction(1, 4));
+    QVERIFY(n);
+    score->setPlaylistClean();
+    score->startCmd();
+    score->undoChangePitch(n, 61, 21, 21);
+    score->endCmd();
+    QVERIFY(score->playlistDirty());
+    QCOMPARE(score->playlistTick1().ticks(), m1->tick().ticks());
+    QCOMPARE(score->playlistTick2().ticks(), (m1->tick() + Fraction(2, 4)).ticks());
+    QVERIFY(rerenderEquals(score, midi, chunks));
+
+    // the start of the tie: the range reaches into the next chunk
+    n = noteAt(m2, Fraction(3, 4));
+    QVERIFY(n && n->tieFor());
+    score->setPlaylistClean();
+    score->startCmd();
+    n->undoChangeProperty(Pid::VELO_OFFSET, 30);
+    score->endCmd();
+    QVERIFY(score->playlistDirty());
+    QCOMPARE(score->playlistTick1().ticks(), m2->tick().ticks());
+    QCOMPARE(score->playlistTick2().ticks(), (m3->tick() + Fraction(1, 4)).ticks());
+    QVERIFY(rerenderEquals(score, midi, chunks));
+
+    // the end of the tie: the range starts in the chunk before
+    n = noteAt(m3, Fraction(0, 1));
+    QVERIFY(n && n->tieBack());
+    score->setPlaylistClean();
+    score->startCmd();
+    n->undoChangeProperty(Pid::VELO_OFFSET, 20);
+    score->endCmd();
+    QVERIFY(score->playlistDirty());
+    QCOMPARE(score->playlistTick1().ticks(), m2->tick().ticks());
+    QCOMPARE(score->playlistTick2().ticks(), (m3->tick() + Fraction(1, 4)).ticks());
+    QVERIFY(rerenderEquals(score, midi, chunks));
+
+    // removing the tie: the notes no longer know the tie, the
+    // range still has to reach the end note in the next chunk
+    Note* startNote = noteAt(m2, Fraction(3, 4));
+    Note* endNote = noteAt(m3, Fraction(0, 1));
+    Tie* tie = startNote->tieFor();
+    QVERIFY(tie);
+    score->setPlaylistClean();
+    score->startCmd();
+    score->undoRemoveElement(tie);
+    score->endCmd();
+    QVERIFY(!startNote->tieFor() && !endNote->tieBack());
+    QVERIFY(score->playlistDirty());
+    QCOMPARE(score->playlistTick1().ticks(), m2->tick().ticks());
+    QCOMPARE(score->playlistTick2().ticks(), (m3->tick() + Fraction(1, 4)).ticks());
+    QVERIFY(rerenderEquals(score, midi, chunks));
+
+    // adding a tie and undoing it
+    tie = new Tie(score);
+    tie->setStartNote(startNote);
+    tie->setEndNote(endNote);
+    tie->setTrack(startNote->track());
+    score->setPlaylistClean();
+    score->startCmd();
+    score->undoAddElement(tie);
+    score->endCmd();
+    QVERIFY(startNote->tieFor() == tie && endNote->tieBack() == tie);
+    QVERIFY(score->playlistDirty());
+    QCOMPARE(score->playlistTick1().ticks(), m2->tick().ticks());
+    QCOMPARE(score->playlistTick2().ticks(), (m3->tick() + Fraction(1, 4)).ticks());
+    QVERIFY(rerenderEquals(score, midi, chunks));
+
+    score->setPlaylistClean();
+    score->undoRedo(true, 0);
+    QVERIFY(!startNote->tieFor() && !endNote->tieBack());
+    QVERIFY(score->playlistDirty());
+    QCOMPARE(score->playlistTick1().ticks(), m2->tick().ticks());
+    QCOMPARE(score->playlistTick2().ticks(), (m3->tick() + Fraction(1, 4)).ticks());
+    QVERIFY(rerenderEquals(score, midi, chunks));
+
+    delete score;
+}
+
 //---------------------------------------------------------
 //   testMidiExport
 //---------------------------------------------------------
@@ -20,6 +20,7 @@
 #include "libmscore/note.h"
 #include "libmscore/breath.h"
 #include "libmscore/segment.h"
+#include "libmscore/spanner.h"
 #include "libmscore/fingering.h"
 #include "libmscore/image.h"
 #include "libmscore/element.h"
@@ -118,6 +119,8 @@ private slots:
     {
         testPartCreation("part-54346");
     }
+
+    void deferredParts();
 };
 
 //---------------------------------------------------------
@@ -1072,6 +1075,111 @@ void TestParts::measureProperties()
 {
 }
 
+//---------------------------------------------------------
+//   linkSignature
+//    describe the links of a score and its part scores by
+//    the positions of the linked elements
+//---------------------------------------------------------
+
+static QStringList linkSignature(MasterScore* score)
+{
+    QList<ScoreElement*> elements;
+    const QList<Score*> scores = score->scoreList();
+    for (Score* s : scores) {
+        for (Staff* staff : s->staves()) {
+            elements.append(staff);
+        }
+        for (Measure* m = s->firstMeasure(); m; m = m->nextMeasure()) {
+            elements.append(m);
+            for (Segment* seg = m->first(); seg; seg = seg->next()) {
+                for (Element* e : seg->elist()) {
+                    if (!e) {
+                        continue;
+                    }
+                    elements.append(e);
+                    if (e->isChord()) {
+                        for (Note* n : toChord(e)->notes()) {
+                            elements.append(n);
+                        }
+                    }
+                }
+                for (Element* e : seg->annotations()) {
+                    elements.append(e);
+                }
+            }
+        }
+        for (auto i : s->spanner()) {
+            elements.append(i.second);
+        }
+    }
+    QHash<ScoreElement*, QString> names;
+    for (ScoreElement* e : elements) {
+        names.insert(e, QString("%1:%2:%3").arg(scores.indexOf(e->score())).arg(e->name()).arg(names.size()));
+    }
+    QStringList signature;
+    for (ScoreElement* e : elements) {
+        if (!e->links()) {
+            continue;
+        }
+        QStringList linked;
+        for (ScoreElement* le : *e->links()) {
+            linked.append(names.value(le, "?"));
+        }
+        linked.sort();
+        signature.append(names[e] + " -> " + linked.join(" "));
+    }
+    return signature;
+}
+
+//---------------------------------------------------------
+//   deferredParts
+//    part scores read after loading are linked and saved
+//    as if they had been read together with the master
+//    score
+//---------------------------------------------------------
+
+void TestParts::deferredParts()
+{
+    const char* tests[] = { "part-all-parts", "part-54346-parts", "part-breath-parts", "voices-ref" };
+    for (const char* t : tests) {
+        const QString test(t);
+        MScore::deferExcerpts = false;
+        MasterScore* eager = readScore(DIR + test + ".mscx");
+        MScore::deferExcerpts = true;
+        MasterScore* deferred = readScore(DIR + test + ".mscx");
+        QVERIFY(eager);
+        QVERIFY(deferred);
+
+        const QList<Excerpt*>& excerpts = eager->excerpts();
+        QVERIFY(!excerpts.isEmpty());
+        QCOMPARE(deferred->excerpts().size(), excerpts.size());
+        for (int i = 0; i < excerpts.size(); ++i) {
+            const Excerpt* ex = deferred->excerpts()[i];
+            QVERIFY(ex->partScoreDeferred());
+            QVERIFY(!ex->partScore());
+            QCOMPARE(ex->title(), excerpts[i]->title());
+        }
+        QCOMPARE(deferred->scoreList().size(), 1);
+
+        deferred->readDeferredExcerpts();
+        for (int i = 0; i < excerpts.size(); ++i) {
+            Excerpt* ex = deferred->excerpts()[i];
+            QVERIFY(!ex->partScoreDeferred());
+            QVERIFY(ex->partScore());
+            QCOMPARE(ex->parts().size(), excerpts[i]->parts().size());
+            QVERIFY(ex->tracks() == excerpts[i]->tracks());
+        }
+        QCOMPARE(linkSignature(deferred), linkSignature(eager));
+
+        QVERIFY(saveScore(eager, test + "-eager.mscx"));
+        QVERIFY(saveScore(deferred, test + "-deferred.mscx"));
+        QVERIFY(compareFilesFromPaths(test + "-deferred.mscx", test + "-eager.mscx"));
+
+        delete eager;
+        delete deferred;
+    }
+}
+
 QTEST_MAIN(TestParts)
 
 #include "tst_parts.moc"
@@ -0,0 +1,144 @@
+//=============================================================================
+//  MuseScore
+//  Music Composition & Notation
+//
+//  Copyright (C) 2020 Werner Schweer
+//
+//  This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License version 2
+//  as published by the Free Software Foundation and appearing in
+//  the file LICENCE.GPL
+//=============================================================================
+
+#include <QtTest/QtTest>
+
+#include "libmscore/layoutbreak.h"
+#include "libmscore/layoutprofiler.h"
+#include "libmscore/measure.h"
+#include "libmscore/page.h"
+#include "libmscore/score.h"
+#include "libmscore/system.h"
+#include "mtest/testutils.h"
+
+using namespace Ms;
+
+//---------------------------------------------------------
+//   TestRelayout
+//    an edit relayouts systems only until the layout
+//    meets the old systems again; the result must be the
+//    same as a full layout
+//---------------------------------------------------------
+
+class TestRelayout : public QObject, public MTest
+{
+    Q_OBJECT
+
+    static QStringList snapshot(Score*);
+
+private slots:
+    void initTestCase();
+    void cleanupTestCase();
+    void lineBreak();
+};
+
+//---------------------------------------------------------
+//   initTestCase
+//---------------------------------------------------------
+
+void TestRelayout::initTestCase()
+{
+    initMTest();
+    MScore::layoutProfiling = true;
+}
+
+//---------------------------------------------------------
+//   cleanupTestCase
+//---------------------------------------------------------
+
+void TestRelayout::cleanupTestCase()
+{
+    MScore::layoutProfiling = false;
+}
+
+//---------------------------------------------------------
+//   snapshot
+//    pages, system positions and measure positions
+//---------------------------------------------------------
+
+QStringList TestRelayout::snapshot(Score* score)
+{
+    QStringList sl;
+    for (const Page* page : score->pages()) {
+        for (const System* s : page->systems()) {
+            sl.append(QString("page %1 system %2 %3").arg(page->no()).arg(s->x()).arg(s->y()));
+            for (const MeasureBase* mb : s->measures()) {
+                sl.append(QString("  %1 %2 %3 %4").arg(mb->tick().ticks()).arg(mb->x()).arg(mb->y()).arg(mb->width()));
+            }
+        }
+    }
+    return sl;
+}
+
+//---------------------------------------------------------
+//   lineBreak
+//    A line break near the start adds a system; the
+//    systems shift up to the next existing break and are
+//    reused unchanged from there.
+//---------------------------------------------------------
+
+void TestRelayout::lineBreak()
+{
+    MasterScore* score = readScore("libmscore/all_elements/moonlight.mscx");
+    QVERIFY(score);
+    score->doLayout();
+    QVERIFY(score->pages().size() > 2);
+
+    Measure* m = score->firstMeasure()->nextMeasure();
+    QVERIFY(m->system() && m != m->system()->measures().back());
+
+    // the old systems after the next break are reused
+    MeasureBase* mb = m;
+    while (mb && !(mb->lineBreak() || mb->pageBreak() || mb->sectionBreak())) {
+        mb = mb->next();
+    }
+    QVERIFY(mb && mb->next());
+    std::vector<System*> reused;
+    std::vector<std::vector<MeasureBase*> > reusedMeasures;
+    for (int i = score->systems().indexOf(mb->next()->system()); i < score->systems().size(); ++i) {
+        reused.push_back(score->systems()[i]);
+        reusedMeasures.push_back(score->systems()[i]->measures());
+    }
+    QVERIFY(reused.size() > 4);
+    const int reuseTick = reused.front()->measures().front()->tick().ticks();
+
+    score->startCmd();
+    m->undoSetBreak(true, LayoutBreak::LINE);
+    score->endCmd();
+
+    QCOMPARE(m->system()->measures().back(), m);
+    for (size_t i = 0; i < reused.size(); ++i) {
+        QVERIFY(score->systems().contains(reused[i]));
+        QVERIFY(reused[i]->measures() == reusedMeasures[i]);
+    }
+    // only the systems before the reused ones were collected again
+    const QJsonArray collected = score->layoutProfiler()->toJson()["systems"].toArray();
+    QVERIFY(!collected.isEmpty());
+    for (const QJsonValue& v : collected) {
+        QVERIFY(v.toObject()["tick"].toInt() < reuseTick);
+    }
+
+    QStringList incremental = snapshot(score);
+    score->doLayout();
+    QCOMPARE(incremental, snapshot(score));
+
+    // and back
+    score->undoRedo(true, 0);
+    incremental = snapshot(score);
+    score->doLayout();
+    QCOMPARE(incremental, snapshot(score));
+
+    delete score;
+}
+
+QTEST_MAIN(TestRelayout)
+#include "tst_relayout.moc"
@@ -15,6 +15,7 @@
 #include "libmscore/score.h"
 #include "libmscore/measure.h"
 #include "libmscore/repeatlist.h"
+#include "libmscore/tempo.h"
 
 #define DIR QString("libmscore/repeat/")
 
@@ -28,6 +29,7 @@ class TestRepeat : public QObject, public MTest
 {
     Q_OBJECT
     void repeat(const char* f1, const QString& ref);
+    void compareTimeIndex(const RepeatList& rl);
 
 private slots:
     void initTestCase();
@@ -112,6 +114,8 @@ private slots:
     void repeat49() { repeat("repeat49.mscx", "1;2;3;1;2;3;4;5;6;3;1;2;3;4;7"); }   // D.S. with playRepeats
     void repeat50() { repeat("repeat50.mscx", "1;2;3;4;1;2;3;4;5;6;1;2;3;4;1;2;3;7"); }   // D.S. with playRepeats with ToCoda inside the repeat
     void repeat51() { repeat("repeat51.mscx", "1;2;3;4;5;6;3;4;7;8;9;3;4;10;11"); }   //#270332 twice D.S. with playRepeats to same target with different Coda
+
+    void timeIndex();
 };
 
 //---------------------------------------------------------
@@ -151,5 +155,81 @@ void TestRepeat::repeat(const char* f1, const QString& ref)
     delete score;
 }
 
+//---------------------------------------------------------
+//   compareTimeIndex
+//    the indexed conversions must agree with the walk
+//    through the segment list and the tempo map
+//---------------------------------------------------------
+
+void TestRepeat::compareTimeIndex(const RepeatList& rl)
+{
+    std::vector<int> uticks;
+    for (const RepeatSegment* rs : rl) {
+        uticks.push_back(rs->utick);
+        uticks.push_back(rs->utick + rs->len() - 1);
+    }
+    // an odd step to hit ticks off the beat grid
+    for (int utick = 0; utick <= rl.ticks(); utick += MScore::division / 4 + 1) {
+        uticks.push_back(utick);
+    }
+    std::sort(uticks.begin(), uticks.end());
+
+    std::vector<qreal> utimes = rl.utick2utime(uticks);
+    QCOMPARE(utimes.size(), uticks.size());
+    for (size_t i = 0; i < uticks.size(); ++i) {
+        QCOMPARE(rl.utick2utime(uticks[i]), rl.linearUtick2utime(uticks[i]));
+        QCOMPARE(utimes[i], rl.linearUtick2utime(uticks[i]));
+    }
+
+    const qreal endTime = rl.linearUtick2utime(rl.ticks());
+    for (qreal t = 0.0; t < endTime; t += 0.0173) {
+        QCOMPARE(rl.utime2utick(t), rl.linearUtime2utick(t));
+    }
+}
+
+//---------------------------------------------------------
+//   timeIndex
+//    repeats with tempo changes and pauses, and a time
+//    index built for a new relative tempo the way the
+//    sequencer does it
+//---------------------------------------------------------
+
+void TestRepeat::timeIndex()
+{
+    for (const char* f : { "repeat14.mscx", "repeat23.mscx", "repeat36.mscx" }) {
+        MasterScore* score = readScore(DIR + f);
+        QVERIFY(score);
+        score->setExpandRepeats(true);
+        const RepeatList& rl = score->repeatList();
+        QVERIFY(rl.size() > 1);
+
+        TempoMap* tempomap = score->tempomap();
+        const int endTick = score->lastMeasure()->endTick().ticks();
+        for (int tick = 0, n = 0; tick < endTick; tick += 5 * MScore::division, ++n) {
+            tempomap->setTempo(tick, 1.0 + 0.25 * (n % 5));
+            if (n % 3 == 1) {
+                tempomap->setPause(tick, 0.5);
+            }
+        }
+        score->updateRepeatListTempo();
+        compareTimeIndex(rl);
+
+        TempoMap relTempomap(*tempomap);
+        relTempomap.setRelTempo(1.5);
+        TimeIndex* index = new TimeIndex(&rl, &relTempomap);
+        tempomap->setRelTempo(1.5);
+        QCOMPARE(index->tempoSN(), tempomap->tempoSN());
+        score->publishRepeatListTimeIndex(index);
+        score->updateRepeatListSegmentTimes();      // segment times for the linear reference
+        score->collectRepeatListTimeIndices();
+        for (int utick = 0; utick <= rl.ticks(); utick += MScore::division / 4 + 1) {
+            QCOMPARE(index->utick2utime(utick), rl.linearUtick2utime(utick));
+        }
+        compareTimeIndex(rl);
+
+        delete score;
+    }
+}
+
 QTEST_MAIN(TestRepeat)
 #include "tst_repeat.moc"
@@ -0,0 +1,110 @@
+//=============================================================================
+//  MuseScore
+//  Music Composition & Notation
+//
+//  Copyright (C) 2020 Werner Schweer
+//
+//  This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License version 2
+//  as published by the Free Software Foundation and appearing in
+//  the file LICENCE.GPL
+//=============================================================================
+
+#include <random>
+#include <QtTest/QtTest>
+
+#include "libmscore/skyline.h"
+#include "mtest/testutils.h"
+
+using namespace Ms;
+
+//---------------------------------------------------------
+//   TestSkyline
+//---------------------------------------------------------
+
+class TestSkyline : public QObject, public MTest
+{
+    Q_OBJECT
+
+    std::mt19937 rng { 4711 };
+
+    qreal random(qreal from, qreal to) { return std::uniform_real_distribution<qreal>(from, to)(rng); }
+    void fill(SkylineLine& line, int n, qreal x0, qreal x1);
+    void compare(const SkylineLine& a, const SkylineLine& b);
+
+private slots:
+    void initTestCase();
+    void minDistance();
+};
+
+//---------------------------------------------------------
+//   initTestCase
+//---------------------------------------------------------
+
+void TestSkyline::initTestCase()
+{
+    initMTest();
+}
+
+//---------------------------------------------------------
+//   fill
+//    add n random rectangles between x0 and x1
+//---------------------------------------------------------
+
+void TestSkyline::fill(SkylineLine& line, int n, qreal x0, qreal x1)
+{
+    for (int i = 0; i < n; ++i) {
+        const qreal x = random(x0, x1);
+        const qreal w = random(0.1, (x1 - x0) / 10 + 0.2);
+        const qreal y = random(-20.0, 20.0);
+        line.add(x, y, w);
+    }
+}
+
+//---------------------------------------------------------
+//   compare
+//    the indexed minDistance() must give the result of the
+//    linear walk whenever the lines overlap at all
+//---------------------------------------------------------
+
+void TestSkyline::compare(const SkylineLine& a, const SkylineLine& b)
+{
+    const qreal linear  = a.linearMinDistance(b);
+    const qreal indexed = a.minDistance(b);
+    if (linear > -100000.0) {
+        QCOMPARE(indexed, linear);
+    } else {
+        QVERIFY(indexed <= -100000.0);
+    }
+}
+
+//---------------------------------------------------------
+//   minDistance
+//---------------------------------------------------------
+
+void TestSkyline::minDistance()
+{
+    for (int run = 0; run < 200; ++run) {
+        // a staff skyline against element skylines anywhere on it
+        SkylineLine staffSouth(false);
+        SkylineLine staffNorth(true);
+        const int n = 50 + run * 5;
+        fill(staffSouth, n, 0.0, 500.0);
+        fill(staffNorth, n, 0.0, 500.0);
+
+        for (int e = 0; e < 10; ++e) {
+            const qreal x = random(0.0, 520.0);
+            SkylineLine elementNorth(true);
+            SkylineLine elementSouth(false);
+            fill(elementNorth, 1 + e % 4, x, x + 8.0);
+            fill(elementSouth, 1 + e % 4, x, x + 8.0);
+
+            compare(staffSouth, elementNorth);      // element below the staff
+            compare(elementSouth, staffNorth);      // element above the staff
+        }
+    }
+}
+
+QTEST_MAIN(TestSkyline)
+
+#include "tst_skyline.moc"
@@ -0,0 +1,195 @@
+//=============================================================================
+//  MuseScore
+//  Music Composition & Notation
+//
+//  Copyright (C) 2020 Werner Schweer
+//
+//  This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License version 2
+//  as published by the Free Software Foundation and appearing in
+//  the file LICENCE.GPL
+//=============================================================================
+
+#include <QtTest/QtTest>
+
+#include "libmscore/xml.h"
+#include "mtest/testutils.h"
+
+using namespace Ms;
+
+//---------------------------------------------------------
+//   TestXmlWriter
+//    the output must not differ from the QTextStream
+//    based writer used for the reference files
+//---------------------------------------------------------
+
+class TestXmlWriter : public QObject, public MTest
+{
+    Q_OBJECT
+
+    template<typename T> QByteArray streamed(const char* name, T val);
+
+private slots:
+    void initTestCase();
+    void numbers();
+    void strings();
+    void elements();
+    void encoding();
+};
+
+//---------------------------------------------------------
+//   initTestCase
+//---------------------------------------------------------
+
+void TestXmlWriter::initTestCase()
+{
+    initMTest();
+}
+
+//---------------------------------------------------------
+//   streamed
+//    <name>val</name> as written by a QTextStream
+//---------------------------------------------------------
+
+template<typename T> QByteArray TestXmlWriter::streamed(const char* name, T val)
+{
+    QByteArray ba;
+    QTextStream ts(&ba);
+    ts.setCodec("UTF-8");
+    ts << "<" << name << ">" << val << "</" << name << ">\n";
+    ts.flush();
+    return ba;
+}
+
+//---------------------------------------------------------
+//   numbers
+//---------------------------------------------------------
+
+void TestXmlWriter::numbers()
+{
+    const double doubles[] = { 0.0, -0.0, 1.0, -1.0, 0.5, 0.1, 1.0 / 3.0, -2.75, 12.0, 999999.0, 1e6, 1234567.0,
+                               123456.7, 1e-5, 1.5e-7, 2.5e21, -99999.99, 1e300 };
+    const int ints[] = { 0, 1, -1, 42, -480, 1920, 2147483647, -2147483647 - 1 };
+
+    for (double d : doubles) {
+        QBuffer buffer;
+        buffer.open(QIODevice::WriteOnly);
+        {
+            XmlWriter xml(0, &buffer);
+            xml.tag("d", d);
+        }
+        QCOMPARE(buffer.data(), streamed("d", d));
+    }
+    for (int i : ints) {
+        QBuffer buffer;
+        buffer.open(QIODevice::WriteOnly);
+        {
+            XmlWriter xml(0, &buffer);
+            xml.tag("i", i);
+            xml.tag("l", QVariant(qlonglong(i) * 3));
+        }
+        QCOMPARE(buffer.data(), streamed("i", i) + streamed("l", qlonglong(i) * 3));
+    }
+
+    QBuffer buffer;
+    buffer.open(QIODevice::WriteOnly);
+    {
+        XmlWriter xml(0, &buffer);
+        xml.tag("pos", QPointF(0.25, -3.0));
+        xml.tag("frac", Fraction(3, 8));
+    }
+    QCOMPARE(buffer.data(), QByteArray("<pos x=\"0.25\" y=\"-3\"/>\n<frac>3/8</frac>\n"));
+}
+
+//---------------------------------------------------------
+//   strings
+//---------------------------------------------------------
+
+void TestXmlWriter::strings()
+{
+    const QString strings[] = {
+        "plain", "a < b && c > \"d\"", QString("tab\tcr\rbell") + QChar(7), QString::fromUtf8("Dvořák – Allegro ♪"),
+        QString::fromUtf8("clef 𝄞 <g>")
+    };
+    for (const QString& s : strings) {
+        QBuffer buffer;
+        buffer.open(QIODevice::WriteOnly);
+        {
+            XmlWriter xml(0, &buffer);
+            xml.tag("s", s);
+        }
+        QCOMPARE(buffer.data(), streamed("s", XmlWriter::xmlString(s)));
+    }
+}
+
+//---------------------------------------------------------
+//   elements
+//    indentation and flushing of complete documents
+//---------------------------------------------------------
+
+void TestXmlWriter::elements()
+{
+    QBuffer buffer;
+    buffer.open(QIODevice::WriteOnly);
+    XmlWriter xml(0, &buffer);
+    xml.header();
+    xml.stag("museScore version=\"3.01\"");
+    xml.stag("Staff id=\"1\"");
+    xml.tagE("Clef");
+    xml.etag();
+    xml.etag();
+    // readable while the writer exists
+    QCOMPARE(buffer.data(), QByteArray("<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+                                       "<museScore version=\"3.01\">\n"
+                                       "  <Staff id=\"1\">\n"
+                                       "    <Clef/>\n"
+                                       "    </Staff>\n"
+                                       "  </museScore>\n"));
+
+    QString s;
+    XmlWriter sxml(0);
+    sxml.setString(&s, QIODevice::WriteOnly);
+    sxml.stag("a");
+    sxml.tag("b", QString::fromUtf8("ü"));
+    sxml.flush();
+    QCOMPARE(s, QString::fromUtf8("<a>\n  <b>ü</b>\n"));
+}
+
+//---------------------------------------------------------
+//   encoding
+//    the output is UTF-8 on any device set later, as the
+//    MusicXML exporter uses it; QTextStream::setDevice()
+//    reset the codec of the old writer to the locale's
+//---------------------------------------------------------
+
+void TestXmlWriter::encoding()
+{
+    const QString title = QString::fromUtf8("Dvořák – Humoreske ♪ 𝄞");
+
+    QBuffer buffer;
+    buffer.open(QIODevice::WriteOnly);
+    XmlWriter xml(0);
+    xml.setDevice(&buffer);
+    xml << "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n";
+    xml.stag("score-partwise version=\"3.1\"");
+    xml.tag("work-title", title);
+    xml << title << "\n";
+    xml.etag();
+
+    QByteArray expected;
+    QTextStream ts(&expected);
+    ts.setCodec("UTF-8");
+    ts << "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+       << "<score-partwise version=\"3.1\">\n"
+       << "  <work-title>" << title << "</work-title>\n"
+       << title << "\n"
+       << "  </score-partwise>\n";
+    ts.flush();
+
+    QCOMPARE(buffer.data(), expected);
+    QCOMPARE(QString::fromUtf8(buffer.data()).count(title), 2);
+}
+
+QTEST_MAIN(TestXmlWriter)
+
+#include "tst_xmlwriter.moc"
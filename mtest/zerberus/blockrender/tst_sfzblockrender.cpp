@@ -0,0 +1,130 @@
+//=============================================================================
+//  MuseScore
+//  Music Composition & Notation
+//
+//  Copyright (C) 2020 Werner Schweer
+//
+//  This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License version 2
+//  as published by the Free Software Foundation and appearing in
+//  the file LICENCE.GPL
+//=============================================================================
+
+#include <QtTest/QtTest>
+
+#include "mtest/testutils.h"
+
+#include "audio/midi/zerberus/channel.h"
+#include "audio/midi/zerberus/instrument.h"
+#include "audio/midi/zerberus/voice.h"
+#include "audio/midi/zerberus/zerberus.h"
+#include "audio/midi/zerberus/zone.h"
+#include "mscore/preferences.h"
+
+using namespace Ms;
+
+//---------------------------------------------------------
+//   TestSfzBlockRender
+//    the block renderer Voice::process() must produce the
+//    output of the per frame renderer Voice::processFrames()
+//---------------------------------------------------------
+
+class TestSfzBlockRender : public QObject, public MTest
+{
+    Q_OBJECT
+
+    Zerberus* synth;
+
+private slots:
+    void initTestCase();
+    void blockMatchesFrames_data();
+    void blockMatchesFrames();
+};
+
+//---------------------------------------------------------
+//   initTestCase
+//---------------------------------------------------------
+
+void TestSfzBlockRender::initTestCase()
+{
+    initMTest();
+    synth = new Zerberus();
+    preferences.setPreference(PREF_APP_PATHS_MYSOUNDFONTS, root);
+    synth->init(44100.0f);
+    QVERIFY(synth->loadInstrument("blockRender.sfz"));
+    QCOMPARE(synth->instrument(0)->zones().size(), size_t(6));
+}
+
+//---------------------------------------------------------
+//   blockMatchesFrames_data
+//    every zone of blockRender.sfz: mono and stereo, no
+//    loop, continuous and sustain loop, with and without a
+//    low cutoff; rendered in periods shorter than, equal to
+//    and longer than a block
+//---------------------------------------------------------
+
+void TestSfzBlockRender::blockMatchesFrames_data()
+{
+    QTest::addColumn<int>("zone");
+    QTest::addColumn<int>("period");
+
+    const int periods[] = { 1, 37, VOICE_BLOCK, 100, 256 };
+    for (int zone = 0; zone < 6; ++zone) {
+        for (int period : periods) {
+            QTest::newRow(qPrintable(QString("zone %1 period %2").arg(zone).arg(period))) << zone << period;
+        }
+    }
+}
+
+//---------------------------------------------------------
+//   blockMatchesFrames
+//    play a note for 2000 frames, release it and compare
+//    both renderers sample by sample until the voices end
+//---------------------------------------------------------
+
+void TestSfzBlockRender::blockMatchesFrames()
+{
+    QFETCH(int, zone);
+    QFETCH(int, period);
+
+    const std::list<Zone*>& zones = synth->instrument(0)->zones();
+    const Zone* z = *std::next(zones.begin(), zone);
+    Channel* channel = synth->channel(0);
+
+    Voice block(synth);
+    Voice frames(synth);
+    block.start(channel, z->keyLo, 100, z, 0.0);
+    frames.start(channel, z->keyLo, 100, z, 0.0);
+
+    const int RELEASE_AT = 2000;
+    const int MAX_FRAMES = 40000;
+    std::vector<float> a(2 * period);
+    std::vector<float> b(2 * period);
+    int pos = 0;
+    bool released = false;
+    while (!frames.isOff() && pos < MAX_FRAMES) {
+        if (!released && pos >= RELEASE_AT) {
+            block.stop();
+            frames.stop();
+            released = true;
+        }
+        std::fill(a.begin(), a.end(), 0.0f);
+        std::fill(b.begin(), b.end(), 0.0f);
+        block.process(period, a.data());
+        frames.processFrames(period, b.data());
+        for (int i = 0; i < 2 * period; ++i) {
+            const float tolerance = 1e-6f * std::max(1.0f, std::fabs(b[i]));
+            QVERIFY2(std::fabs(a[i] - b[i]) <= tolerance,
+                     qPrintable(QString("frame %1 channel %2: %3 != %4")
+                                .arg(pos + i / 2).arg(i % 2).arg(a[i]).arg(b[i])));
+        }
+        QCOMPARE(block.isOff(), frames.isOff());
+        pos += period;
+    }
+    QVERIFY(released);
+    QVERIFY(frames.isOff());
+}
+
+QTEST_MAIN(TestSfzBlockRender)
+
+#include "tst_sfzblockrender.moc"
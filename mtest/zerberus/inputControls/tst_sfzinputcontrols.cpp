@@ -31,7 +31,7 @@ class TestSfzInputControls : public QObject, public MTest
 
     Zerberus * synth;
     Channel* channel;
-    std::list<Zone*>::iterator zoneIterator;
+    std::list<Zone*>::const_iterator zoneIterator;
 
 private slots:
     void initTestCase();
@@ -110,7 +110,7 @@ void TestSfzInputControls::testInputRand()
 
 void TestSfzInputControls::testInputSeq()
 {
-    std::list<Zone*>::iterator beforeIterator = zoneIterator;
+    std::list<Zone*>::const_iterator beforeIterator = zoneIterator;
     zoneIterator++;
     QCOMPARE(true, (*beforeIterator)->match(channel, 43, 127, Trigger::ATTACK, 0.0f, 0, 0));
     QCOMPARE(false, (*zoneIterator)->match(channel, 43, 127, Trigger::ATTACK, 0.0f, 0, 0));
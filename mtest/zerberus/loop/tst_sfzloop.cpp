@@ -61,7 +61,7 @@ void TestSfzLoop::testEnvelopesParsing()
 {
     QCOMPARE(synth->instrument(0)->zones().size(), (size_t)4);
 
-    std::list<Zone*>::iterator curZone = synth->instrument(0)->zones().begin();
+    std::list<Zone*>::const_iterator curZone = synth->instrument(0)->zones().begin();
     QCOMPARE((*curZone)->keyLo, (char)20);
     QCOMPARE((*curZone)->keyHi, (char)20);
     QCOMPARE((*curZone)->keyBase, (char)20);
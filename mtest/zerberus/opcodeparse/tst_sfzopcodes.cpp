@@ -51,7 +51,7 @@ void TestOpcodes::testOpcodes()
     preferences.setPreference(PREF_APP_PATHS_MYSOUNDFONTS, root);
     synth->loadInstrument("opcodeTest.sfz");
 
-    std::list<Zone*>::iterator curZone = synth->instrument(0)->zones().begin();
+    std::list<Zone*>::const_iterator curZone = synth->instrument(0)->zones().begin();
 
     QCOMPARE(synth->instrument(0)->zones().size(), (size_t)12);
     QCOMPARE((*curZone)->keyLo, (char)60);
@@ -0,0 +1,247 @@
+//=============================================================================
+//  MuseScore
+//  Music Composition & Notation
+//
+//  Copyright (C) 2020 Werner Schweer
+//
+//  This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License version 2
+//  as published by the Free Software Foundation and appearing in
+//  the file LICENCE.GPL
+//=============================================================================
+
+#include <QtTest/QtTest>
+
+#include "mtest/testutils.h"
+
+#include "audiofile/audiofile.h"
+#include "audio/midi/zerberus/samplecache.h"
+
+using namespace Ms;
+
+//---------------------------------------------------------
+//   TestSampleCache
+//    memory budget of the Zerberus sample cache, trimming
+//    of the cache directory and recovery from cache files
+//    left by an interrupted or concurrent create()
+//---------------------------------------------------------
+
+class TestSampleCache : public QObject, public MTest
+{
+    Q_OBJECT
+
+    QString samplePath;
+
+    void writeFile(const QString& name, qint64 size, const QDateTime& time);
+
+private slots:
+    void initTestCase();
+    void init();
+    void memoryBudget();
+    void trimLeastRecentlyUsed();
+    void trimStaleParts();
+    void createAndFind();
+    void createExisting();
+    void damagedFile();
+};
+
+//---------------------------------------------------------
+//   initTestCase
+//---------------------------------------------------------
+
+void TestSampleCache::initTestCase()
+{
+    initMTest();
+    QStandardPaths::setTestModeEnabled(true);      // keep the user's cache directory out of it
+    samplePath = root + "/zerberus/sample.wav";
+    QVERIFY(QFileInfo::exists(samplePath));
+}
+
+//---------------------------------------------------------
+//   init
+//    every test starts with an empty cache directory
+//---------------------------------------------------------
+
+void TestSampleCache::init()
+{
+    QDir dir(SampleCache::cacheDir());
+    QVERIFY(dir.removeRecursively());
+    QVERIFY(QDir().mkpath(SampleCache::cacheDir()));
+}
+
+//---------------------------------------------------------
+//   writeFile
+//---------------------------------------------------------
+
+void TestSampleCache::writeFile(const QString& name, qint64 size, const QDateTime& time)
+{
+    QFile f(SampleCache::cacheDir() + "/" + name);
+    QVERIFY(f.open(QIODevice::WriteOnly));
+    QVERIFY(f.resize(size));
+    QVERIFY(f.setFileTime(time, QFileDevice::FileModificationTime));
+}
+
+//---------------------------------------------------------
+//   memoryBudget
+//    reserve() fails beyond the budget unless forced
+//---------------------------------------------------------
+
+void TestSampleCache::memoryBudget()
+{
+    const qint64 budget = SampleCache::budget;
+    const qint64 used   = SampleCache::used();
+    SampleCache::budget = used + 1000;
+
+    QVERIFY(SampleCache::reserve(600));
+    QVERIFY(!SampleCache::reserve(600));
+    QCOMPARE(SampleCache::used(), used + 600);
+    QVERIFY(SampleCache::reserve(600, true));
+    QCOMPARE(SampleCache::used(), used + 1200);
+    SampleCache::release(1200);
+    QVERIFY(SampleCache::reserve(1000));
+    SampleCache::release(1000);
+    QCOMPARE(SampleCache::used(), used);
+
+    // a budget of 0 is unlimited
+    SampleCache::budget = 0;
+    QVERIFY(SampleCache::reserve(qint64(1) << 40));
+    SampleCache::release(qint64(1) << 40);
+
+    SampleCache::budget = budget;
+}
+
+//---------------------------------------------------------
+//   trimLeastRecentlyUsed
+//    cache files are removed oldest first until the rest
+//    fits into the disk budget
+//---------------------------------------------------------
+
+void TestSampleCache::trimLeastRecentlyUsed()
+{
+    const QDateTime now = QDateTime::currentDateTime();
+    writeFile("a.pcm", 1000, now.addSecs(-300));
+    writeFile("b.pcm", 1000, now.addSecs(-200));
+    writeFile("c.pcm", 1000, now.addSecs(-100));
+    writeFile("d.pcm", 1000, now);
+
+    const qint64 diskBudget = SampleCache::diskBudget;
+    SampleCache::diskBudget = 2500;
+    SampleCache::trim();
+    SampleCache::diskBudget = diskBudget;
+
+    QDir dir(SampleCache::cacheDir());
+    QCOMPARE(dir.entryList({ "*.pcm" }, QDir::Files, QDir::Name), QStringList({ "c.pcm", "d.pcm" }));
+}
+
+//---------------------------------------------------------
+//   trimStaleParts
+//    a temporary file left by an interrupted create() is
+//    removed once it is older than a day; a recent one may
+//    still be written by another instance and is kept
+//---------------------------------------------------------
+
+void TestSampleCache::trimStaleParts()
+{
+    const QDateTime now = QDateTime::currentDateTime();
+    writeFile("stale.part", 1000, now.addDays(-2));
+    writeFile("recent.part", 1000, now);
+
+    SampleCache::trim();
+
+    QDir dir(SampleCache::cacheDir());
+    QCOMPARE(dir.entryList({ "*.part" }, QDir::Files), QStringList({ "recent.part" }));
+}
+
+//---------------------------------------------------------
+//   createAndFind
+//    create() renames the complete file into place; find()
+//    maps it again with the sample data of the wav file
+//---------------------------------------------------------
+
+void TestSampleCache::createAndFind()
+{
+    QFile f(samplePath);
+    QVERIFY(f.open(QIODevice::ReadOnly));
+    QByteArray buf = f.readAll();
+    AudioFile a;
+    QVERIFY(a.open(buf));
+    const qint64 frames = a.frames();
+    const int channel   = a.channels();
+    std::vector<short> expected(frames * channel);
+    QCOMPARE(a.readData(expected.data(), frames), frames);
+
+    AudioFile b;
+    QVERIFY(b.open(buf));
+    std::shared_ptr<PcmMap> pcm = SampleCache::create(samplePath, b);
+    QVERIFY(pcm);
+    QDir dir(SampleCache::cacheDir());
+    QVERIFY(dir.entryList({ "*.part" }, QDir::Files).isEmpty());
+    QCOMPARE(dir.entryList({ "*.pcm" }, QDir::Files).size(), 1);
+
+    std::shared_ptr<PcmMap> found = SampleCache::find(samplePath);
+    QVERIFY(found);
+    QCOMPARE(found->header()->frames, frames);
+    QCOMPARE(found->header()->channel, channel);
+    // the data starts one frame in, like Sample::data()
+    QVERIFY(std::equal(expected.begin(), expected.end(), found->data() + channel));
+}
+
+//---------------------------------------------------------
+//   createExisting
+//    if the cache file was created meanwhile, by another
+//    instance, the rename fails: the temporary file is
+//    removed and the existing file used
+//---------------------------------------------------------
+
+void TestSampleCache::createExisting()
+{
+    QFile f(samplePath);
+    QVERIFY(f.open(QIODevice::ReadOnly));
+    QByteArray buf = f.readAll();
+
+    AudioFile a;
+    QVERIFY(a.open(buf));
+    std::shared_ptr<PcmMap> first = SampleCache::create(samplePath, a);
+    QVERIFY(first);
+
+    AudioFile b;
+    QVERIFY(b.open(buf));
+    std::shared_ptr<PcmMap> second = SampleCache::create(samplePath, b);
+    QVERIFY(second);
+    QCOMPARE(second->size, first->size);
+    QVERIFY(memcmp(second->map, first->map, first->size) == 0);
+
+    QDir dir(SampleCache::cacheDir());
+    QVERIFY(dir.entryList({ "*.part" }, QDir::Files).isEmpty());
+    QCOMPARE(dir.entryList({ "*.pcm" }, QDir::Files).size(), 1);
+}
+
+//---------------------------------------------------------
+//   damagedFile
+//    a cache file whose size does not match its header is
+//    removed by find(), the sample is then decoded again
+//---------------------------------------------------------
+
+void TestSampleCache::damagedFile()
+{
+    QFile f(samplePath);
+    QVERIFY(f.open(QIODevice::ReadOnly));
+    QByteArray buf = f.readAll();
+    AudioFile a;
+    QVERIFY(a.open(buf));
+    QString fileName;
+    {
+        std::shared_ptr<PcmMap> pcm = SampleCache::create(samplePath, a);
+        QVERIFY(pcm);
+        fileName = pcm->file.fileName();
+    }
+    QFile cacheFile(fileName);
+    QVERIFY(cacheFile.resize(cacheFile.size() - 2));
+
+    QVERIFY(!SampleCache::find(samplePath));
+    QVERIFY(!QFileInfo::exists(fileName));
+}
+
+QTEST_MAIN(TestSampleCache)
+
+#include "tst_samplecache.moc"
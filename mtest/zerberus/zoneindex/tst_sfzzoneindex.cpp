@@ -0,0 +1,126 @@
+//=============================================================================
+//  MuseScore
+//  Music Composition & Notation
+//
+//  Copyright (C) 2020 Werner Schweer
+//
+//  This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License version 2
+//  as published by the Free Software Foundation and appearing in
+//  the file LICENCE.GPL
+//=============================================================================
+
+#include <QtTest/QtTest>
+
+#include "mtest/testutils.h"
+
+#include "audio/midi/zerberus/channel.h"
+#include "audio/midi/zerberus/instrument.h"
+#include "audio/midi/zerberus/zerberus.h"
+#include "audio/midi/zerberus/zone.h"
+#include "mscore/preferences.h"
+
+using namespace Ms;
+
+//---------------------------------------------------------
+//   TestSfzZoneIndex
+//    the zone index must find the same zones as calling
+//    Zone::match() for every zone of the instrument
+//---------------------------------------------------------
+
+class TestSfzZoneIndex : public QObject, public MTest
+{
+    Q_OBJECT
+
+    Zerberus* synth;
+
+private slots:
+    void initTestCase();
+    void indexMatchesScan();
+};
+
+//---------------------------------------------------------
+//   initTestCase
+//---------------------------------------------------------
+
+void TestSfzZoneIndex::initTestCase()
+{
+    initMTest();
+    synth = new Zerberus();
+    preferences.setPreference(PREF_APP_PATHS_MYSOUNDFONTS, root);
+    synth->init(44100.0f);
+    QVERIFY(synth->loadInstrument("zoneIndex.sfz"));
+}
+
+//---------------------------------------------------------
+//   indexMatchesScan
+//    For every trigger, key and velocity the zones matched
+//    through the index are the zones matched by a linear
+//    scan, in the same order. Zone::match() advances the
+//    round robin sequence, so both are run from the same
+//    sequence state and must leave the same state behind;
+//    every trigger is played three times to go round.
+//---------------------------------------------------------
+
+void TestSfzZoneIndex::indexMatchesScan()
+{
+    const ZInstrument* instrument = synth->instrument(0);
+    QVERIFY(instrument);
+    Channel* channel = synth->channel(0);
+    const std::list<Zone*>& zones = instrument->zones();
+    QCOMPARE(zones.size(), size_t(18));
+
+    auto seqState = [&zones]() {
+        std::vector<int> s;
+        for (const Zone* z : zones) {
+            s.push_back(z->seq);
+        }
+        return s;
+    };
+    auto setSeqState = [&zones](const std::vector<int>& s) {
+        auto i = s.begin();
+        for (Zone* z : zones) {
+            z->seq = *i++;
+        }
+    };
+
+    const Trigger triggers[] = { Trigger::ATTACK, Trigger::RELEASE, Trigger::FIRST, Trigger::LEGATO, Trigger::CC };
+    int matched = 0;
+    for (Trigger trigger : triggers) {
+        for (int key = 0; key < 128; ++key) {
+            for (int velo = 0; velo < 128; ++velo) {
+                const int cc = 23;
+                const int ccVal = velo;
+                for (int round = 0; round < 3; ++round) {
+                    const double random = ((key + velo + round) % 4) / 4.0;
+                    const std::vector<int> before = seqState();
+
+                    std::vector<Zone*> scan;
+                    for (Zone* z : zones) {
+                        if (z->match(channel, key, velo, trigger, random, cc, ccVal)) {
+                            scan.push_back(z);
+                        }
+                    }
+                    const std::vector<int> afterScan = seqState();
+                    setSeqState(before);
+
+                    std::vector<Zone*> index;
+                    for (Zone* z : instrument->zones(key, velo, trigger)) {
+                        if (z->match(channel, key, velo, trigger, random, cc, ccVal)) {
+                            index.push_back(z);
+                        }
+                    }
+                    QVERIFY2(scan == index, qPrintable(QString("trigger %1 key %2 velo %3 round %4")
+                                                       .arg(int(trigger)).arg(key).arg(velo).arg(round)));
+                    QVERIFY(seqState() == afterScan);
+                    matched += int(index.size());
+                }
+            }
+        }
+    }
+    QVERIFY(matched > 0);
+}
+
+QTEST_MAIN(TestSfzZoneIndex)
+
+#include "tst_sfzzoneindex.moc"
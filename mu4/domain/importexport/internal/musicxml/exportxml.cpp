@@ -6731,7 +6731,6 @@ void ExportMusicXml::write(QIODevice* dev)
     }
 
     _xml.setDevice(dev);
-    _xml.setCodec("UTF-8");
     _xml << "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n";
     _xml
         <<
@@ -6814,7 +6813,6 @@ static void writeMxlArchive(Score* score, MQZipWriter& zipwriter, const QString&
 
     XmlWriter xml(score);
     xml.setDevice(&cbuf);
-    xml.setCodec("UTF-8");
     xml << "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n";
     xml.stag("container");
     xml.stag("rootfiles");
@@ -235,7 +235,6 @@ void Notation::paint(QPainter* p, const QRect&)
             continue;
         }
 
-        e->itemDiscovered = false;
         QPointF pos(e->pagePos());
         //LOGI() << e->name() << ", x: " << pos.x() << ", y: " << pos.y() << "\n";
 
@@ -296,6 +295,7 @@ mu::RetVal<MasterScore*> Notation::newScore(const ScoreCreateOptions& scoreOptio
             result.ret = ret;
             return result;
         }
+        tscore->readDeferredExcerpts();        // parts of the template are copied below
         score->setStyle(tscore->style());
 
         // create instruments from template
@@ -451,7 +451,6 @@ QList<Ms::Element*> NotationInteraction::hitElements(const QPointF& p_in, float
     //! -------
 
     for (Ms::Element* e : el) {
-        e->itemDiscovered = 0;
         if (!e->selectable() || e->isPage()) {
             continue;
         }
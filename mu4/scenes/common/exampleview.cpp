@@ -172,7 +172,6 @@ void ExampleView::drawBackground(QPainter* p, const QRectF& r) const
 void ExampleView::drawElements(QPainter& painter, const QList<Element*>& el)
 {
     for (Element* e : el) {
-        e->itemDiscovered = 0;
         QPointF pos(e->pagePos());
         painter.translate(pos);
         e->draw(&painter);
@@ -43,8 +43,15 @@
 #include "qzipreader_p.h"
 #include "qzipwriter_p.h"
 
+#include <QtCore/qbuffer.h>
+#include <QtCore/qmutex.h>
+#include <QtCore/qwaitcondition.h>
+
 #include <zlib.h>
 
+#include <deque>
+#include <thread>
+
 // Zip standard version for archives handled by this API
 // (actually, the only basic support of this version is implemented but it is enough for now)
 #define ZIP_VERSION 20
@@ -531,6 +538,7 @@ public:
     enum EntryType { Directory, File, Symlink };
 
     void addEntry(EntryType type, const QString &fileName, const QByteArray &contents);
+    void writeEntry(EntryType type, const QString &fileName, const MQZipWriter::CompressedFile &file);
 };
 
 LocalFileHeader CentralFileHeader::toLocalHeader() const
@@ -648,59 +656,28 @@ void MQZipWriterPrivate::addEntry(EntryType type, const QString &fileName, const
     ZDEBUG() << "adding" << entryTypes[type] <<":" << fileName.toUtf8().data() << (type == 2 ? QByteArray(" -> " + contents).constData() : "");
 #endif
 
+    writeEntry(type, fileName, MQZipWriter::compress(contents, compressionPolicy));
+}
+
+void MQZipWriterPrivate::writeEntry(EntryType type, const QString &fileName, const MQZipWriter::CompressedFile &file)
+{
     if (! (device->isOpen() || device->open(QIODevice::WriteOnly))) {
         status = MQZipWriter::FileOpenError;
         return;
     }
     device->seek(start_of_directory);
 
-    // don't compress small files
-    MQZipWriter::CompressionPolicy compression = compressionPolicy;
-    if (compressionPolicy == MQZipWriter::AutoCompress) {
-        if (contents.length() < 64)
-            compression = MQZipWriter::NeverCompress;
-        else
-            compression = MQZipWriter::AlwaysCompress;
-    }
-
     FileHeader header;
     memset(&header.h, 0, sizeof(CentralFileHeader));
     writeUInt(header.h.signature, 0x02014b50);
 
     writeUShort(header.h.version_needed, ZIP_VERSION);
-    writeUInt(header.h.uncompressed_size, contents.length());
+    writeUInt(header.h.uncompressed_size, file.uncompressedSize);
     writeMSDosDate(header.h.last_mod_file, QDateTime::currentDateTime());
-    QByteArray data = contents;
-    if (compression == MQZipWriter::AlwaysCompress) {
+    if (file.deflated)
         writeUShort(header.h.compression_method, CompressionMethodDeflated);
-
-       ulong len = contents.length();
-        // shamelessly copied form zlib
-        len += (len >> 12) + (len >> 14) + 11;
-        int res;
-        do {
-            data.resize(len);
-            res = deflate((uchar*)data.data(), &len, (const uchar*)contents.constData(), contents.length());
-
-            switch (res) {
-            case Z_OK:
-                data.resize(len);
-                break;
-            case Z_MEM_ERROR:
-                qWarning("QZip: Z_MEM_ERROR: Not enough memory to compress file, skipping");
-                data.resize(0);
-                break;
-            case Z_BUF_ERROR:
-                len *= 2;
-                break;
-            }
-        } while (res == Z_BUF_ERROR);
-    }
-// TODO add a check if data.length() > contents.length().  Then try to store the original and revert the compression method to be uncompressed
-    writeUInt(header.h.compressed_size, data.length());
-    uint crc_32 = ::crc32(0, 0, 0);
-    crc_32 = ::crc32(crc_32, (const uchar *)contents.constData(), contents.length());
-    writeUInt(header.h.crc_32, crc_32);
+    writeUInt(header.h.compressed_size, file.data.length());
+    writeUInt(header.h.crc_32, file.crc);
 
     // if bit 11 is set, the filename and comment fields must be encoded using UTF-8
     ushort general_purpose_bits = Utf8Names; // always use utf-8
@@ -746,7 +723,7 @@ void MQZipWriterPrivate::addEntry(EntryType type, const QString &fileName, const
     LocalFileHeader h = header.h.toLocalHeader();
     device->write((const char *)&h, sizeof(LocalFileHeader));
     device->write(header.file_name);
-    device->write(data);
+    device->write(file.data);
     start_of_directory = device->pos();
     dirtyFileTree = true;
 }
@@ -924,9 +901,11 @@ MQZipReader::FileInfo MQZipReader::entryInfoAt(int index) const
 }
 
 /*!
-    Fetch the file contents from the zip archive and return the uncompressed bytes.
+    \internal
+    Looks up \a fileName and reads its still compressed contents.
 */
-QByteArray MQZipReader::fileData(const QString &fileName) const
+static bool readEntry(MQZipReaderPrivate *d, const QString &fileName, QByteArray &compressed,
+                      int &compression_method, int &uncompressed_size, uint *crc = 0)
 {
     d->scanFiles();
     int i;
@@ -935,19 +914,21 @@ QByteArray MQZipReader::fileData(const QString &fileName) const
             break;
     }
     if (i == d->fileHeaders.size())
-        return QByteArray();
+        return false;
 
     FileHeader header = d->fileHeaders.at(i);
 
     ushort version_needed = readUShort(header.h.version_needed);
     if (version_needed > ZIP_VERSION) {
         qWarning("QZip: .ZIP specification version %d implementationis needed to extract the data.", version_needed);
-        return QByteArray();
+        return false;
     }
 
     ushort general_purpose_bits = readUShort(header.h.general_purpose_bits);
     int compressed_size = readUInt(header.h.compressed_size);
-    int uncompressed_size = readUInt(header.h.uncompressed_size);
+    uncompressed_size = readUInt(header.h.uncompressed_size);
+    if (crc)
+        *crc = readUInt(header.h.crc_32);
     int start = readUInt(header.h.offset_local_header);
     //qDebug("uncompressing file %d: local header at %d", i, start);
 
@@ -957,16 +938,27 @@ QByteArray MQZipReader::fileData(const QString &fileName) const
     uint skip = readUShort(lh.file_name_length) + readUShort(lh.extra_field_length);
     d->device->seek(d->device->pos() + skip);
 
-    int compression_method = readUShort(lh.compression_method);
+    compression_method = readUShort(lh.compression_method);
     //qDebug("file=%s: compressed_size=%d, uncompressed_size=%d", fileName.toLocal8Bit().data(), compressed_size, uncompressed_size);
 
     if ((general_purpose_bits & Encrypted) != 0) {
         qWarning("QZip: Unsupported encryption method is needed to extract the data.");
-        return QByteArray();
+        return false;
     }
 
     //qDebug("file at %lld", d->device->pos());
-    QByteArray compressed = d->device->read(compressed_size);
+    compressed = d->device->read(compressed_size);
+    compressed.truncate(compressed_size);
+    return true;
+}
+
+/*!
+    \internal
+    Returns the uncompressed bytes of an entry read by readEntry().
+*/
+static QByteArray uncompress(QByteArray compressed, int compression_method, int uncompressed_size)
+{
+    int compressed_size = compressed.size();
     if (compression_method == CompressionMethodStored) {
         // no compression
         compressed.truncate(uncompressed_size);
@@ -974,7 +966,6 @@ QByteArray MQZipReader::fileData(const QString &fileName) const
     } else if (compression_method == CompressionMethodDeflated) {
         // Deflate
         //qDebug("compressed=%d", compressed.size());
-        compressed.truncate(compressed_size);
         QByteArray baunzip;
         ulong len = qMax(uncompressed_size,  1);
         int res;
@@ -1006,6 +997,228 @@ QByteArray MQZipReader::fileData(const QString &fileName) const
     return QByteArray();
 }
 
+/*!
+    Fetch the file contents from the zip archive and return the uncompressed bytes.
+*/
+QByteArray MQZipReader::fileData(const QString &fileName) const
+{
+    QByteArray compressed;
+    int compression_method;
+    int uncompressed_size;
+    if (!readEntry(d, fileName, compressed, compression_method, uncompressed_size))
+        return QByteArray();
+    return uncompress(compressed, compression_method, uncompressed_size);
+}
+
+/*!
+    Fetch the contents of \a fileName into \a data, provided the
+    archive still holds the entry with checksum \a crc. Returns \c false
+    if the entry is missing, has another checksum, or its uncompressed
+    bytes do not match the checksum.
+*/
+bool MQZipReader::fileData(const QString &fileName, uint crc, QByteArray *data) const
+{
+    QByteArray compressed;
+    int compression_method;
+    int uncompressed_size;
+    uint entryCrc;
+    if (!readEntry(d, fileName, compressed, compression_method, uncompressed_size, &entryCrc) || entryCrc != crc)
+        return false;
+    QByteArray ba = uncompress(compressed, compression_method, uncompressed_size);
+    if (ba.size() != uncompressed_size
+        || ::crc32(::crc32(0, 0, 0), (const uchar *)ba.constData(), ba.size()) != crc)
+        return false;
+    *data = ba;
+    return true;
+}
+
+/*!
+    Reads the contents of \a fileName as stored in the archive into
+    \a file, so it can be added to another archive without inflating
+    and compressing it again. Returns \c false if the file cannot be
+    extracted.
+*/
+bool MQZipReader::compressedFileData(const QString &fileName, MQZipWriter::CompressedFile &file) const
+{
+    int compression_method;
+    int uncompressed_size;
+    if (!readEntry(d, fileName, file.data, compression_method, uncompressed_size, &file.crc))
+        return false;
+    file.uncompressedSize = uncompressed_size;
+    if (compression_method == CompressionMethodStored)
+        file.deflated = false;
+    else if (compression_method == CompressionMethodDeflated)
+        file.deflated = true;
+    else
+        return false;
+    return true;
+}
+
+/*!
+    \internal
+    Sequential device inflating a deflated entry on a background thread
+    while it is read. At most MaxBlocks blocks of the uncompressed data
+    are kept ahead of the reader.
+*/
+class MQZipInflateDevice : public QIODevice
+{
+public:
+    explicit MQZipInflateDevice(const QByteArray &data)
+        : compressed(data)
+    {
+        open(QIODevice::ReadOnly);
+        thread = std::thread(&MQZipInflateDevice::run, this);
+    }
+
+    ~MQZipInflateDevice()
+    {
+        mutex.lock();
+        cancel = true;
+        consumed.wakeAll();
+        mutex.unlock();
+        thread.join();
+    }
+
+    bool isSequential() const override { return true; }
+
+    bool atEnd() const override
+    {
+        QMutexLocker locker(&mutex);
+        return QIODevice::bytesAvailable() == 0 && blockPos == block.size() && blocks.empty() && finished;
+    }
+
+    qint64 bytesAvailable() const override
+    {
+        QMutexLocker locker(&mutex);
+        qint64 n = QIODevice::bytesAvailable() + block.size() - blockPos;
+        for (const QByteArray &b : blocks)
+            n += b.size();
+        return n;
+    }
+
+protected:
+    qint64 readData(char *data, qint64 maxlen) override
+    {
+        qint64 n = 0;
+        while (n < maxlen) {
+            // only wait for the inflater if nothing was read yet
+            if (blockPos == block.size() && !nextBlock(n == 0))
+                break;
+            const qint64 k = qMin(maxlen - n, qint64(block.size() - blockPos));
+            memcpy(data + n, block.constData() + blockPos, k);
+            blockPos += k;
+            n += k;
+        }
+        if (n == 0) {
+            QMutexLocker locker(&mutex);
+            if (failed)
+                return -1;
+        }
+        return n;
+    }
+
+    qint64 writeData(const char *, qint64) override { return -1; }
+
+private:
+    enum { BlockSize = 64 * 1024, MaxBlocks = 16 };
+
+    bool nextBlock(bool wait)
+    {
+        QMutexLocker locker(&mutex);
+        while (wait && blocks.empty() && !finished)
+            produced.wait(&mutex);
+        if (blocks.empty())
+            return false;
+        block = blocks.front();
+        blocks.pop_front();
+        blockPos = 0;
+        consumed.wakeOne();
+        return true;
+    }
+
+    void run()
+    {
+        z_stream stream;
+        memset(&stream, 0, sizeof(stream));
+        stream.next_in = (Bytef*)compressed.constData();
+        stream.avail_in = compressed.size();
+        int err = inflateInit2(&stream, -MAX_WBITS);
+        const bool initialized = err == Z_OK;
+        while (err == Z_OK) {
+            QByteArray out(BlockSize, Qt::Uninitialized);
+            stream.next_out = (Bytef*)out.data();
+            stream.avail_out = BlockSize;
+            err = inflate(&stream, Z_NO_FLUSH);
+            if (err == Z_BUF_ERROR || err == Z_NEED_DICT)
+                err = Z_DATA_ERROR;     // truncated input
+            out.truncate(BlockSize - stream.avail_out);
+
+            QMutexLocker locker(&mutex);
+            if (!out.isEmpty()) {
+                blocks.push_back(out);
+                produced.wakeAll();
+            }
+            while (blocks.size() >= MaxBlocks && !cancel)
+                consumed.wait(&mutex);
+            if (cancel)
+                break;
+        }
+        if (initialized)
+            inflateEnd(&stream);
+        compressed = QByteArray();
+
+        QMutexLocker locker(&mutex);
+        if (err != Z_STREAM_END && !cancel)
+            qWarning("QZip: Z_DATA_ERROR: Input data is corrupted");
+        failed = err != Z_STREAM_END;
+        finished = true;
+        produced.wakeAll();
+    }
+
+    QByteArray compressed;          // owned by the inflater thread
+    QByteArray block;               // block being read
+    int blockPos = 0;
+
+    mutable QMutex mutex;           // guards the members below
+    QWaitCondition produced;
+    QWaitCondition consumed;
+    std::deque<QByteArray> blocks;
+    bool finished = false;
+    bool failed = false;
+    bool cancel = false;
+
+    std::thread thread;
+};
+
+/*!
+    Returns a sequential device delivering the uncompressed contents of
+    \a fileName, or 0 if the file cannot be extracted. Deflated files are
+    inflated on a background thread while the device is read, so the
+    uncompressed file is never held in memory as a whole. The caller owns
+    the device.
+*/
+QIODevice *MQZipReader::fileDevice(const QString &fileName) const
+{
+    QByteArray compressed;
+    int compression_method;
+    int uncompressed_size;
+    if (!readEntry(d, fileName, compressed, compression_method, uncompressed_size))
+        return 0;
+
+    if (compression_method == CompressionMethodStored) {
+        compressed.truncate(uncompressed_size);
+        QBuffer *buffer = new QBuffer;
+        buffer->setData(compressed);
+        buffer->open(QIODevice::ReadOnly);
+        return buffer;
+    } else if (compression_method == CompressionMethodDeflated) {
+        return new MQZipInflateDevice(compressed);
+    }
+
+    qWarning("QZip: Unsupported compression method %d is needed to extract the data.", compression_method);
+    return 0;
+}
+
 /*!
     Extracts the full contents of the zip file into \a destinationDir on
     the local filesystem.
@@ -1269,6 +1482,69 @@ void MQZipWriter::addFile(const QString &fileName, const QByteArray &data)
     d->addEntry(MQZipWriterPrivate::File, QDir::fromNativeSeparators(fileName), data);
 }
 
+/*!
+    Compresses \a contents as addFile() would with the given \a policy.
+    This does not depend on a writer, so files can be compressed on
+    other threads and added with addCompressedFile() later.
+*/
+MQZipWriter::CompressedFile MQZipWriter::compress(const QByteArray &contents, CompressionPolicy policy)
+{
+    // don't compress small files
+    CompressionPolicy compression = policy;
+    if (policy == AutoCompress) {
+        if (contents.length() < 64)
+            compression = NeverCompress;
+        else
+            compression = AlwaysCompress;
+    }
+
+    CompressedFile file;
+    file.uncompressedSize = contents.length();
+    file.data = contents;
+    if (compression == AlwaysCompress) {
+        file.deflated = true;
+
+       ulong len = contents.length();
+        // shamelessly copied form zlib
+        len += (len >> 12) + (len >> 14) + 11;
+        int res;
+        do {
+            file.data.resize(len);
+            res = deflate((uchar*)file.data.data(), &len, (const uchar*)contents.constData(), contents.length());
+
+            switch (res) {
+            case Z_OK:
+                file.data.resize(len);
+                break;
+            case Z_MEM_ERROR:
+                qWarning("QZip: Z_MEM_ERROR: Not enough memory to compress file, storing it");
+                break;
+            case Z_BUF_ERROR:
+                len *= 2;
+                break;
+            }
+        } while (res == Z_BUF_ERROR);
+
+        // store the original if deflate failed or did not shrink it
+        if (res != Z_OK || file.data.length() >= contents.length()) {
+            file.data = contents;
+            file.deflated = false;
+        }
+    }
+    file.crc = ::crc32(0, 0, 0);
+    file.crc = ::crc32(file.crc, (const uchar *)contents.constData(), contents.length());
+    return file;
+}
+
+/*!
+    Add a file compressed by compress() or taken from another archive
+    with MQZipReader::compressedFileData() to the archive.
+*/
+void MQZipWriter::addCompressedFile(const QString &fileName, const CompressedFile &file)
+{
+    d->writeEntry(MQZipWriterPrivate::File, QDir::fromNativeSeparators(fileName), file);
+}
+
 /*!
     Add a file to the archive with \a device as the source of the contents.
     The contents returned from QIODevice::readAll() will be used as the
@@ -58,6 +58,7 @@
 #include <QtCore/qdatetime.h>
 #include <QtCore/qfile.h>
 #include <QtCore/qstring.h>
+#include "qzipwriter_p.h"
 
 QT_BEGIN_NAMESPACE
 
@@ -99,6 +100,9 @@ public:
 
     FileInfo entryInfoAt(int index) const;
     QByteArray fileData(const QString &fileName) const;
+    bool fileData(const QString &fileName, uint crc, QByteArray *data) const;
+    QIODevice *fileDevice(const QString &fileName) const;
+    bool compressedFileData(const QString &fileName, MQZipWriter::CompressedFile &file) const;
     bool extractAll(const QString &destinationDir) const;
 
     enum Status {
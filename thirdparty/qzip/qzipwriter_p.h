@@ -56,6 +56,7 @@
 
 #include <QtCore/qstring.h>
 #include <QtCore/qfile.h>
+#include <QtCore/qbytearray.h>
 
 QT_BEGIN_NAMESPACE
 
@@ -101,6 +102,16 @@ public:
 
     void addFile(const QString &fileName, QIODevice *device);
 
+    struct CompressedFile {
+        QByteArray data;
+        uint crc = 0;
+        uint uncompressedSize = 0;
+        bool deflated = false;
+    };
+
+    static CompressedFile compress(const QByteArray &contents, CompressionPolicy policy);
+    void addCompressedFile(const QString &fileName, const CompressedFile &file);
+
     void addDirectory(const QString &dirName);
 
     void addSymLink(const QString &fileName, const QString &destination);